@@ -0,0 +1,203 @@
+// Measures CPU time and syscalls per ListObjectsV2 request.
+// Build once with -Dio_uring=enabled and once without, and run both against the same bucket to compare
+// the io_uring backend with the epoll reactor.
+
+#include "s3cpp/aws/iam/session.hpp"
+#include "s3cpp/aws/s3/client.hpp"
+#include "s3cpp/aws/s3/session.hpp"
+#include "s3cpp/meta.hpp"
+
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/co_spawn.hpp> // IWYU pragma: keep
+#include <boost/asio/detached.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/parsers.hpp>
+#include <boost/program_options/value_semantic.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <boost/url/url.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <linux/perf_event.h>
+#include <memory>
+#include <optional>
+#include <print>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+[[nodiscard]] std::string file_to_string(const std::filesystem::path &path) {
+    const std::ifstream stream{path};
+    std::stringstream buffer;
+    buffer << stream.rdbuf();
+    return buffer.str();
+}
+
+struct Options {
+    std::string bucket;
+    std::string endpoint;
+    std::string access_key;
+    std::string secret_key;
+    std::string prefix;
+    std::size_t requests{};
+    std::size_t concurrency{};
+};
+
+[[nodiscard]] Options parse_opts(int argc, char **argv) {
+    Options ret;
+
+    boost::program_options::options_description descr{"Options"};
+    // clang-format off
+    descr.add_options()
+        ("help,h", "print this help")
+        ("bucket,b",  boost::program_options::value<std::string>(&ret.bucket)->required(), "S3 bucket name")
+        ("endpoint,e",  boost::program_options::value<std::string>(&ret.endpoint)->required(), "endpoint URL, including protocol and (if required) port")
+        ("access-key-file", boost::program_options::value<std::string>(&ret.access_key)->required(), "path to access key file")
+        ("secret-access-key-file", boost::program_options::value<std::string>(&ret.secret_key)->required(), "path to secret key file")
+        ("prefix", boost::program_options::value<std::string>(&ret.prefix)->default_value(""), "prefix to list")
+        ("requests,n", boost::program_options::value<std::size_t>(&ret.requests)->default_value(1000), "number of requests")
+        ("concurrency,c", boost::program_options::value<std::size_t>(&ret.concurrency)->default_value(16), "requests in flight")
+    ;
+    // clang-format on
+
+    boost::program_options::variables_map varmap;
+    boost::program_options::store(boost::program_options::parse_command_line(argc, argv, descr), varmap);
+    if (varmap.contains("help")) {
+        std::cout << descr << '\n';
+        exit(0);
+    }
+    boost::program_options::notify(varmap);
+
+    ret.access_key = file_to_string(ret.access_key);
+    ret.secret_key = file_to_string(ret.secret_key);
+    boost::algorithm::trim(ret.access_key);
+    boost::algorithm::trim(ret.secret_key);
+
+    return ret;
+}
+
+// Counts syscalls of this process and all threads it creates afterwards, via the raw_syscalls:sys_enter
+// tracepoint. This usually requires CAP_PERFMON or a lowered kernel.perf_event_paranoid.
+class SyscallCounter {
+private:
+    int fd_ = -1;
+
+public:
+    SyscallCounter() {
+        std::uint64_t id = 0;
+        for (const char *path : {"/sys/kernel/tracing/events/raw_syscalls/sys_enter/id",
+                                 "/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id"}) {
+            std::ifstream stream{path};
+            if (stream >> id) {
+                break;
+            }
+        }
+        if (id == 0) {
+            return;
+        }
+        perf_event_attr attr{};
+        attr.type = PERF_TYPE_TRACEPOINT;
+        attr.size = sizeof(attr);
+        attr.config = id;
+        attr.inherit = 1;
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg)
+        fd_ = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+    ~SyscallCounter() {
+        if (fd_ != -1) {
+            ::close(fd_);
+        }
+    }
+    SyscallCounter(const SyscallCounter &) = delete;
+    SyscallCounter &operator=(const SyscallCounter &) = delete;
+    SyscallCounter(SyscallCounter &&) = delete;
+    SyscallCounter &operator=(SyscallCounter &&) = delete;
+
+    [[nodiscard]] std::optional<std::uint64_t> read() const {
+        std::uint64_t count = 0;
+        if (fd_ == -1 || ::read(fd_, &count, sizeof(count)) != sizeof(count)) {
+            return std::nullopt;
+        }
+        return count;
+    }
+};
+
+[[nodiscard]] std::chrono::microseconds cpu_time() {
+    rusage usage{};
+    ::getrusage(RUSAGE_SELF, &usage);
+    return std::chrono::seconds{usage.ru_utime.tv_sec + usage.ru_stime.tv_sec} +
+           std::chrono::microseconds{usage.ru_utime.tv_usec + usage.ru_stime.tv_usec};
+}
+
+struct Progress {
+    std::size_t remaining;
+    std::size_t failed;
+};
+
+s3cpp::meta::crt<boost::asio::awaitable<void>>
+worker(s3cpp::aws::s3::Client client, std::string bucket, std::string prefix,
+       std::shared_ptr<Progress> progress) {
+    while (progress->remaining > 0) {
+        progress->remaining--;
+        const auto res =
+            co_await client.list_objects_v2({.Bucket = bucket, .Delimiter = "/", .Prefix = prefix});
+        if (!res) {
+            progress->failed++;
+        }
+    }
+}
+
+} // namespace
+
+// NOLINTNEXTLINE(bugprone-exception-escape)
+int main(int argc, char **argv) {
+    const Options options = parse_opts(argc, argv);
+
+    const SyscallCounter syscalls;
+    boost::asio::io_context context{1};
+    const auto session = std::make_shared<s3cpp::aws::s3::Session>(
+        s3cpp::aws::iam::Session{.access_key = options.access_key,
+                                 .secret_access_key = options.secret_key,
+                                 .region = "default",
+                                 .endpoint = boost::urls::url{options.endpoint}});
+    const s3cpp::aws::s3::Client client{session};
+
+    const auto progress = std::make_shared<Progress>(options.requests, 0);
+    const auto syscalls_before = syscalls.read();
+    const auto cpu_before = cpu_time();
+    const auto wall_before = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < options.concurrency; i++) {
+        boost::asio::co_spawn(context, worker(client, options.bucket, options.prefix, progress),
+                              boost::asio::detached);
+    }
+    context.run();
+    const auto wall = std::chrono::steady_clock::now() - wall_before;
+    const auto cpu = cpu_time() - cpu_before;
+    const auto syscalls_after = syscalls.read();
+
+#if defined(BOOST_ASIO_HAS_IO_URING) && defined(BOOST_ASIO_DISABLE_EPOLL)
+    std::println("backend: io_uring");
+#else
+    std::println("backend: epoll");
+#endif
+    const auto requests = static_cast<double>(options.requests);
+    std::println("{} requests, {} failed, {:.2f} requests/s", options.requests, progress->failed,
+                 requests / std::chrono::duration<double>(wall).count());
+    std::println("CPU per request: {:.1f}us", static_cast<double>(cpu.count()) / requests);
+    if (syscalls_before.has_value() && syscalls_after.has_value()) {
+        std::println("syscalls per request: {:.1f}",
+                     static_cast<double>(syscalls_after.value() - syscalls_before.value()) / requests);
+    } else {
+        std::println("syscalls per request: n/a (perf_event_open not permitted)");
+    }
+}
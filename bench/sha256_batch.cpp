@@ -0,0 +1,125 @@
+// Times hashing a batch of equally sized payloads, as when many parts or small objects are uploaded at
+// once. "one by one" hashes them in turn through Botan, "batched" through sha256_batch, which hashes
+// sha256_batch_lanes of them side by side. The digests are compared before timing.
+// The mixed batch swaps the first payload for a large one, as when a big object is uploaded alongside
+// small ones, which mostly leaves a single lane busy.
+
+#include "s3cpp/aws/iam/crypto.hpp"
+
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/parsers.hpp>
+#include <boost/program_options/value_semantic.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <print>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+struct Options {
+    std::size_t payloads{};
+    std::size_t size{};
+    std::size_t large{};
+    std::size_t iterations{};
+};
+
+[[nodiscard]] Options parse_opts(int argc, char **argv) {
+    Options ret;
+
+    boost::program_options::options_description descr{"Options"};
+    // clang-format off
+    descr.add_options()
+        ("help,h", "print this help")
+        ("payloads,p", boost::program_options::value<std::size_t>(&ret.payloads)->default_value(64), "payloads per batch")
+        ("size,s", boost::program_options::value<std::size_t>(&ret.size)->default_value(16384), "bytes per payload")
+        ("large,l", boost::program_options::value<std::size_t>(&ret.large)->default_value(4194304), "bytes of the large payload in the mixed batch")
+        ("iterations,n", boost::program_options::value<std::size_t>(&ret.iterations)->default_value(200), "batches to hash per variant")
+    ;
+    // clang-format on
+
+    boost::program_options::variables_map varmap;
+    boost::program_options::store(boost::program_options::parse_command_line(argc, argv, descr), varmap);
+    if (varmap.contains("help")) {
+        std::cout << descr << '\n';
+        exit(0);
+    }
+    boost::program_options::notify(varmap);
+    return ret;
+}
+
+template <typename Hash>
+void measure(std::string_view name, const Options &options, const std::vector<std::string_view> &payloads,
+             Hash hash) {
+    std::vector<s3cpp::aws::iam::_internal::sha256_digest> digests(payloads.size());
+    std::size_t checksum = 0;
+    std::size_t batch_bytes = 0;
+    for (const std::string_view payload : payloads) {
+        batch_bytes += payload.size();
+    }
+
+    const auto run = [&](std::size_t iterations) {
+        for (std::size_t i = 0; i < iterations; i++) {
+            hash(payloads, digests);
+            checksum += digests[i % digests.size()][i % 32];
+        }
+    };
+
+    run(options.iterations / 10);
+    const auto start = std::chrono::steady_clock::now();
+    run(options.iterations);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    const double bytes = static_cast<double>(options.iterations * batch_bytes);
+    std::println("{}: {:.0f} MB/s (checksum {})", name, bytes / elapsed.count() / 1e6, checksum);
+}
+
+} // namespace
+
+// NOLINTNEXTLINE(bugprone-exception-escape)
+int main(int argc, char **argv) {
+    const Options options = parse_opts(argc, argv);
+
+    std::vector<std::string> storage;
+    storage.reserve(options.payloads);
+    for (std::size_t i = 0; i < options.payloads; i++) {
+        storage.emplace_back(options.size, static_cast<char>('a' + (i % 26)));
+    }
+    const std::vector<std::string_view> payloads{storage.begin(), storage.end()};
+    const std::string large(options.large, 'z');
+    std::vector<std::string_view> mixed = payloads;
+    if (!mixed.empty()) {
+        mixed.front() = large;
+    }
+
+    const auto one_by_one = [](const std::vector<std::string_view> &data,
+                               std::vector<s3cpp::aws::iam::_internal::sha256_digest> &out) {
+        for (std::size_t i = 0; i < data.size(); i++) {
+            out[i] = s3cpp::aws::iam::_internal::sha256(data[i]);
+        }
+    };
+    const auto batched = [](const std::vector<std::string_view> &data,
+                            std::vector<s3cpp::aws::iam::_internal::sha256_digest> &out) {
+        s3cpp::aws::iam::_internal::sha256_batch(data, out);
+    };
+
+    for (const auto *batch : {&payloads, &mixed}) {
+        std::vector<s3cpp::aws::iam::_internal::sha256_digest> expected(batch->size());
+        std::vector<s3cpp::aws::iam::_internal::sha256_digest> actual(batch->size());
+        one_by_one(*batch, expected);
+        batched(*batch, actual);
+        if (expected != actual) {
+            std::println(std::cerr, "batched digests differ");
+            return 1;
+        }
+    }
+
+    std::println("{} lanes", s3cpp::aws::iam::_internal::sha256_batch_lanes());
+    measure("one by one", options, payloads, one_by_one);
+    measure("batched", options, payloads, batched);
+    measure("mixed, one by one", options, mixed, one_by_one);
+    measure("mixed, batched", options, mixed, batched);
+}
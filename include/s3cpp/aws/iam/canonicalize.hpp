@@ -4,6 +4,7 @@
 
 #include <boost/beast/http/fields.hpp> // IWYU pragma: keep
 #include <cstddef>
+#include <memory_resource>
 #include <span>
 #include <string>
 #include <string_view>
@@ -16,21 +17,34 @@ namespace s3cpp::aws::iam {
 
 namespace _internal {
 
-[[nodiscard]] std::tuple<std::string, std::string> canonicalize_request(std::string_view method_string,
-                                                                        std::string_view encoded_target_str,
-                                                                        std::span<const std::byte> body,
-                                                                        boost::beast::http::fields &headers);
+// headers whose storage comes from a per-request arena
+using pmr_fields = boost::beast::http::basic_fields<std::pmr::polymorphic_allocator<char>>;
+
+template <typename Fields>
+[[nodiscard]] std::tuple<std::pmr::string, std::pmr::string>
+canonicalize_request(std::string_view method_string, std::string_view encoded_target_str,
+                     std::span<const std::byte> body, Fields &headers, std::pmr::memory_resource *memory);
+
+extern template std::tuple<std::pmr::string, std::pmr::string>
+canonicalize_request(std::string_view method_string, std::string_view encoded_target_str,
+                     std::span<const std::byte> body, boost::beast::http::fields &headers,
+                     std::pmr::memory_resource *memory);
+extern template std::tuple<std::pmr::string, std::pmr::string>
+canonicalize_request(std::string_view method_string, std::string_view encoded_target_str,
+                     std::span<const std::byte> body, pmr_fields &headers, std::pmr::memory_resource *memory);
 
 } // namespace _internal
 
 // returns [CanonicalRequest, SignedHeaders]
+// all temporaries and the results are allocated from memory
 template <typename Request>
-[[nodiscard]] std::tuple<std::string, std::string> canonicalize_request(Request &request) {
+[[nodiscard]] std::tuple<std::pmr::string, std::pmr::string>
+canonicalize_request(Request &request, std::pmr::memory_resource *memory = std::pmr::get_default_resource()) {
     return _internal::canonicalize_request(
         request.method_string(), request.target(),
         std::span<const std::byte>{meta::safe_reinterpret_cast<const std::byte *>(request.body().data()),
                                    request.body().size()},
-        request.base());
+        request.base(), memory);
 }
 
 } // namespace s3cpp::aws::iam
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+//
+#include "s3cpp/internal/macro-begin.hpp"
+
+namespace s3cpp::aws::iam::_internal {
+
+using sha256_digest = std::array<std::uint8_t, 32>;
+using sha256_hex = std::array<char, 64>;
+
+// The hash and MAC objects are kept per thread and reused, instead of being looked up and allocated by
+// Botan on every call. The MAC only rekeys when the key differs from the previous call on the thread.
+[[nodiscard]] sha256_digest sha256(std::string_view data);
+[[nodiscard]] sha256_digest hmac_sha256(std::span<const std::uint8_t> key, std::string_view data);
+
+// Hashes data[i] into out[i]. Several messages are hashed side by side in the lanes of the vector registers,
+// with the widest kernel the CPU supports, so the throughput grows with the number of messages up to
+// sha256_batch_lanes of them.
+void sha256_batch(std::span<const std::string_view> data, std::span<sha256_digest> out);
+// 1 where messages are hashed one at a time, as with the SHA extensions but without AVX-512
+[[nodiscard]] std::size_t sha256_batch_lanes();
+// sha256_batch on the kernel with that many lanes (1, 4, 8 or 16) rather than the picked one, false if the
+// CPU can't run it, so that the tests cover every kernel
+[[nodiscard]] bool sha256_batch_on(std::size_t lanes, std::span<const std::string_view> data,
+                                   std::span<sha256_digest> out);
+
+// lowercase hex, out must have room for 2 * in.size() characters
+void hex_encode(std::span<const std::uint8_t> in, char *out);
+
+[[nodiscard]] inline sha256_hex hex_encode(const sha256_digest &digest) {
+    sha256_hex ret;
+    hex_encode(digest, ret.data());
+    return ret;
+}
+
+[[nodiscard]] inline std::string_view to_string_view(const sha256_hex &hex) {
+    return {hex.data(), hex.size()};
+}
+
+} // namespace s3cpp::aws::iam::_internal
+
+//
+#include "s3cpp/internal/macro-end.hpp"
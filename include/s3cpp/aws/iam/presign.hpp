@@ -0,0 +1,60 @@
+#pragma once
+
+#include "s3cpp/aws/iam/session.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//
+#include "s3cpp/internal/macro-begin.hpp"
+
+namespace s3cpp::aws::iam {
+
+struct PresignOptions {
+    // the URLs are valid from then on, for expires
+    std::chrono::system_clock::time_point time = std::chrono::system_clock::now();
+    // at most a week
+    std::chrono::seconds expires{3600};
+    std::string service = "s3";
+};
+
+// Query string SigV4 for GET URLs, see
+// https://docs.aws.amazon.com/AmazonS3/latest/API/sigv4-query-string-auth.html
+// Everything that doesn't depend on the path is done once up front: the signing key, the X-Amz-* query
+// that the URL and the canonical request share, and the fixed parts of the canonical request and the
+// string to sign. What's left per URL is two hashes and the string building.
+class Presigner {
+private:
+    std::vector<std::uint8_t> signing_key_;
+    // scheme://host[:port]
+    std::string origin_;
+    // X-Amz-Algorithm=...&X-Amz-SignedHeaders=host, sorted as the canonical request wants it
+    std::string query_;
+    // the canonical request after its path
+    std::string canonical_suffix_;
+    // the string to sign up to the hash of the canonical request
+    std::string string_to_sign_prefix_;
+
+public:
+    // signs for session's credentials, region and endpoint, throws if options.expires is out of range
+    [[nodiscard]] explicit Presigner(const Session &session, const PresignOptions &options = {});
+
+    // appends the URL to out, a path that isn't is_encoded gets url encoded
+    void presign_get_to(std::string &out, std::string_view path, bool is_encoded = false) const;
+    [[nodiscard]] std::string presign_get(std::string_view path, bool is_encoded = false) const;
+
+    // ret[i] is the URL for paths[i], signed on up to threads threads, 0 for one per core
+    [[nodiscard]] std::vector<std::string>
+    presign_get(std::span<const std::string_view> paths, bool is_encoded = false,
+                std::size_t threads = 0) const;
+};
+
+} // namespace s3cpp::aws::iam
+
+//
+#include "s3cpp/internal/macro-end.hpp"
@@ -3,6 +3,8 @@
 #include "s3cpp/aws/scope.hpp"
 
 #include <cstdint>
+#include <memory_resource>
+#include <span>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -14,9 +16,18 @@ namespace s3cpp::aws::iam {
 
 [[nodiscard]] std::vector<uint8_t> get_signing_key(std::string_view secret_access_key, const Scope &scope);
 
-[[nodiscard]] std::string sign_request(std::string_view access_key, std::string_view secret_access_key,
-                                       std::string_view canonical_request, std::string_view signed_headers,
-                                       std::string_view timestamp, const Scope &scope);
+// returns the Authorization header value
+[[nodiscard]] std::pmr::string
+sign_request(std::string_view access_key, std::string_view secret_access_key,
+             std::string_view canonical_request, std::string_view signed_headers, std::string_view timestamp,
+             const Scope &scope, std::pmr::memory_resource *memory = std::pmr::get_default_resource());
+
+// for callers that cache the signing key, credential_scope is the formatted Scope it was derived for
+[[nodiscard]] std::pmr::string
+sign_request_with_key(std::string_view access_key, std::span<const std::uint8_t> signing_key,
+                      std::string_view canonical_request, std::string_view signed_headers,
+                      std::string_view timestamp, std::string_view credential_scope,
+                      std::pmr::memory_resource *memory = std::pmr::get_default_resource());
 
 } // namespace s3cpp::aws::iam
 
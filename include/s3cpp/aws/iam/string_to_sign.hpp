@@ -5,6 +5,8 @@
 
 #include <chrono>
 #include <format>
+#include <iterator>
+#include <memory_resource>
 #include <string>
 #include <string_view>
 
@@ -13,16 +15,31 @@
 
 namespace s3cpp::aws::iam {
 
-template <typename T>
+// writes the 16 characters of the timestamp to out
+template <typename OutputIt, typename T>
     requires meta::is_specialization_v<T, std::chrono::time_point>
-[[nodiscard]] std::string format_timestamp(const T &time) {
+OutputIt format_timestamp_to(OutputIt out, const T &time) {
     // TODO: convert non-utc
     // some endpoints won't work with the +offset format
-    return std::format("{0:%Y%m%d}T{0:%H%M}{0:%OS}Z", time);
+    return std::format_to(out, "{0:%Y%m%d}T{0:%H%M}{0:%OS}Z", time);
+}
+
+template <typename T>
+    requires meta::is_specialization_v<T, std::chrono::time_point>
+[[nodiscard]] std::string format_timestamp(const T &time) {
+    std::string ret;
+    format_timestamp_to(std::back_inserter(ret), time);
+    return ret;
 }
 
-[[nodiscard]] std::string string_to_sign(std::string_view canonical_request, const Scope &scope,
-                                         std::string_view timestamp);
+[[nodiscard]] std::pmr::string
+string_to_sign(std::string_view canonical_request, const Scope &scope, std::string_view timestamp,
+               std::pmr::memory_resource *memory = std::pmr::get_default_resource());
+// credential_scope is the formatted Scope
+[[nodiscard]] std::pmr::string
+string_to_sign(std::string_view canonical_request, std::string_view credential_scope,
+               std::string_view timestamp,
+               std::pmr::memory_resource *memory = std::pmr::get_default_resource());
 
 } // namespace s3cpp::aws::iam
 
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <boost/system/error_code.hpp> // IWYU pragma: keep
+#include <cstddef>
+#include <expected>
 #include <string>
 #include <string_view>
 
@@ -8,13 +11,37 @@
 
 namespace s3cpp::aws::iam {
 
+// The _to variants write to out, which needs room for 3 * input.size() characters, and return the end of
+// what they wrote. The _required checks are true if encoding would change input.
+[[nodiscard]] char *urlencode_to(std::string_view input, char *out);
 [[nodiscard]] std::string urlencode(std::string_view input);
 [[nodiscard]] bool urlencode_required(std::string_view input);
+[[nodiscard]] char *urlencode_path_to(std::string_view input, char *out);
 [[nodiscard]] std::string urlencode_path(std::string_view input);
 [[nodiscard]] bool urlencode_path_required(std::string_view input);
+[[nodiscard]] char *urlencode_query_to(std::string_view input, char *out);
 [[nodiscard]] std::string urlencode_query(std::string_view input);
 [[nodiscard]] bool urlencode_query_required(std::string_view input);
 
+// Percent-decoding, the _query variants also turn + into a space, as in form-encoded keys of listings with
+// EncodingType=url. The _to variants need room for input.size() characters in out.
+[[nodiscard]] std::expected<char *, boost::system::error_code> urldecode_to(std::string_view input,
+                                                                           char *out);
+[[nodiscard]] std::expected<std::string, boost::system::error_code> urldecode(std::string_view input);
+[[nodiscard]] std::expected<char *, boost::system::error_code> urldecode_query_to(std::string_view input,
+                                                                                 char *out);
+[[nodiscard]] std::expected<std::string, boost::system::error_code> urldecode_query(std::string_view input);
+
+namespace _internal {
+
+// Runs all of the above on the kernel with vectors of width bytes (16 for SSE2, 32 for AVX2, 0 for the
+// scalar one) rather than the picked one, false if the CPU can't run it. For the whole process, so that the
+// tests cover every kernel.
+[[nodiscard]] bool use_urlencode_kernel(std::size_t width);
+void use_default_urlencode_kernel();
+
+} // namespace _internal
+
 } // namespace s3cpp::aws::iam
 
 //
@@ -65,15 +65,18 @@ public:
 
     [[nodiscard]] meta::crt<boost::asio::awaitable<
         std::expected<ListObjectsResult, std::variant<boost::beast::error_code, pugi::xml_parse_status>>>>
-    list_objects(ListObjectsParameters parameters, boost::beast::http::fields headers = {}) const;
+    list_objects(ListObjectsParameters parameters, boost::beast::http::fields headers = {},
+                 RequestOptions request_options = {}) const;
 
     [[nodiscard]] meta::crt<boost::asio::awaitable<
         std::expected<ListObjectsV2Result, std::variant<boost::beast::error_code, pugi::xml_parse_status>>>>
-    list_objects_v2(ListObjectsV2Parameters parameters, boost::beast::http::fields headers = {}) const;
+    list_objects_v2(ListObjectsV2Parameters parameters, boost::beast::http::fields headers = {},
+                    RequestOptions request_options = {}) const;
 
     [[nodiscard]] meta::crt<boost::asio::awaitable<std::expected<
         ListAllMyBucketsResult, std::variant<boost::beast::error_code, pugi::xml_parse_status>>>>
-    list_buckets(ListBucketsParameters parameters, boost::beast::http::fields headers = {}) const;
+    list_buckets(ListBucketsParameters parameters, boost::beast::http::fields headers = {},
+                 RequestOptions request_options = {}) const;
 };
 
 } // namespace s3cpp::aws::s3
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "s3cpp/meta.hpp"
+
+#include <boost/asio/awaitable.hpp>
+#include <boost/beast/core/error.hpp>
+#include <boost/beast/http/fields.hpp>  // IWYU pragma: keep
+#include <boost/beast/http/message.hpp> // IWYU pragma: keep
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <optional>
+#include <span>
+
+//
+#include "s3cpp/internal/macro-begin.hpp"
+
+namespace s3cpp::aws::s3 {
+
+namespace _internal {
+
+struct Exchange;
+
+}
+
+// A response whose header has been received, while the body is still on the wire.
+// The body is only read from the connection as the caller asks for it.
+// The connection goes back to the pool once the body has been read completely,
+// a stream that is destroyed early closes its connection.
+class ResponseStream {
+public:
+    using read_crt = meta::crt<boost::asio::awaitable<std::expected<std::size_t, boost::beast::error_code>>>;
+
+private:
+    std::unique_ptr<_internal::Exchange> exchange_;
+
+public:
+    [[nodiscard]] explicit ResponseStream(std::unique_ptr<_internal::Exchange> exchange);
+    ~ResponseStream();
+
+    [[nodiscard]] ResponseStream(const ResponseStream &) = delete;
+    [[nodiscard]] ResponseStream &operator=(const ResponseStream &) = delete;
+    [[nodiscard]] ResponseStream(ResponseStream &&) noexcept;
+    [[nodiscard]] ResponseStream &operator=(ResponseStream &&) noexcept;
+
+    [[nodiscard]] const boost::beast::http::response_header<> &header() const;
+    [[nodiscard]] std::optional<std::uint64_t> content_length() const;
+    [[nodiscard]] bool is_done() const;
+
+    // reads at least one and at most buffer.size() bytes, returns 0 once the body is complete
+    [[nodiscard]] read_crt read_some(std::span<std::byte> buffer [[clang::lifetimebound]]);
+    // fills buffer completely, unless the body ends first
+    [[nodiscard]] read_crt read(std::span<std::byte> buffer [[clang::lifetimebound]]);
+    // writes the rest of the body to fd, starting at offset, and returns its size
+    // where the connection allows it, the body is moved with splice instead of being read into user space
+    [[nodiscard]] read_crt write_to(int fd, std::uint64_t offset);
+};
+
+} // namespace s3cpp::aws::s3
+
+//
+#include "s3cpp/internal/macro-end.hpp"
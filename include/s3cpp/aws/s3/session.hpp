@@ -1,20 +1,31 @@
 #pragma once
 
+#include "response_stream.hpp"
 #include "s3cpp/aws/iam/session.hpp"
 #include "s3cpp/meta.hpp"
 
 #include <boost/asio/awaitable.hpp>
-#include <boost/asio/ssl/context.hpp>
+#include <boost/asio/ip/address.hpp>
 #include <boost/beast/core/error.hpp>
 #include <boost/beast/http/fields.hpp>      // IWYU pragma: keep
 #include <boost/beast/http/message.hpp>     // IWYU pragma: keep
 #include <boost/beast/http/string_body.hpp> // IWYU pragma: keep
 #include <boost/beast/http/verb.hpp>
+#include <boost/url/url.hpp>
+#include <array>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <expected>
+#include <filesystem>
+#include <functional>
+#include <limits>
 #include <memory>
+#include <optional>
 #include <span>
+#include <string>
 #include <string_view>
+#include <vector>
 
 //
 #include "s3cpp/internal/macro-begin.hpp"
@@ -23,39 +34,379 @@ namespace s3cpp::aws::s3 {
 
 namespace _internal {
 
-class DnsCache;
+struct Exchange;
+class LatencyTracker;
+class PayloadHasher;
+class RateLimiter;
+class RetryPolicy;
+class SigningKeyCache;
+class SingleFlight;
+struct TransportContext;
 
-}
+} // namespace _internal
+
+// Requests of a higher class jump ahead of lower ones while waiting for a connection or for the rate limits.
+// The classes share connections and rate limits by weight (see ConnectionPoolOptions), so BULK requests are
+// slowed down but never starved.
+enum class Priority : std::uint8_t {
+    REALTIME,
+    NORMAL,
+    BULK,
+};
+
+inline constexpr std::size_t priority_count = 3;
+
+struct ConnectionPoolOptions {
+    // idle keep-alive connections retained per endpoint
+    std::size_t max_idle_per_host = 256;
+    // open connections per endpoint, requests beyond this wait for a free connection
+    std::size_t max_total_per_host = std::numeric_limits<std::size_t>::max();
+    // idle connections older than this are closed instead of reused
+    std::chrono::seconds idle_timeout{30};
+    // share of the freed connections, and of the rate limits of the Session, each Priority gets while
+    // requests of several classes are waiting
+    std::array<double, priority_count> priority_weights{16, 4, 1};
+};
+
+struct ConnectionPoolStats {
+    std::size_t created;
+    std::size_t reused;
+    std::size_t evicted;
+};
+
+struct CoalescingStats {
+    // requests that got the response of an identical request instead of sending their own
+    std::size_t hits;
+    // upstream requests whose response went to at least one other caller
+    std::size_t merges;
+};
+
+struct TransportOptions {
+    // disable Nagle's algorithm, requests and small bodies go out without waiting for ACKs
+    bool no_delay = true;
+    // SO_SNDBUF / SO_RCVBUF, setting these disables the kernel's buffer autotuning for the connection
+    // raise them for links with a large bandwidth-delay product if autotuning is capped by the sysctls
+    std::optional<int> send_buffer_size;
+    std::optional<int> receive_buffer_size;
+    // TCP keepalive probes, so that pooled connections silently dropped by middleboxes are noticed
+    bool keep_alive = true;
+    std::chrono::seconds keep_alive_idle{30};
+    std::chrono::seconds keep_alive_interval{10};
+    int keep_alive_count = 3;
+    // TCP Fast Open, repeat connections to a server send the first request / ClientHello with the SYN
+    // connect errors then only show up once the first write fails
+    bool fast_open = false;
+    // bind outgoing connections to this local address, e.g. to pick a NIC on multi-homed hosts
+    // only applies to server addresses of the same family
+    std::optional<boost::asio::ip::address> local_address;
+    // share TLS state, DNS caches and connection pools with other Sessions, see Session::Session
+    // turn this off to keep a Session's connections to itself, e.g. one Session per thread
+    bool shared = true;
+};
+
+struct TlsOptions {
+    // cache session tickets and resume sessions when opening new connections
+    bool session_resumption = true;
+    // send GET requests as TLS 1.3 early data (0-RTT) on resumed connections
+    // early data can be replayed by an attacker, only enable this if all your GETs are safe to replay
+    bool early_data = false;
+    // load tickets from this file on startup and save them on shutdown
+    std::optional<std::filesystem::path> session_cache_file;
+    // let the kernel encrypt and decrypt (kTLS), so that put_file and get_file can use sendfile / splice
+    // needs the tls kernel module and a cipher it supports, otherwise connections silently stay in user space
+    // early data is not sent on these connections
+    bool kernel_tls = false;
+};
+
+struct DnsOptions {
+    // resolved addresses are refreshed in the background once they are older than this
+    std::chrono::seconds ttl{60};
+    // while refreshing fails, the previous addresses are still used for this long past the ttl
+    std::chrono::seconds max_stale{300};
+    // failed lookups are retried with exponential backoff between these bounds
+    std::chrono::milliseconds min_retry_backoff{500};
+    std::chrono::milliseconds max_retry_backoff{30000};
+};
+
+struct LoadBalancingOptions {
+    // additional gateways serving the same buckets as the session endpoint
+    // requests are spread across all resolved addresses of the endpoint and the gateways
+    std::vector<boost::urls::url> gateways;
+    // weight of the newest sample in the per-address latency and error rate averages
+    double ewma_alpha = 0.1;
+    // addresses are ejected when their error rate exceeds this
+    double max_error_rate = 0.5;
+    // addresses are ejected when their latency exceeds the fastest address' latency by this factor
+    double max_latency_factor = 5.0;
+    // samples required before an address may be ejected
+    std::size_t min_samples = 20;
+    std::chrono::seconds ejection_time{30};
+};
+
+struct EndpointStats {
+    std::string gateway;
+    std::string address;
+    std::size_t outstanding;
+    std::chrono::microseconds latency;
+    double error_rate;
+    bool ejected;
+};
+
+struct RetryOptions {
+    // attempts per request including the first one, 1 disables retries
+    std::size_t max_attempts = 5;
+    // the backoff before retry n is drawn uniformly from [0, min(max_backoff, base_backoff * 2^n)]
+    std::chrono::milliseconds base_backoff{100};
+    std::chrono::milliseconds max_backoff{20000};
+    // each retry takes retry_cost from a budget shared by the whole session, successful requests refill it
+    // once the budget is exhausted, failures are returned instead of retried
+    std::size_t retry_budget = 500;
+    std::size_t retry_cost = 5;
+    // slow down all requests of the session once the server starts throttling
+    bool adaptive_rate_limit = true;
+};
+
+struct HedgingOptions {
+    // send a second copy of GET and HEAD requests that take longer than the hedging delay,
+    // use whichever response arrives first and cancel the other request
+    bool enabled = false;
+    // fixed hedging delay, if unset the given percentile of recently observed latencies is used
+    std::optional<std::chrono::milliseconds> delay;
+    double percentile = 0.95;
+    // without a fixed delay, requests are not hedged until this many latencies have been observed
+    std::size_t min_samples = 100;
+};
+
+struct RateLimit {
+    // unset means unlimited
+    std::optional<double> requests_per_second;
+    // request and response bodies
+    std::optional<double> bytes_per_second;
+    // this much of the rate may go out at once after a quiet period
+    std::chrono::milliseconds burst{1000};
+};
+
+enum class AddressingStyle : std::uint8_t {
+    // https://endpoint/bucket/key
+    PATH,
+    // https://bucket.endpoint/key, each bucket gets its own DNS cache and connection pools
+    // buckets whose names can't be used as a host name, or endpoints given as IP addresses, use path style
+    VIRTUAL_HOSTED,
+};
+
+// how the body of a PUT is covered by the signature
+enum class PayloadSigning : std::uint8_t {
+    // the body is hashed before the request goes out, which takes a whole extra pass over it
+    SIGNED,
+    // the body is not part of the signature (UNSIGNED-PAYLOAD), use this over TLS only
+    UNSIGNED,
+    // like UNSIGNED, but the body is sent aws-chunked and a CRC32 computed while sending it follows as a
+    // trailer, which S3 checks before storing the object (STREAMING-UNSIGNED-PAYLOAD-TRAILER)
+    UNSIGNED_TRAILER,
+    // the body is sent aws-chunked and every chunk is signed while it is sent, each signature chained to the
+    // one before (STREAMING-AWS4-HMAC-SHA256-PAYLOAD)
+    SIGNED_STREAMING,
+};
+
+struct SessionOptions {
+    AddressingStyle addressing = AddressingStyle::PATH;
+    TransportOptions transport;
+    ConnectionPoolOptions connection_pool;
+    TlsOptions tls;
+    DnsOptions dns;
+    LoadBalancingOptions load_balancing;
+    RetryOptions retry;
+    HedgingOptions hedging;
+    // for this Session alone, see Session::set_rate_limit
+    RateLimit rate_limit;
+    // Concurrent GET and HEAD requests with the same path, query and headers share one upstream request.
+    // Each caller gets a copy of the response and keeps its own timeout. Requests writing to a file are
+    // never coalesced.
+    bool coalesce_requests = false;
+    // requests that set x-amz-content-sha256 themselves keep it
+    PayloadSigning payload_signing = PayloadSigning::SIGNED;
+};
+
+// a range of an open file, the file offset of fd is neither used nor changed
+struct FileRange {
+    int fd;
+    std::uint64_t offset;
+    std::uint64_t size;
+};
+
+// the body of Session::put_stream
+struct UploadStream {
+    using read_type = std::function<
+        boost::asio::awaitable<std::expected<std::size_t, boost::beast::error_code>>(std::span<std::byte>)>;
+
+    // S3 needs the length of an object before its upload starts
+    std::uint64_t size;
+    // fills the buffer with the next bytes of the object and returns how many it wrote
+    // called until size bytes have been read, returning 0 before that fails the upload
+    read_type read;
+};
+
+struct RequestOptions {
+    // the request, including all retries, fails with boost::beast::error::timeout once this has passed
+    std::optional<std::chrono::milliseconds> timeout;
+    Priority priority = Priority::NORMAL;
+    // overrides SessionOptions::payload_signing for uploads
+    std::optional<PayloadSigning> payload_signing;
+};
 
 class Session : private iam::Session {
 public:
     using crt = meta::crt<boost::asio::awaitable<std::expected<
         boost::beast::http::response<boost::beast::http::string_body>, boost::beast::error_code>>>;
+    using stream_crt =
+        meta::crt<boost::asio::awaitable<std::expected<ResponseStream, boost::beast::error_code>>>;
+    using create_crt = meta::crt<boost::asio::awaitable<std::shared_ptr<Session>>>;
+    using warm_up_crt =
+        meta::crt<boost::asio::awaitable<std::expected<std::size_t, boost::beast::error_code>>>;
 
 private:
-    mutable boost::asio::ssl::context ssl_ctx{boost::asio::ssl::context::tls_client};
-    std::shared_ptr<_internal::DnsCache> dns_cache_;
+    SessionOptions options_;
+    std::shared_ptr<_internal::TransportContext> transport_;
+    std::shared_ptr<_internal::RateLimiter> rate_limiter_;
+    std::shared_ptr<_internal::RetryPolicy> retry_policy_;
+    std::shared_ptr<_internal::LatencyTracker> latencies_;
+    std::shared_ptr<_internal::SingleFlight> single_flight_;
+    std::shared_ptr<_internal::SigningKeyCache> signing_keys_;
+    std::shared_ptr<_internal::PayloadHasher> payload_hasher_;
+
+    using exchange_crt = meta::crt<boost::asio::awaitable<
+        std::expected<std::unique_ptr<_internal::Exchange>, boost::beast::error_code>>>;
+
+    // sends the request and reads the response header
+    // PUTs with a file send it as the body, successful GETs with a file write the body to it
+    [[nodiscard]] exchange_crt open_impl(boost::beast::http::verb method, std::string_view path,
+                                         bool is_path_encoded, std::string_view query,
+                                         boost::beast::http::fields headers,
+                                         std::span<const std::byte> body [[clang::lifetimebound]],
+                                         std::optional<FileRange> file, Priority priority,
+                                         std::optional<UploadStream> upload_stream = std::nullopt) const;
+
+    // a single attempt, without retries
+    [[nodiscard]] crt request_impl(boost::beast::http::verb method, std::string_view path,
+                                   bool is_path_encoded, std::string_view query,
+                                   boost::beast::http::fields headers,
+                                   std::span<const std::byte> body [[clang::lifetimebound]],
+                                   std::optional<FileRange> file, Priority priority,
+                                   std::optional<UploadStream> upload_stream = std::nullopt) const;
+
+    // sends a delayed copy of the request, for hedging
+    [[nodiscard]] crt hedge_impl(std::chrono::microseconds delay, boost::beast::http::verb method,
+                                 std::string_view path, bool is_path_encoded, std::string_view query,
+                                 boost::beast::http::fields headers, Priority priority) const;
+
+    // a single attempt, hedged if enabled
+    [[nodiscard]] crt attempt_impl(boost::beast::http::verb method, std::string_view path,
+                                   bool is_path_encoded, std::string_view query,
+                                   boost::beast::http::fields headers,
+                                   std::span<const std::byte> body [[clang::lifetimebound]],
+                                   std::optional<FileRange> file, Priority priority) const;
+
+    [[nodiscard]] crt retry_impl(boost::beast::http::verb method, std::string_view path, bool is_path_encoded,
+                                 std::string_view query, boost::beast::http::fields headers,
+                                 std::span<const std::byte> body [[clang::lifetimebound]],
+                                 std::optional<FileRange> file, Priority priority) const;
+
+    // makes sure one more connection for path is in the pool
+    [[nodiscard]] meta::crt<boost::asio::awaitable<boost::beast::error_code>>
+    connect_impl(std::string_view path) const;
+
+    [[nodiscard]] exchange_crt stream_impl(std::string_view path, std::string_view query,
+                                           boost::beast::http::fields headers, bool is_path_encoded,
+                                           Priority priority) const;
 
     [[nodiscard]] crt method_impl(boost::beast::http::verb method, std::string_view path,
                                   bool is_path_encoded, std::string_view query,
                                   boost::beast::http::fields headers,
-                                  std::span<const std::byte> body [[clang::lifetimebound]]) const;
+                                  std::span<const std::byte> body [[clang::lifetimebound]],
+                                  RequestOptions request_options,
+                                  std::optional<FileRange> file = std::nullopt) const;
 
 public:
-    [[nodiscard]] Session(iam::Session session);
+    // Sessions with the same endpoint, region and transport options share TLS state, DNS caches and
+    // connection pools, only the credentials and the retry and hedging state are their own.
+    // The first Session of the process parses the system CA store, which blocks for a moment.
+    [[nodiscard]] Session(iam::Session session, SessionOptions options = {});
+
+    // like the constructor, but never blocks the calling thread
+    [[nodiscard]] static create_crt create(iam::Session session, SessionOptions options = {});
+
+    // shared with all Sessions using the same connection pool
+    [[nodiscard]] ConnectionPoolStats connection_pool_stats() const;
+    [[nodiscard]] std::vector<EndpointStats> endpoint_stats() const;
+    // all zero unless SessionOptions::coalesce_requests is set
+    [[nodiscard]] CoalescingStats coalescing_stats() const;
+
+    // Rate limits apply at three levels: to the whole process, to all Sessions with the same endpoint, and to
+    // each Session. A request waits until every level has capacity, each attempt counts as a request.
+    // Bodies are paid for as they go over the wire, response bodies after they arrived.
+    // Limits can be changed at any time and apply to running transfers from their next read or write on.
+    void set_rate_limit(const RateLimit &limit);
+    void set_endpoint_rate_limit(const RateLimit &limit);
+    static void set_global_rate_limit(const RateLimit &limit);
+
+    // Opens and handshakes connections ahead of time, so that the first burst of requests doesn't pay for
+    // a connect storm. The connections are spread across addresses like requests and go to the pool as idle
+    // connections, where max_idle_per_host and idle_timeout apply to them. Idle connections already in the
+    // pool count towards the given number.
+    // path picks the bucket, which matters for virtual-hosted addressing.
+    // Returns how many connections are ready, or the first error if none are.
+    [[nodiscard]] warm_up_crt warm_up(std::size_t connections, std::string_view path = "/") const;
+
+    // Requests honor the cancellation slot they are awaited with.
+    // A cancelled request closes its connection right away and fails with operation_aborted.
 
     [[nodiscard]] [[clang::coro_wrapper]] crt get(std::string_view path, std::string_view query = "",
                                                   boost::beast::http::fields headers = {},
-                                                  bool is_path_encoded = false) const;
+                                                  bool is_path_encoded = false,
+                                                  RequestOptions request_options = {}) const;
+
+    // like get, but returns as soon as the header has arrived and leaves reading the body to the caller
+    // the timeout only covers receiving the header
+    [[nodiscard]] stream_crt get_stream(std::string_view path, std::string_view query = "",
+                                        boost::beast::http::fields headers = {}, bool is_path_encoded = false,
+                                        RequestOptions request_options = {}) const;
 
     [[nodiscard]] [[clang::coro_wrapper]] crt put(std::string_view path,
                                                   std::span<const std::byte> data [[clang::lifetimebound]],
                                                   boost::beast::http::fields headers = {},
-                                                  bool is_encoded = false);
+                                                  bool is_encoded = false,
+                                                  RequestOptions request_options = {});
     [[nodiscard]] [[clang::coro_wrapper]] crt put(std::string_view path,
                                                   std::string_view data [[clang::lifetimebound]],
                                                   boost::beast::http::fields headers = {},
-                                                  bool is_encoded = false);
+                                                  bool is_encoded = false,
+                                                  RequestOptions request_options = {});
+
+    // Transfers straight between a file and the connection.
+    // On plain HTTP, and on HTTPS with TlsOptions::kernel_tls once the kernel took over, the body moves
+    // with sendfile / splice and never gets copied through user space. Otherwise it goes through a small
+    // buffer, but the object is still never held in memory as a whole.
+
+    // uploads source, PayloadSigning::SIGNED is sent as UNSIGNED, hashing would read the whole file first
+    // with UNSIGNED_TRAILER and SIGNED_STREAMING the file goes through user space to be hashed
+    [[nodiscard]] [[clang::coro_wrapper]] crt put_file(std::string_view path, FileRange source,
+                                                       boost::beast::http::fields headers = {},
+                                                       bool is_encoded = false,
+                                                       RequestOptions request_options = {});
+    // Uploads what source produces, with bounded memory: the body goes out in chunks while they are read.
+    // PayloadSigning::SIGNED is sent as SIGNED_STREAMING, as the body can't be hashed before it is sent.
+    // A stream can't be rewound, so the upload is neither retried nor redirected.
+    [[nodiscard]] [[clang::coro_wrapper]] crt put_stream(std::string_view path, UploadStream source,
+                                                         boost::beast::http::fields headers = {},
+                                                         bool is_encoded = false,
+                                                         RequestOptions request_options = {});
+    // writes the body of a successful response to fd at offset and returns the response without it
+    // error responses are returned with their body as usual
+    [[nodiscard]] [[clang::coro_wrapper]] crt get_file(std::string_view path, int fd,
+                                                       std::uint64_t offset = 0, std::string_view query = "",
+                                                       boost::beast::http::fields headers = {},
+                                                       bool is_path_encoded = false,
+                                                       RequestOptions request_options = {}) const;
 };
 
 } // namespace s3cpp::aws::s3
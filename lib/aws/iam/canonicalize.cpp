@@ -1,113 +1,198 @@
 #include "s3cpp/aws/iam/canonicalize.hpp"
 
+#include "s3cpp/aws/iam/crypto.hpp"
 #include "s3cpp/meta.hpp"
 
-#include <boost/algorithm/string/case_conv.hpp>
 #include <boost/beast/http/field.hpp>
 #include <boost/beast/http/fields.hpp> // IWYU pragma: keep
 #include <boost/url/param.hpp>
 #include <boost/url/parse.hpp>
 #include <boost/url/url_view.hpp>
-#include <botan/hash.h>
-#include <botan/hex.h>
-#include <cassert>
+#include <algorithm>
+#include <array>
 #include <cstddef>
-#include <format>
-#include <functional>
-#include <map>
+#include <memory_resource>
 #include <span>
 #include <string>
 #include <string_view>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 namespace s3cpp::aws::iam::_internal {
 
-// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
-std::tuple<std::string, std::string> canonicalize_request(std::string_view method_string,
-                                                          std::string_view encoded_target_str,
-                                                          std::span<const std::byte> body,
-                                                          boost::beast::http::fields &headers) {
+namespace {
+
+// a query parameter or header, index picks the first of several with the same name
+struct Entry {
+    std::string_view name;
+    std::string_view value;
+    std::size_t index;
+};
+
+// sorted by name, keeping only the first of each name
+void sort_unique(std::pmr::vector<Entry> &entries) {
+    std::ranges::sort(entries, {}, [](const Entry &entry) { return std::tie(entry.name, entry.index); });
+    const auto [first, last] = std::ranges::unique(entries, {}, &Entry::name);
+    entries.erase(first, last);
+}
+
+[[nodiscard]] std::string_view trim(std::string_view value) {
+    if (const auto begin = value.find_first_not_of(' '); begin != std::string_view::npos) {
+        value = value.substr(begin);
+    }
+    if (const auto end = value.find_last_not_of(' '); end != std::string_view::npos) {
+        value = value.substr(0, end + 1);
+    }
+    return value;
+}
+
+[[nodiscard]] char to_lower(char chr) {
+    return chr >= 'A' && chr <= 'Z' ? static_cast<char>(chr - 'A' + 'a') : chr;
+}
+
+} // namespace
+
+// NOLINTBEGIN(bugprone-easily-swappable-parameters)
+template <typename Fields>
+std::tuple<std::pmr::string, std::pmr::string>
+canonicalize_request(std::string_view method_string, std::string_view encoded_target_str,
+                     std::span<const std::byte> body, Fields &headers, std::pmr::memory_resource *memory) {
     // see https://docs.aws.amazon.com/AmazonS3/latest/API/sig-v4-header-based-auth.html
     // for the canonicalization scheme
 
-    std::string ret;
     const boost::urls::url_view encoded_target = boost::urls::parse_origin_form(encoded_target_str).value();
+    const std::string_view path = encoded_target.encoded_path();
+
+    // the sorted names and the lowercased header names, only spills into memory for unusually large requests
+    std::array<std::byte, 4096> scratch_buffer; // NOLINT(cppcoreguidelines-pro-type-member-init)
+    std::pmr::monotonic_buffer_resource scratch{scratch_buffer.data(), scratch_buffer.size(), memory};
+
+    // the keys and values point into encoded_target_str
+    const auto encoded_params = encoded_target.encoded_params();
+    std::pmr::vector<Entry> params{&scratch};
+    params.reserve(encoded_params.size());
+    for (const auto &param : encoded_params) {
+        params.push_back({.name = static_cast<std::string_view>(param.key),
+                          .value = param.has_value ? static_cast<std::string_view>(param.value) : "",
+                          .index = params.size()});
+    }
+    sort_unique(params);
+
+    std::size_t header_count = 1;
+    std::size_t name_size = 0;
+    for (const auto &field : headers) {
+        header_count++;
+        name_size += field.name_string().size();
+    }
+    std::pmr::string lower_names{&scratch};
+    lower_names.resize(name_size);
+    std::pmr::vector<Entry> signed_fields{&scratch};
+    signed_fields.reserve(header_count);
+    signed_fields.push_back(
+        {.name = "host", .value = trim(headers.find(boost::beast::http::field::host)->value()), .index = 0});
+    char *lower_out = lower_names.data();
+    for (const auto &field : headers) {
+        const std::string_view name = field.name_string();
+        std::ranges::transform(name, lower_out, to_lower);
+        const std::string_view lower{lower_out, name.size()};
+        if (lower.starts_with("x-amz-") || lower == "content-md5") {
+            signed_fields.push_back(
+                {.name = lower, .value = trim(field.value()), .index = signed_fields.size()});
+            lower_out += name.size();
+        }
+    }
+    sort_unique(signed_fields);
+
+    sha256_hex payload_hash{};
+    std::string_view hash_header = headers["x-amz-content-sha256"];
+    const bool hash_payload = hash_header.empty();
+    if (hash_payload) {
+        payload_hash = hex_encode(sha256(std::string_view{
+            meta::safe_reinterpret_cast<const std::string_view::value_type *>(body.data()), body.size()}));
+        hash_header = to_string_view(payload_hash);
+    }
+
+    // sized up front so that both strings are allocated exactly once
+    std::size_t query_size = 0;
+    for (const auto &param : params) {
+        query_size += param.name.size() + 1 + param.value.size() + 1;
+    }
+    std::size_t headers_size = 0;
+    std::size_t signed_headers_size = 0;
+    for (const auto &field : signed_fields) {
+        headers_size += field.name.size() + 1 + field.value.size() + 1;
+        signed_headers_size += field.name.size() + 1;
+    }
+    // the trailing separators
+    query_size -= params.empty() ? 0 : 1;
+    signed_headers_size--;
+
+    std::pmr::string signed_headers{memory};
+    signed_headers.reserve(signed_headers_size);
+    for (const auto &field : signed_fields) {
+        signed_headers.append(field.name);
+        signed_headers.push_back(';');
+    }
+    signed_headers.pop_back();
+
+    std::pmr::string ret{memory};
+    ret.reserve(method_string.size() + 1 + path.size() + 1 + query_size + 1 + headers_size + 1 +
+                signed_headers_size + 1 + hash_header.size());
 
     // HTTPMethod
     ret.append(method_string);
-    ret.append("\n");
+    ret.push_back('\n');
 
     // CanonicalURI
-    ret.append(encoded_target.encoded_path());
-    ret.append("\n");
+    ret.append(path);
+    ret.push_back('\n');
 
     // CanonicalQueryString
-    // use a map to get them in order
-    std::map<std::string, boost::urls::param_pct_view, std::less<>> params;
-    for (const auto &param : encoded_target.encoded_params()) {
-        params.emplace(param.key, param);
-    }
-    for (const auto &[key, param] : params) {
-        ret.append(std::format("{}={}&", static_cast<std::string_view>(param.key),
-                               static_cast<std::string_view>(param.has_value ? param.value : "")));
+    for (const auto &param : params) {
+        ret.append(param.name);
+        ret.push_back('=');
+        ret.append(param.value);
+        ret.push_back('&');
     }
     if (!params.empty()) {
         ret.pop_back();
     }
-    ret.append("\n");
+    ret.push_back('\n');
 
     // CanonicalHeaders
-    // use a map to get them in order
-    std::map<std::string, decltype(headers.cbegin()), std::less<>> headers_;
-    headers_.emplace("host", headers.find(boost::beast::http::field::host));
-
-    for (auto iter = headers.cbegin(); iter != headers.cend(); iter++) {
-        std::string lower = iter->name_string();
-        boost::algorithm::to_lower(lower);
-        if (lower.starts_with("x-amz-")) {
-            headers_.emplace(lower, iter);
-        }
-        if (lower == "content-md5") {
-            headers_.emplace(lower, iter);
-        }
+    for (const auto &field : signed_fields) {
+        // TODO: multi-value
+        ret.append(field.name);
+        ret.push_back(':');
+        ret.append(field.value);
+        ret.push_back('\n');
     }
-    for (const auto &[header_name, header] : headers_) {
-        std::string_view value = header->value();
-        if (const auto begin = value.find_first_not_of(' '); begin != std::string_view::npos) {
-            value = value.substr(begin);
-        }
-        if (const auto end = value.find_last_not_of(' '); end != std::string_view::npos) {
-            value = value.substr(0, end + 1);
-        }
-        ret.append(
-            // TODO: multi-value
-            std::format("{}:{}\n", header_name, value));
-    }
-    ret.append("\n");
+    ret.push_back('\n');
 
     // SignedHeaders
-    std::string signed_headers;
-    for (const auto &[header_name, header_value] : headers_) {
-        signed_headers.append(std::format("{};", header_name));
-    }
-    signed_headers.pop_back();
     ret.append(signed_headers);
-    ret.append("\n");
+    ret.push_back('\n');
 
-    // HashedPayload
-    std::string_view hash_header = headers["x-amz-content-sha256"];
-    if (hash_header.empty()) {
-        auto hash = Botan::HashFunction::create_or_throw("SHA-256");
-        hash->update(std::string_view{
-            meta::safe_reinterpret_cast<const std::string_view::value_type *>(body.data()), body.size()});
-        headers.set("x-amz-content-sha256", Botan::hex_encode(hash->final_stdvec(), false));
-        hash_header = headers["x-amz-content-sha256"];
-    }
+    // HashedPayload, streaming uploads are signed with their mode here, such as
+    // STREAMING-AWS4-HMAC-SHA256-PAYLOAD, and their chunks by s3::_internal::ChunkEncoder
     ret.append(hash_header);
-    // TODO: support chunked
+
+    // only now, the header values above may point into the field that this replaces
+    if (hash_payload) {
+        headers.set("x-amz-content-sha256", hash_header);
+    }
 
     return {std::move(ret), std::move(signed_headers)};
 }
+// NOLINTEND(bugprone-easily-swappable-parameters)
+
+template std::tuple<std::pmr::string, std::pmr::string>
+canonicalize_request(std::string_view method_string, std::string_view encoded_target_str,
+                     std::span<const std::byte> body, boost::beast::http::fields &headers,
+                     std::pmr::memory_resource *memory);
+template std::tuple<std::pmr::string, std::pmr::string>
+canonicalize_request(std::string_view method_string, std::string_view encoded_target_str,
+                     std::span<const std::byte> body, pmr_fields &headers, std::pmr::memory_resource *memory);
 
 } // namespace s3cpp::aws::iam::_internal
@@ -0,0 +1,116 @@
+#include "s3cpp/aws/iam/crypto.hpp"
+
+#include <algorithm>
+#include <array>
+#include <botan/hash.h>
+#include <botan/mac.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace s3cpp::aws::iam::_internal {
+
+namespace {
+
+constexpr std::string_view hex_digits = "0123456789abcdef";
+
+struct Hmac {
+    std::unique_ptr<Botan::MessageAuthenticationCode> mac =
+        Botan::MessageAuthenticationCode::create_or_throw("HMAC(SHA-256)");
+    sha256_digest key{};
+    bool keyed = false;
+};
+
+[[nodiscard]] Botan::HashFunction &thread_sha256() {
+    thread_local const std::unique_ptr<Botan::HashFunction> hash =
+        Botan::HashFunction::create_or_throw("SHA-256");
+    return *hash;
+}
+
+[[nodiscard]] Hmac &thread_hmac() {
+    thread_local Hmac hmac;
+    return hmac;
+}
+
+void hex_encode_scalar(std::span<const std::uint8_t> in, char *out) {
+    for (const std::uint8_t byte : in) {
+        *out++ = hex_digits[byte >> 4];
+        *out++ = hex_digits[byte & 0x0f];
+    }
+}
+
+} // namespace
+
+sha256_digest sha256(std::string_view data) {
+    Botan::HashFunction &hash = thread_sha256();
+    hash.update(data);
+    sha256_digest ret;
+    // also resets the hash for the next call
+    hash.final(ret.data());
+    return ret;
+}
+
+sha256_digest hmac_sha256(std::span<const std::uint8_t> key, std::string_view data) {
+    Hmac &hmac = thread_hmac();
+    // signing keys are exactly one digest long, anything else is keyed every time
+    if (!hmac.keyed || key.size() != hmac.key.size() || !std::ranges::equal(key, hmac.key)) {
+        hmac.mac->set_key(key);
+        hmac.keyed = key.size() == hmac.key.size();
+        if (hmac.keyed) {
+            std::ranges::copy(key, hmac.key.begin());
+        }
+    }
+    hmac.mac->update(data);
+    sha256_digest ret;
+    // leaves the MAC keyed with the same key
+    hmac.mac->final(ret.data());
+    return ret;
+}
+
+void hex_encode(std::span<const std::uint8_t> in, char *out) {
+    std::size_t i = 0;
+#if defined(__SSE2__)
+    // nibble + '0', plus the distance to 'a' for nibbles above 9
+    const __m128i low_mask = _mm_set1_epi8(0x0f);
+    const __m128i zero = _mm_set1_epi8('0');
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i letter_offset = _mm_set1_epi8('a' - '0' - 10);
+    const auto to_hex = [&](__m128i nibbles) {
+        const __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(nibbles, nine), letter_offset);
+        return _mm_add_epi8(_mm_add_epi8(nibbles, zero), letters);
+    };
+    for (; i + 16 <= in.size(); i += 16) {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in.data() + i));
+        const __m128i high = to_hex(_mm_and_si128(_mm_srli_epi16(bytes, 4), low_mask));
+        const __m128i low = to_hex(_mm_and_si128(bytes, low_mask));
+        // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + (2 * i)), _mm_unpacklo_epi8(high, low));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + (2 * i) + 16), _mm_unpackhi_epi8(high, low));
+        // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
+    }
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    const uint8x16_t table = vld1q_u8(reinterpret_cast<const std::uint8_t *>(hex_digits.data()));
+    const uint8x16_t low_mask = vdupq_n_u8(0x0f);
+    for (; i + 16 <= in.size(); i += 16) {
+        const uint8x16_t bytes = vld1q_u8(in.data() + i);
+        const uint8x16x2_t hex{{vqtbl1q_u8(table, vshrq_n_u8(bytes, 4)),
+                                vqtbl1q_u8(table, vandq_u8(bytes, low_mask))}};
+        // stores the two vectors interleaved, high nibble first
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        vst2q_u8(reinterpret_cast<std::uint8_t *>(out + (2 * i)), hex);
+    }
+#endif
+    hex_encode_scalar(in.subspan(i), out + (2 * i));
+}
+
+} // namespace s3cpp::aws::iam::_internal
@@ -0,0 +1,131 @@
+#include "s3cpp/aws/iam/presign.hpp"
+
+#include "s3cpp/aws/iam/crypto.hpp"
+#include "s3cpp/aws/iam/session.hpp"
+#include "s3cpp/aws/iam/sign_request.hpp"
+#include "s3cpp/aws/iam/string_to_sign.hpp"
+#include "s3cpp/aws/iam/urlencode.hpp"
+#include "s3cpp/aws/scope.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <format>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace s3cpp::aws::iam {
+
+namespace {
+
+constexpr std::string_view signature_param = "&X-Amz-Signature=";
+
+// fewer than this per thread isn't worth starting it
+constexpr std::size_t min_urls_per_thread = 1024;
+
+// the buffers every URL on a thread is built in
+struct Scratch {
+    std::string encoded_path;
+    std::string canonical_request;
+    std::string string_to_sign;
+};
+
+[[nodiscard]] Scratch &thread_scratch() {
+    thread_local Scratch scratch;
+    return scratch;
+}
+
+} // namespace
+
+Presigner::Presigner(const Session &session, const PresignOptions &options) {
+    if (options.expires < std::chrono::seconds{1} || options.expires > std::chrono::weeks{1}) {
+        throw std::runtime_error{std::format("presigned URLs expire after 1 to 604800 seconds, not {}",
+                                             options.expires.count())};
+    }
+
+    const std::string timestamp = format_timestamp(std::chrono::floor<std::chrono::seconds>(options.time));
+    const Scope scope{
+        .timestamp = timestamp.substr(0, 8), .region = session.region, .service = options.service};
+    const std::string credential_scope = std::format("{}", scope);
+    signing_key_ = get_signing_key(session.secret_access_key, scope);
+
+    const auto host = static_cast<std::string_view>(session.endpoint.encoded_host_and_port());
+    origin_ = std::format("{}://{}", static_cast<std::string_view>(session.endpoint.scheme()), host);
+    query_ = std::format("X-Amz-Algorithm=AWS4-HMAC-SHA256&X-Amz-Credential={}&X-Amz-Date={}"
+                         "&X-Amz-Expires={}&X-Amz-SignedHeaders=host",
+                         urlencode(std::format("{}/{}", session.access_key, credential_scope)), timestamp,
+                         options.expires.count());
+    // GET\n<path>\n<query>\nhost:<host>\n\nhost\nUNSIGNED-PAYLOAD
+    canonical_suffix_ = std::format("\n{}\nhost:{}\n\nhost\nUNSIGNED-PAYLOAD", query_, host);
+    string_to_sign_prefix_ = std::format("AWS4-HMAC-SHA256\n{}\n{}\n", timestamp, credential_scope);
+}
+
+void Presigner::presign_get_to(std::string &out, std::string_view path, bool is_encoded) const {
+    Scratch &scratch = thread_scratch();
+    if (!is_encoded && urlencode_path_required(path)) {
+        scratch.encoded_path.resize_and_overwrite(3 * path.size(), [path](char *out, std::size_t /*size*/) {
+            return static_cast<std::size_t>(urlencode_path_to(path, out) - out);
+        });
+        path = scratch.encoded_path;
+    }
+
+    scratch.canonical_request.assign("GET\n");
+    scratch.canonical_request.append(path);
+    scratch.canonical_request.append(canonical_suffix_);
+
+    scratch.string_to_sign.assign(string_to_sign_prefix_);
+    const std::size_t hash_offset = scratch.string_to_sign.size();
+    scratch.string_to_sign.resize(hash_offset + (2 * _internal::sha256_digest{}.size()));
+    _internal::hex_encode(_internal::sha256(scratch.canonical_request),
+                          scratch.string_to_sign.data() + hash_offset);
+    const _internal::sha256_hex signature =
+        _internal::hex_encode(_internal::hmac_sha256(signing_key_, scratch.string_to_sign));
+
+    out.reserve(out.size() + origin_.size() + path.size() + 1 + query_.size() + signature_param.size() +
+                signature.size());
+    out.append(origin_);
+    out.append(path);
+    out.push_back('?');
+    out.append(query_);
+    out.append(signature_param);
+    out.append(_internal::to_string_view(signature));
+}
+
+std::string Presigner::presign_get(std::string_view path, bool is_encoded) const {
+    std::string ret;
+    presign_get_to(ret, path, is_encoded);
+    return ret;
+}
+
+std::vector<std::string> Presigner::presign_get(std::span<const std::string_view> paths, bool is_encoded,
+                                                std::size_t threads) const {
+    std::vector<std::string> ret(paths.size());
+    if (threads == 0) {
+        threads = std::max(std::thread::hardware_concurrency(), 1U);
+    }
+    threads = std::clamp<std::size_t>(paths.size() / min_urls_per_thread, 1, threads);
+    const std::size_t per_thread = (paths.size() + threads - 1) / threads;
+
+    const auto sign_range = [&](std::size_t begin) {
+        const std::size_t end = std::min(begin + per_thread, paths.size());
+        for (std::size_t i = begin; i < end; i++) {
+            presign_get_to(ret[i], paths[i], is_encoded);
+        }
+    };
+    {
+        std::vector<std::jthread> workers;
+        workers.reserve(threads - 1);
+        for (std::size_t thread = 1; thread < threads; thread++) {
+            workers.emplace_back(sign_range, thread * per_thread);
+        }
+        // the calling thread takes the first share
+        sign_range(0);
+    }
+    return ret;
+}
+
+} // namespace s3cpp::aws::iam
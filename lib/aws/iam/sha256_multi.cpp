@@ -0,0 +1,321 @@
+#include "s3cpp/aws/iam/crypto.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <cpuid.h>
+#define S3CPP_SHA256_MULTI_BUFFER
+#endif
+
+// Multi-buffer SHA-256: N independent messages are hashed at once, message i in lane i of every vector.
+// A single message can't be vectorized this way as each block depends on the one before it, but the
+// rounds of different messages are independent and map one to one onto the lanes.
+// The kernels are written once with GCC vector extensions and instantiated for SSE2, AVX2 and AVX-512,
+// the widest one the CPU supports is picked at runtime.
+
+namespace s3cpp::aws::iam::_internal {
+
+namespace {
+
+#ifdef S3CPP_SHA256_MULTI_BUFFER
+
+using u32x4 = std::uint32_t __attribute__((vector_size(16)));
+using u32x8 = std::uint32_t __attribute__((vector_size(32)));
+using u32x16 = std::uint32_t __attribute__((vector_size(64)));
+
+constexpr std::array<std::uint32_t, 8> initial_state{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                                     0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+constexpr std::array<std::uint32_t, 64> round_constants{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+// the padding of a message is at most two blocks
+constexpr std::size_t block_size = 64;
+constexpr std::array<std::uint8_t, block_size> idle_block{};
+
+// Everything below is inlined into the kernels, so that it is compiled for their instruction set.
+#define S3CPP_SHA256_INLINE [[gnu::always_inline]] inline
+
+// a macro rather than a function, returning a vector from a function without AVX changes its ABI
+#define S3CPP_SHA256_ROTR(value, bits) (((value) >> (bits)) | ((value) << (32 - (bits))))
+
+// one block of every lane, state[i][lane] is word i of that lane's state
+template <typename V, std::size_t Lanes>
+S3CPP_SHA256_INLINE void compress(std::array<V, 8> &state,
+                                  const std::array<const std::uint8_t *, Lanes> &blocks) {
+    // transposed through memory, the lanes' blocks are rarely adjacent
+    alignas(64) std::array<std::array<std::uint32_t, Lanes>, 16> words;
+    for (std::size_t lane = 0; lane < Lanes; lane++) {
+        for (std::size_t i = 0; i < 16; i++) {
+            std::uint32_t word = 0;
+            std::memcpy(&word, blocks[lane] + (4 * i), sizeof(word));
+            words[i][lane] = __builtin_bswap32(word);
+        }
+    }
+    std::array<V, 16> schedule;
+    for (std::size_t i = 0; i < 16; i++) {
+        std::memcpy(&schedule[i], words[i].data(), sizeof(V));
+    }
+
+    V a = state[0];
+    V b = state[1];
+    V c = state[2];
+    V d = state[3];
+    V e = state[4];
+    V f = state[5];
+    V g = state[6];
+    V h = state[7];
+    // unrolled, the schedule stays in registers instead of being indexed in memory
+#pragma GCC unroll 64
+    for (std::size_t i = 0; i < 64; i++) {
+        if (i >= 16) {
+            const V w15 = schedule[(i - 15) % 16];
+            const V w2 = schedule[(i - 2) % 16];
+            const V sigma0 = S3CPP_SHA256_ROTR(w15, 7) ^ S3CPP_SHA256_ROTR(w15, 18) ^ (w15 >> 3);
+            const V sigma1 = S3CPP_SHA256_ROTR(w2, 17) ^ S3CPP_SHA256_ROTR(w2, 19) ^ (w2 >> 10);
+            schedule[i % 16] += sigma0 + schedule[(i - 7) % 16] + sigma1;
+        }
+        const V big_sigma1 = S3CPP_SHA256_ROTR(e, 6) ^ S3CPP_SHA256_ROTR(e, 11) ^ S3CPP_SHA256_ROTR(e, 25);
+        const V big_sigma0 = S3CPP_SHA256_ROTR(a, 2) ^ S3CPP_SHA256_ROTR(a, 13) ^ S3CPP_SHA256_ROTR(a, 22);
+        const V t1 = h + big_sigma1 + ((e & f) ^ (~e & g)) + round_constants[i] + schedule[i % 16];
+        const V t2 = big_sigma0 + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+// a message in a lane, its whole blocks are read in place and the rest from tail
+struct Job {
+    std::size_t index = 0;
+    const std::uint8_t *data = nullptr;
+    std::size_t whole_blocks = 0;
+    std::size_t blocks = 0;
+    std::size_t next = 0;
+    std::array<std::uint8_t, 2 * block_size> tail{};
+};
+
+void start_job(Job &job, std::size_t index, std::string_view message) {
+    job.index = index;
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    job.data = reinterpret_cast<const std::uint8_t *>(message.data());
+    job.whole_blocks = message.size() / block_size;
+    job.next = 0;
+
+    // the rest of the message, 0x80, zeros and the length in bits, big-endian
+    const std::size_t rest = message.size() % block_size;
+    job.blocks = job.whole_blocks + (rest + 1 + 8 > block_size ? 2 : 1);
+    job.tail.fill(0);
+    std::memcpy(job.tail.data(), message.data() + (job.whole_blocks * block_size), rest);
+    job.tail[rest] = 0x80;
+    const std::size_t tail_size = (job.blocks - job.whole_blocks) * block_size;
+    std::uint64_t bits = static_cast<std::uint64_t>(message.size()) * 8;
+    for (std::size_t i = 0; i < 8; i++) {
+        job.tail[tail_size - 1 - i] = static_cast<std::uint8_t>(bits);
+        bits >>= 8;
+    }
+}
+
+[[nodiscard]] const std::uint8_t *next_block(const Job &job) {
+    if (job.next < job.whole_blocks) {
+        return job.data + (job.next * block_size);
+    }
+    return job.tail.data() + ((job.next - job.whole_blocks) * block_size);
+}
+
+// Longest messages first, a lane that finishes takes the next one. That way the lanes run out of work at
+// about the same time and few blocks are hashed with lanes idling.
+// Sizes that differ a lot still leave the longest messages running nearly alone at the end, each block
+// costing a full transposition and compression of every lane. Once fewer than half the lanes are busy,
+// the messages with more than half their blocks left are hashed by sha256 instead.
+template <typename V, std::size_t Lanes>
+S3CPP_SHA256_INLINE void sha256_lanes(std::span<const std::string_view> data,
+                                      std::span<sha256_digest> out) {
+    std::vector<std::size_t> order(data.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::ranges::sort(order, std::ranges::greater{}, [&data](std::size_t i) { return data[i].size(); });
+
+    std::array<Job, Lanes> jobs;
+    std::array<bool, Lanes> busy{};
+    std::array<V, 8> state;
+    std::size_t queued = 0;
+
+    const auto start = [&](std::size_t lane) {
+        if (queued == order.size()) {
+            busy[lane] = false;
+            return;
+        }
+        const std::size_t index = order[queued++];
+        start_job(jobs[lane], index, data[index]);
+        busy[lane] = true;
+        for (std::size_t i = 0; i < 8; i++) {
+            state[i][lane] = initial_state[i];
+        }
+    };
+    std::vector<std::size_t> unbatched;
+    const auto shed = [&] {
+        if (queued < order.size() || 2 * static_cast<std::size_t>(std::ranges::count(busy, true)) >= Lanes) {
+            return;
+        }
+        for (std::size_t lane = 0; lane < Lanes; lane++) {
+            if (busy[lane] && jobs[lane].blocks - jobs[lane].next > jobs[lane].next) {
+                unbatched.push_back(jobs[lane].index);
+                busy[lane] = false;
+            }
+        }
+    };
+    for (std::size_t lane = 0; lane < Lanes; lane++) {
+        start(lane);
+    }
+    shed();
+
+    std::array<const std::uint8_t *, Lanes> blocks;
+    while (std::ranges::any_of(busy, [](bool lane_busy) { return lane_busy; })) {
+        for (std::size_t lane = 0; lane < Lanes; lane++) {
+            blocks[lane] = busy[lane] ? next_block(jobs[lane]) : idle_block.data();
+        }
+        compress<V, Lanes>(state, blocks);
+        for (std::size_t lane = 0; lane < Lanes; lane++) {
+            if (!busy[lane] || ++jobs[lane].next < jobs[lane].blocks) {
+                continue;
+            }
+            sha256_digest &digest = out[jobs[lane].index];
+            for (std::size_t i = 0; i < 8; i++) {
+                const std::uint32_t word = __builtin_bswap32(state[i][lane]);
+                std::memcpy(digest.data() + (4 * i), &word, sizeof(word));
+            }
+            start(lane);
+        }
+        shed();
+    }
+    for (const std::size_t index : unbatched) {
+        out[index] = sha256(data[index]);
+    }
+}
+
+#undef S3CPP_SHA256_ROTR
+#undef S3CPP_SHA256_INLINE
+
+void sha256_x4(std::span<const std::string_view> data, std::span<sha256_digest> out) {
+    sha256_lanes<u32x4, 4>(data, out);
+}
+
+[[gnu::target("avx2")]] void sha256_x8(std::span<const std::string_view> data,
+                                        std::span<sha256_digest> out) {
+    sha256_lanes<u32x8, 8>(data, out);
+}
+
+[[gnu::target("avx512f")]] void sha256_x16(std::span<const std::string_view> data,
+                                            std::span<sha256_digest> out) {
+    sha256_lanes<u32x16, 16>(data, out);
+}
+
+#endif
+
+void sha256_each(std::span<const std::string_view> data, std::span<sha256_digest> out) {
+    for (std::size_t i = 0; i < data.size(); i++) {
+        out[i] = sha256(data[i]);
+    }
+}
+
+using batch_kernel = void (*)(std::span<const std::string_view>, std::span<sha256_digest>);
+
+struct Kernel {
+    batch_kernel run;
+    std::size_t lanes;
+};
+
+[[nodiscard]] Kernel select_kernel() {
+#ifdef S3CPP_SHA256_MULTI_BUFFER
+    __builtin_cpu_init();
+    // sixteen lanes outrun the SHA extensions, eight and four only outrun plain scalar code
+    if (__builtin_cpu_supports("avx512f")) {
+        return {.run = sha256_x16, .lanes = 16};
+    }
+    unsigned int eax = 0;
+    unsigned int ebx = 0;
+    unsigned int ecx = 0;
+    unsigned int edx = 0;
+    const bool has_sha = __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) != 0 && (ebx & bit_SHA) != 0;
+    if (has_sha) {
+        // Botan uses them on its own
+        return {.run = sha256_each, .lanes = 1};
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return {.run = sha256_x8, .lanes = 8};
+    }
+    return {.run = sha256_x4, .lanes = 4};
+#else
+    return {.run = sha256_each, .lanes = 1};
+#endif
+}
+
+[[nodiscard]] const Kernel &kernel() {
+    static const Kernel ret = select_kernel();
+    return ret;
+}
+
+} // namespace
+
+std::size_t sha256_batch_lanes() { return kernel().lanes; }
+
+void sha256_batch(std::span<const std::string_view> data, std::span<sha256_digest> out) {
+    if (data.size() < 2) {
+        sha256_each(data, out);
+        return;
+    }
+    kernel().run(data, out);
+}
+
+bool sha256_batch_on(std::size_t lanes, std::span<const std::string_view> data,
+                     std::span<sha256_digest> out) {
+    batch_kernel run = nullptr;
+    if (lanes == 1) {
+        run = sha256_each;
+    }
+#ifdef S3CPP_SHA256_MULTI_BUFFER
+    __builtin_cpu_init();
+    if (lanes == 4) {
+        run = sha256_x4;
+    } else if (lanes == 8 && __builtin_cpu_supports("avx2")) {
+        run = sha256_x8;
+    } else if (lanes == 16 && __builtin_cpu_supports("avx512f")) {
+        run = sha256_x16;
+    }
+#endif
+    if (run == nullptr) {
+        return false;
+    }
+    run(data, out);
+    return true;
+}
+
+} // namespace s3cpp::aws::iam::_internal
@@ -1,14 +1,14 @@
 #include "s3cpp/aws/iam/sign_request.hpp"
 
+#include "s3cpp/aws/iam/crypto.hpp"
 #include "s3cpp/aws/iam/string_to_sign.hpp"
 #include "s3cpp/aws/scope.hpp"
 
-#include <botan/hex.h>
-#include <botan/mac.h>
-#include <cassert>
 #include <cstdint>
 #include <format>
 #include <iterator>
+#include <memory_resource>
+#include <span>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -20,64 +20,47 @@ namespace s3cpp::aws::iam {
 
 std::vector<uint8_t> get_signing_key(std::string_view secret_access_key, const Scope &scope) {
 
-    auto hmac = Botan::MessageAuthenticationCode::create_or_throw("HMAC(SHA-256)");
-    assert(hmac != nullptr);
+    std::vector<uint8_t> secret_key;
+    secret_key.reserve(256);
+    std::format_to(std::back_inserter(secret_key), "AWS4{}", secret_access_key);
 
-    std::vector<uint8_t> hmac_key;
+    const _internal::sha256_digest date_key = _internal::hmac_sha256(secret_key, scope.timestamp);
+    const _internal::sha256_digest date_region_key = _internal::hmac_sha256(date_key, scope.region);
+    const _internal::sha256_digest date_region_service_key =
+        _internal::hmac_sha256(date_region_key, scope.service);
+    const _internal::sha256_digest signing_key =
+        _internal::hmac_sha256(date_region_service_key, Scope::footer);
 
-    hmac_key.reserve(256);
-    std::format_to(std::back_inserter(hmac_key), "AWS4{}", secret_access_key);
-
-    // DateKey
-    hmac->set_key(hmac_key);
-    hmac->update(scope.timestamp);
-
-    hmac_key.clear();
-
-    hmac->final(hmac_key);
-    hmac->clear();
-
-    // DateRegionKey
-    hmac->set_key(hmac_key);
-    hmac->update(scope.region);
-
-    hmac_key.clear();
-
-    hmac->final(hmac_key);
-    hmac->clear();
-
-    // DateRegionServiceKey
-    hmac->set_key(hmac_key);
-    hmac->update(scope.service);
-
-    hmac_key.clear();
-
-    hmac->final(hmac_key);
-    hmac->clear();
-
-    // SigningKey
-    hmac->set_key(hmac_key);
-    hmac->update(Scope::footer);
-
-    return hmac->final_stdvec();
+    return {signing_key.begin(), signing_key.end()};
 }
 
 // NOLINTBEGIN(bugprone-easily-swappable-parameters)
-std::string sign_request(std::string_view access_key, std::string_view secret_access_key,
-                         std::string_view canonical_request, std::string_view signed_headers,
-                         std::string_view timestamp, const Scope &scope) {
-
-    auto hmac = Botan::MessageAuthenticationCode::create_or_throw("HMAC(SHA-256)");
-    assert(hmac != nullptr);
-
-    hmac->set_key(get_signing_key(secret_access_key, scope));
-    const std::string string_to_sign_ = string_to_sign(canonical_request, scope, timestamp);
-    hmac->update(string_to_sign_);
-
-    const std::string signature = Botan::hex_encode(hmac->final(), false);
+std::pmr::string sign_request(std::string_view access_key, std::string_view secret_access_key,
+                              std::string_view canonical_request, std::string_view signed_headers,
+                              std::string_view timestamp, const Scope &scope,
+                              std::pmr::memory_resource *memory) {
+
+    std::pmr::string credential_scope{memory};
+    std::format_to(std::back_inserter(credential_scope), "{}", scope);
+    return sign_request_with_key(access_key, get_signing_key(secret_access_key, scope), canonical_request,
+                                 signed_headers, timestamp, credential_scope, memory);
+}
 
-    return std::format("AWS4-HMAC-SHA256 Credential={}/{},SignedHeaders={},Signature={}", access_key, scope,
-                       signed_headers, signature);
+std::pmr::string sign_request_with_key(std::string_view access_key, std::span<const std::uint8_t> signing_key,
+                                       std::string_view canonical_request, std::string_view signed_headers,
+                                       std::string_view timestamp, std::string_view credential_scope,
+                                       std::pmr::memory_resource *memory) {
+
+    const std::pmr::string string_to_sign_ =
+        string_to_sign(canonical_request, credential_scope, timestamp, memory);
+    const _internal::sha256_hex signature =
+        _internal::hex_encode(_internal::hmac_sha256(signing_key, string_to_sign_));
+
+    std::pmr::string ret{memory};
+    std::format_to(std::back_inserter(ret), "AWS4-HMAC-SHA256 Credential={}/{},SignedHeaders={},Signature={}",
+                   access_key, credential_scope, signed_headers,
+                   _internal::to_string_view(signature));
+    return ret;
 }
 // NOLINTEND(bugprone-easily-swappable-parameters)
 
@@ -1,26 +1,35 @@
 #include "s3cpp/aws/iam/string_to_sign.hpp"
 
+#include "s3cpp/aws/iam/crypto.hpp"
 #include "s3cpp/aws/scope.hpp"
 
-#include <botan/hash.h>
-#include <botan/hex.h>
-#include <cassert>
+#include <cstddef>
 #include <format>
+#include <iterator>
+#include <memory_resource>
 #include <string>
 #include <string_view>
 
 namespace s3cpp::aws::iam {
 
-std::string string_to_sign(std::string_view canonical_request, const Scope &scope,
-                           std::string_view timestamp) {
+std::pmr::string string_to_sign(std::string_view canonical_request, const Scope &scope,
+                                std::string_view timestamp, std::pmr::memory_resource *memory) {
+    std::pmr::string credential_scope{memory};
+    std::format_to(std::back_inserter(credential_scope), "{}", scope);
+    return string_to_sign(canonical_request, std::string_view{credential_scope}, timestamp, memory);
+}
 
-    auto hash = Botan::HashFunction::create_or_throw("SHA-256");
-    assert(hash != nullptr);
-    hash->update(canonical_request);
+std::pmr::string string_to_sign(std::string_view canonical_request, std::string_view credential_scope,
+                                std::string_view timestamp, std::pmr::memory_resource *memory) {
 
-    const std::string digest = Botan::hex_encode(hash->final(), false);
+    const _internal::sha256_digest digest = _internal::sha256(canonical_request);
 
-    return std::format("AWS4-HMAC-SHA256\n{}\n{}\n{}", timestamp, scope, digest);
+    std::pmr::string ret{memory};
+    std::format_to(std::back_inserter(ret), "AWS4-HMAC-SHA256\n{}\n{}\n", timestamp, credential_scope);
+    const std::size_t offset = ret.size();
+    ret.resize(offset + (digest.size() * 2));
+    _internal::hex_encode(digest, ret.data() + offset);
+    return ret;
 }
 
 } // namespace s3cpp::aws::iam
@@ -1,39 +1,371 @@
 #include "s3cpp/aws/iam/urlencode.hpp"
 
-#include <boost/url/encode.hpp> // IWYU pragma: keep
-#include <boost/url/grammar/charset.hpp>
-#include <boost/url/grammar/lut_chars.hpp>
+#include <array>
+#include <atomic>
+#include <boost/system/error_code.hpp>
+#include <boost/url/error.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <expected>
 #include <string>
 #include <string_view>
 
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define S3CPP_URLENCODE_X86
+#endif
+
+// Both directions copy runs of bytes that stay as they are, which is nearly all of a typical key, a vector
+// at a time: a block whose bytes all pass is stored as is, only blocks with something to escape or unescape
+// go byte by byte. The widest kernel the CPU supports is picked at runtime.
+
 namespace s3cpp::aws::iam {
 
 namespace {
 
-constexpr boost::urls::grammar::lut_chars charset = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-                                                    "abcdefghijklmnopqrstuvwxyz"
-                                                    "1234567890"
-                                                    "-._~";
+enum class Charset : std::uint8_t {
+    // ALPHA / DIGIT / -._~
+    UNRESERVED,
+    // and /
+    PATH,
+};
+
+constexpr std::string_view hex_digits_upper = "0123456789ABCDEF";
+
+[[nodiscard]] constexpr bool is_unreserved(unsigned char chr) {
+    return (chr >= 'A' && chr <= 'Z') || (chr >= 'a' && chr <= 'z') || (chr >= '0' && chr <= '9') ||
+           chr == '-' || chr == '.' || chr == '_' || chr == '~';
+}
+
+template <Charset charset> constexpr std::array<bool, 256> make_passes() {
+    std::array<bool, 256> ret{};
+    for (std::size_t chr = 0; chr < ret.size(); chr++) {
+        ret[chr] = is_unreserved(static_cast<unsigned char>(chr)) || (charset == Charset::PATH && chr == '/');
+    }
+    return ret;
+}
+
+template <Charset charset> constexpr std::array<bool, 256> passes = make_passes<charset>();
+
+// the value of a hex digit, or -1
+constexpr std::array<std::int8_t, 256> hex_values = []() {
+    std::array<std::int8_t, 256> ret{};
+    ret.fill(-1);
+    for (std::size_t i = 0; i < 10; i++) {
+        ret['0' + i] = static_cast<std::int8_t>(i);
+    }
+    for (std::size_t i = 0; i < 6; i++) {
+        ret['a' + i] = static_cast<std::int8_t>(10 + i);
+        ret['A' + i] = static_cast<std::int8_t>(10 + i);
+    }
+    return ret;
+}();
+
+using decode_result = std::expected<char *, boost::system::error_code>;
+
+// Everything below is inlined into the kernels, so that it is compiled for their instruction set.
+#define S3CPP_URLENCODE_INLINE [[gnu::always_inline]] inline
+
+struct Scalar {
+    static constexpr std::size_t width = 0;
+};
+
+#ifdef S3CPP_URLENCODE_X86
 
-constexpr boost::urls::grammar::lut_chars path_charset = charset + "/";
+using u8x16 = unsigned char __attribute__((vector_size(16)));
+using u8x32 = unsigned char __attribute__((vector_size(32)));
 
-constexpr boost::urls::grammar::lut_chars query_charset = charset;
+// whether any of the lanes is set, without a movemask, which GCC vector extensions don't have
+template <typename M> S3CPP_URLENCODE_INLINE bool any_of(const M &mask) {
+    std::array<std::uint64_t, sizeof(M) / sizeof(std::uint64_t)> words{};
+    std::memcpy(words.data(), &mask, sizeof(M));
+    std::uint64_t ret = 0;
+    for (const std::uint64_t word : words) {
+        ret |= word;
+    }
+    return ret != 0;
+}
+
+// a vector of sizeof(V) bytes, written once with GCC vector extensions for SSE2 and AVX2
+template <typename V> struct Block {
+    static constexpr std::size_t width = sizeof(V);
+
+    template <Charset charset> S3CPP_URLENCODE_INLINE static bool escapes(const char *in) {
+        V chr;
+        std::memcpy(&chr, in, sizeof(V));
+        // ALPHA in either case, DIGIT, then -. and / for paths, which follows them
+        const auto pass = ((chr | 0x20) - 'a' < 26) | (chr - '0' < 10) |
+                          (chr - '-' < (charset == Charset::PATH ? 3 : 2)) | (chr == '_') | (chr == '~');
+        return any_of(~pass);
+    }
+
+    template <bool plus> S3CPP_URLENCODE_INLINE static bool unescapes(const char *in) {
+        V chr;
+        std::memcpy(&chr, in, sizeof(V));
+        if constexpr (plus) {
+            return any_of((chr == '%') | (chr == '+'));
+        } else {
+            return any_of(chr == '%');
+        }
+    }
+
+    S3CPP_URLENCODE_INLINE static void copy(const char *in, char *out) { std::memcpy(out, in, sizeof(V)); }
+};
+
+#endif
+
+template <Charset charset, typename Block>
+S3CPP_URLENCODE_INLINE bool encode_required(std::string_view input) {
+    std::size_t i = 0;
+    if constexpr (Block::width != 0) {
+        for (; i + Block::width <= input.size(); i += Block::width) {
+            if (Block::template escapes<charset>(input.data() + i)) {
+                return true;
+            }
+        }
+    }
+    for (; i < input.size(); i++) {
+        if (!passes<charset>[static_cast<unsigned char>(input[i])]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <Charset charset> S3CPP_URLENCODE_INLINE char *encode_byte(unsigned char chr, char *out) {
+    if (passes<charset>[chr]) {
+        *out++ = static_cast<char>(chr);
+    } else {
+        *out++ = '%';
+        *out++ = hex_digits_upper[chr >> 4];
+        *out++ = hex_digits_upper[chr & 0x0f];
+    }
+    return out;
+}
+
+template <Charset charset, typename Block>
+S3CPP_URLENCODE_INLINE char *encode_to(std::string_view input, char *out) {
+    std::size_t i = 0;
+    if constexpr (Block::width != 0) {
+        for (; i + Block::width <= input.size(); i += Block::width) {
+            if (!Block::template escapes<charset>(input.data() + i)) {
+                Block::copy(input.data() + i, out);
+                out += Block::width;
+                continue;
+            }
+            for (std::size_t j = i; j < i + Block::width; j++) {
+                out = encode_byte<charset>(static_cast<unsigned char>(input[j]), out);
+            }
+        }
+    }
+    for (; i < input.size(); i++) {
+        out = encode_byte<charset>(static_cast<unsigned char>(input[i]), out);
+    }
+    return out;
+}
+
+// decodes the byte at input[i], which may start an escape, i points past it afterwards
+template <bool plus>
+S3CPP_URLENCODE_INLINE decode_result decode_byte(std::string_view input, std::size_t &i, char *out) {
+    const char chr = input[i++];
+    if (plus && chr == '+') {
+        *out++ = ' ';
+    } else if (chr == '%') {
+        if (i + 2 > input.size()) {
+            return std::unexpected{boost::urls::error::incomplete_encoding};
+        }
+        const std::int8_t high = hex_values[static_cast<unsigned char>(input[i])];
+        const std::int8_t low = hex_values[static_cast<unsigned char>(input[i + 1])];
+        if (high < 0 || low < 0) {
+            return std::unexpected{boost::urls::error::bad_pct_hexdig};
+        }
+        *out++ = static_cast<char>((high << 4) | low);
+        i += 2;
+    } else {
+        *out++ = chr;
+    }
+    return out;
+}
+
+template <bool plus, typename Block>
+S3CPP_URLENCODE_INLINE decode_result decode_to(std::string_view input, char *out) {
+    std::size_t i = 0;
+    if constexpr (Block::width != 0) {
+        while (i + Block::width <= input.size()) {
+            if (!Block::template unescapes<plus>(input.data() + i)) {
+                Block::copy(input.data() + i, out);
+                out += Block::width;
+                i += Block::width;
+                continue;
+            }
+            // an escape may run past the block, so this goes on from wherever it ended
+            for (const std::size_t end = i + Block::width; i < end;) {
+                const auto res = decode_byte<plus>(input, i, out);
+                if (!res) {
+                    return res;
+                }
+                out = res.value();
+            }
+        }
+    }
+    while (i < input.size()) {
+        const auto res = decode_byte<plus>(input, i, out);
+        if (!res) {
+            return res;
+        }
+        out = res.value();
+    }
+    return out;
+}
+
+#undef S3CPP_URLENCODE_INLINE
+
+// the kernels of one instruction set
+struct Kernels {
+    bool (*unreserved_required)(std::string_view);
+    bool (*path_required)(std::string_view);
+    char *(*unreserved_to)(std::string_view, char *);
+    char *(*path_to)(std::string_view, char *);
+    decode_result (*decode_to)(std::string_view, char *);
+    decode_result (*decode_query_to)(std::string_view, char *);
+};
+
+// the kernels of one instruction set, as functions of their own that carry its target attribute
+#define S3CPP_URLENCODE_KERNELS(name, attributes, Block)                                                     \
+    attributes bool name##_unreserved_required(std::string_view input) {                                     \
+        return encode_required<Charset::UNRESERVED, Block>(input);                                           \
+    }                                                                                                        \
+    attributes bool name##_path_required(std::string_view input) {                                           \
+        return encode_required<Charset::PATH, Block>(input);                                                 \
+    }                                                                                                        \
+    attributes char *name##_unreserved_to(std::string_view input, char *out) {                               \
+        return encode_to<Charset::UNRESERVED, Block>(input, out);                                            \
+    }                                                                                                        \
+    attributes char *name##_path_to(std::string_view input, char *out) {                                     \
+        return encode_to<Charset::PATH, Block>(input, out);                                                  \
+    }                                                                                                        \
+    attributes decode_result name##_decode_to(std::string_view input, char *out) {                           \
+        return decode_to<false, Block>(input, out);                                                          \
+    }                                                                                                        \
+    attributes decode_result name##_decode_query_to(std::string_view input, char *out) {                     \
+        return decode_to<true, Block>(input, out);                                                           \
+    }                                                                                                        \
+    constexpr Kernels name##_kernels{                                                                        \
+        .unreserved_required = name##_unreserved_required,                                                   \
+        .path_required = name##_path_required,                                                               \
+        .unreserved_to = name##_unreserved_to,                                                               \
+        .path_to = name##_path_to,                                                                           \
+        .decode_to = name##_decode_to,                                                                       \
+        .decode_query_to = name##_decode_query_to,                                                           \
+    };
+
+#ifdef S3CPP_URLENCODE_X86
+S3CPP_URLENCODE_KERNELS(avx2, [[gnu::target("avx2")]], Block<u8x32>)
+S3CPP_URLENCODE_KERNELS(sse2, , Block<u8x16>)
+#endif
+// also where a vector kernel runs, so that the tests can compare against it
+S3CPP_URLENCODE_KERNELS(scalar, , Scalar)
+
+#undef S3CPP_URLENCODE_KERNELS
+
+[[nodiscard]] const Kernels &select_kernels() {
+#ifdef S3CPP_URLENCODE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return avx2_kernels;
+    }
+    return sse2_kernels;
+#else
+    return scalar_kernels;
+#endif
+}
+
+[[nodiscard]] std::atomic<const Kernels *> &current_kernels() {
+    static std::atomic<const Kernels *> ret = &select_kernels();
+    return ret;
+}
+
+[[nodiscard]] const Kernels &kernels() { return *current_kernels().load(std::memory_order_relaxed); }
+
+template <typename Encode> [[nodiscard]] std::string encode(std::string_view input, Encode encode_to_) {
+    std::string ret;
+    ret.resize_and_overwrite(3 * input.size(), [input, encode_to_](char *out, std::size_t /*size*/) {
+        return static_cast<std::size_t>(encode_to_(input, out) - out);
+    });
+    return ret;
+}
+
+template <typename Decode>
+[[nodiscard]] std::expected<std::string, boost::system::error_code> decode(std::string_view input,
+                                                                           Decode decode_to_) {
+    std::string ret;
+    boost::system::error_code ec;
+    ret.resize_and_overwrite(input.size(), [input, decode_to_, &ec](char *out, std::size_t /*size*/) {
+        const auto res = decode_to_(input, out);
+        if (!res) {
+            ec = res.error();
+            return std::size_t{0};
+        }
+        return static_cast<std::size_t>(res.value() - out);
+    });
+    if (ec.failed()) {
+        return std::unexpected{ec};
+    }
+    return ret;
+}
 
 } // namespace
 
-std::string urlencode(std::string_view input) { return boost::urls::encode(input, charset); }
-bool urlencode_required(std::string_view input) {
-    return boost::urls::grammar::find_if(input.begin(), input.end(), charset) != input.end();
+char *urlencode_to(std::string_view input, char *out) { return kernels().unreserved_to(input, out); }
+std::string urlencode(std::string_view input) { return encode(input, kernels().unreserved_to); }
+bool urlencode_required(std::string_view input) { return kernels().unreserved_required(input); }
+
+char *urlencode_path_to(std::string_view input, char *out) { return kernels().path_to(input, out); }
+std::string urlencode_path(std::string_view input) { return encode(input, kernels().path_to); }
+bool urlencode_path_required(std::string_view input) { return kernels().path_required(input); }
+
+char *urlencode_query_to(std::string_view input, char *out) { return kernels().unreserved_to(input, out); }
+std::string urlencode_query(std::string_view input) { return encode(input, kernels().unreserved_to); }
+bool urlencode_query_required(std::string_view input) { return kernels().unreserved_required(input); }
+
+std::expected<char *, boost::system::error_code> urldecode_to(std::string_view input, char *out) {
+    return kernels().decode_to(input, out);
+}
+std::expected<std::string, boost::system::error_code> urldecode(std::string_view input) {
+    return decode(input, kernels().decode_to);
 }
 
-std::string urlencode_path(std::string_view input) { return boost::urls::encode(input, path_charset); }
-bool urlencode_path_required(std::string_view input) {
-    return boost::urls::grammar::find_if(input.begin(), input.end(), path_charset) != input.end();
+std::expected<char *, boost::system::error_code> urldecode_query_to(std::string_view input, char *out) {
+    return kernels().decode_query_to(input, out);
+}
+std::expected<std::string, boost::system::error_code> urldecode_query(std::string_view input) {
+    return decode(input, kernels().decode_query_to);
 }
 
-std::string urlencode_query(std::string_view input) { return boost::urls::encode(input, query_charset); }
-bool urlencode_query_required(std::string_view input) {
-    return boost::urls::grammar::find_if(input.begin(), input.end(), query_charset) != input.end();
+namespace _internal {
+
+bool use_urlencode_kernel(std::size_t width) {
+    const Kernels *ret = nullptr;
+    if (width == 0) {
+        ret = &scalar_kernels;
+    }
+#ifdef S3CPP_URLENCODE_X86
+    __builtin_cpu_init();
+    if (width == 16) {
+        ret = &sse2_kernels;
+    } else if (width == 32 && __builtin_cpu_supports("avx2")) {
+        ret = &avx2_kernels;
+    }
+#endif
+    if (ret == nullptr) {
+        return false;
+    }
+    current_kernels().store(ret, std::memory_order_relaxed);
+    return true;
 }
 
+void use_default_urlencode_kernel() { current_kernels().store(&select_kernels(), std::memory_order_relaxed); }
+
+} // namespace _internal
+
 } // namespace s3cpp::aws::iam
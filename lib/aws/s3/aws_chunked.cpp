@@ -0,0 +1,140 @@
+#include "aws_chunked.hpp"
+
+#include "s3cpp/aws/iam/crypto.hpp"
+#include "s3cpp/meta.hpp"
+#include "signing_key_cache.hpp"
+
+#include <botan/base64.h>
+#include <botan/hash.h>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <utility>
+
+// see https://docs.aws.amazon.com/AmazonS3/latest/API/sigv4-streaming.html
+// and https://docs.aws.amazon.com/AmazonS3/latest/API/sigv4-streaming-trailers.html
+
+namespace s3cpp::aws::s3::_internal {
+
+namespace {
+
+// ;chunk-signature=<64 hex digits>
+constexpr std::string_view signature_extension = ";chunk-signature=";
+constexpr std::size_t signature_extension_size = signature_extension.size() + 64;
+
+[[nodiscard]] std::uint64_t hex_digits(std::uint64_t value) {
+    std::uint64_t ret = 1;
+    while (value >= 16) {
+        value /= 16;
+        ret++;
+    }
+    return ret;
+}
+
+[[nodiscard]] std::string_view as_string_view(std::span<const std::byte> bytes) {
+    return {meta::safe_reinterpret_cast<const char *>(bytes.data()), bytes.size()};
+}
+
+} // namespace
+
+ChecksumTrailer::ChecksumTrailer() : crc_{Botan::HashFunction::create_or_throw("CRC32")} {}
+
+ChecksumTrailer::~ChecksumTrailer() = default;
+
+ChecksumTrailer::ChecksumTrailer(ChecksumTrailer &&) noexcept = default;
+
+ChecksumTrailer &ChecksumTrailer::operator=(ChecksumTrailer &&) noexcept = default;
+
+void ChecksumTrailer::update(std::span<const std::byte> chunk) { crc_->update(as_string_view(chunk)); }
+
+std::array<char, ChecksumTrailer::size> ChecksumTrailer::finish() {
+    // big-endian, as S3 expects it
+    std::array<std::uint8_t, 4> crc{};
+    crc_->final(crc.data());
+    std::array<char, size> ret{};
+    std::format_to_n(ret.data(), ret.size(), "{}:{}\r\n", checksum_trailer_name,
+                     Botan::base64_encode(crc.data(), crc.size()));
+    return ret;
+}
+
+ChunkSigner::ChunkSigner(std::shared_ptr<const SigningScope> scope, std::array<char, 16> timestamp,
+                         const iam::_internal::sha256_hex &seed_signature)
+    : scope_{std::move(scope)}, timestamp_{timestamp}, previous_{seed_signature} {
+    string_to_sign_.reserve(256);
+}
+
+const iam::_internal::sha256_hex &ChunkSigner::sign(std::span<const std::byte> chunk) {
+    const iam::_internal::sha256_hex chunk_hash =
+        iam::_internal::hex_encode(iam::_internal::sha256(as_string_view(chunk)));
+    string_to_sign_.clear();
+    string_to_sign_.append("AWS4-HMAC-SHA256-PAYLOAD\n");
+    string_to_sign_.append(timestamp_.data(), timestamp_.size());
+    string_to_sign_.push_back('\n');
+    string_to_sign_.append(scope_->credential_scope);
+    string_to_sign_.push_back('\n');
+    string_to_sign_.append(iam::_internal::to_string_view(previous_));
+    string_to_sign_.push_back('\n');
+    string_to_sign_.append(empty_payload_sha256);
+    string_to_sign_.push_back('\n');
+    string_to_sign_.append(iam::_internal::to_string_view(chunk_hash));
+    previous_ = iam::_internal::hex_encode(iam::_internal::hmac_sha256(scope_->key, string_to_sign_));
+    return previous_;
+}
+
+ChunkEncoder::ChunkEncoder(ChecksumTrailer checksum) : checksum_{std::move(checksum)} {}
+
+ChunkEncoder::ChunkEncoder(ChunkSigner signer) : signer_{std::move(signer)} {}
+
+std::uint64_t ChunkEncoder::length(std::uint64_t payload_size) const {
+    if (!is_chunked()) {
+        return payload_size;
+    }
+    const std::size_t extension_size = signer_.has_value() ? signature_extension_size : 0;
+    const auto chunk_length = [extension_size](std::uint64_t size) {
+        return hex_digits(size) + extension_size + 2 + size + 2;
+    };
+    std::uint64_t ret = (payload_size / aws_chunk_size) * chunk_length(aws_chunk_size);
+    if (const std::uint64_t last_chunk = payload_size % aws_chunk_size; last_chunk != 0) {
+        ret += chunk_length(last_chunk);
+    }
+    // 0[;chunk-signature=...]\r\n[trailer]\r\n
+    return ret + 1 + extension_size + 2 + (checksum_.has_value() ? ChecksumTrailer::size : 0) + 2;
+}
+
+std::string_view ChunkEncoder::begin_chunk(std::span<const std::byte> chunk, ChunkFrame &buffer) {
+    if (!is_chunked()) {
+        return {};
+    }
+    auto out = std::format_to(buffer.data(), "{:x}", chunk.size());
+    if (checksum_.has_value()) {
+        checksum_->update(chunk);
+    }
+    if (signer_.has_value()) {
+        out = std::ranges::copy(signature_extension, out).out;
+        out = std::ranges::copy(signer_->sign(chunk), out).out;
+    }
+    out = std::ranges::copy(std::string_view{"\r\n"}, out).out;
+    return {buffer.data(), out};
+}
+
+std::string_view ChunkEncoder::end_chunk() const { return is_chunked() ? "\r\n" : ""; }
+
+std::string_view ChunkEncoder::finish(ChunkFrame &buffer) {
+    if (!is_chunked()) {
+        return {};
+    }
+    const std::string_view header = begin_chunk({}, buffer);
+    char *out = buffer.data() + header.size();
+    if (checksum_.has_value()) {
+        out = std::ranges::copy(checksum_->finish(), out).out;
+    }
+    out = std::ranges::copy(std::string_view{"\r\n"}, out).out;
+    return {buffer.data(), out};
+}
+
+} // namespace s3cpp::aws::s3::_internal
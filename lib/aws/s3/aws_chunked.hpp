@@ -0,0 +1,103 @@
+#pragma once
+
+#include "s3cpp/aws/iam/crypto.hpp"
+#include "signing_key_cache.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace Botan {
+class HashFunction;
+} // namespace Botan
+
+namespace s3cpp::aws::s3::_internal {
+
+// SHA-256 of nothing, the payload hash of every GET, HEAD and DELETE
+inline constexpr std::string_view empty_payload_sha256 =
+    "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855";
+
+// x-amz-content-sha256 values for bodies that aren't hashed before the request is sent
+inline constexpr std::string_view unsigned_payload = "UNSIGNED-PAYLOAD";
+inline constexpr std::string_view streaming_unsigned_payload_trailer = "STREAMING-UNSIGNED-PAYLOAD-TRAILER";
+inline constexpr std::string_view streaming_signed_payload = "STREAMING-AWS4-HMAC-SHA256-PAYLOAD";
+
+inline constexpr std::string_view checksum_trailer_name = "x-amz-checksum-crc32";
+
+// payload bytes per chunk, only the last one is shorter
+inline constexpr std::size_t aws_chunk_size = std::size_t{64} << 10;
+
+// The CRC32 of the payload, fed chunk by chunk while it is sent.
+class ChecksumTrailer {
+private:
+    std::unique_ptr<Botan::HashFunction> crc_;
+
+public:
+    // x-amz-checksum-crc32:<8 characters of base64>\r\n
+    static constexpr std::size_t size = checksum_trailer_name.size() + 1 + 8 + 2;
+
+    [[nodiscard]] ChecksumTrailer();
+    ~ChecksumTrailer();
+
+    ChecksumTrailer(const ChecksumTrailer &) = delete;
+    ChecksumTrailer &operator=(const ChecksumTrailer &) = delete;
+    [[nodiscard]] ChecksumTrailer(ChecksumTrailer &&) noexcept;
+    ChecksumTrailer &operator=(ChecksumTrailer &&) noexcept;
+
+    void update(std::span<const std::byte> chunk);
+
+    // the trailer line for everything passed to update
+    [[nodiscard]] std::array<char, size> finish();
+};
+
+// Signs the chunks of a STREAMING-AWS4-HMAC-SHA256-PAYLOAD body. Each signature covers its chunk and the
+// signature before it, the first one chains from the signature of the request.
+class ChunkSigner {
+private:
+    std::shared_ptr<const SigningScope> scope_;
+    std::array<char, 16> timestamp_;
+    iam::_internal::sha256_hex previous_;
+    std::string string_to_sign_;
+
+public:
+    [[nodiscard]] ChunkSigner(std::shared_ptr<const SigningScope> scope, std::array<char, 16> timestamp,
+                              const iam::_internal::sha256_hex &seed_signature);
+
+    [[nodiscard]] const iam::_internal::sha256_hex &sign(std::span<const std::byte> chunk);
+};
+
+// room for the longest chunk header and for the final chunk
+using ChunkFrame = std::array<char, 128>;
+
+// Frames the payload of an upload. Without a checksum or signer it goes out as is, otherwise aws-chunked:
+//   hex(size)[;chunk-signature=<signature>]\r\n<size bytes>\r\n
+// terminated by a chunk of size 0 and the trailer, if any, and \r\n.
+class ChunkEncoder {
+private:
+    std::optional<ChecksumTrailer> checksum_;
+    std::optional<ChunkSigner> signer_;
+
+public:
+    [[nodiscard]] ChunkEncoder() = default;
+    [[nodiscard]] explicit ChunkEncoder(ChecksumTrailer checksum);
+    [[nodiscard]] explicit ChunkEncoder(ChunkSigner signer);
+
+    [[nodiscard]] bool is_chunked() const { return checksum_.has_value() || signer_.has_value(); }
+
+    // the length on the wire of a payload of payload_size bytes
+    [[nodiscard]] std::uint64_t length(std::uint64_t payload_size) const;
+
+    // feeds chunk to the checksum or signer, returns what goes before it
+    [[nodiscard]] std::string_view begin_chunk(std::span<const std::byte> chunk, ChunkFrame &buffer);
+    // what goes after each chunk
+    [[nodiscard]] std::string_view end_chunk() const;
+    // what goes after the last chunk
+    [[nodiscard]] std::string_view finish(ChunkFrame &buffer);
+};
+
+} // namespace s3cpp::aws::s3::_internal
@@ -0,0 +1,181 @@
+#include "bucket_router.hpp"
+
+#include "load_balancer.hpp"
+#include "s3cpp/aws/s3/session.hpp"
+
+#include <algorithm>
+#include <boost/beast/http/message.hpp> // IWYU pragma: keep
+#include <boost/url/authority_view.hpp>
+#include <boost/url/host_type.hpp>
+#include <boost/url/parse.hpp>
+#include <boost/url/url.hpp>
+#include <cstddef>
+#include <format>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace s3cpp::aws::s3::_internal {
+
+namespace {
+
+// the first segment of the path
+[[nodiscard]] std::string_view bucket_of(std::string_view path) {
+    if (path.starts_with('/')) {
+        path.remove_prefix(1);
+    }
+    return path.substr(0, path.find('/'));
+}
+
+[[nodiscard]] bool is_virtual_hostable(std::string_view bucket, const boost::urls::url &endpoint) {
+    if (endpoint.host_type() != boost::urls::host_type::name || bucket.size() < 3 || bucket.size() > 63) {
+        return false;
+    }
+    // dotted buckets don't match the wildcard certificate of the endpoint
+    const bool allow_dots = endpoint.scheme() == "http";
+    const auto is_alnum = [](char chr) { return (chr >= 'a' && chr <= 'z') || (chr >= '0' && chr <= '9'); };
+    if (!is_alnum(bucket.front()) || !is_alnum(bucket.back())) {
+        return false;
+    }
+    return std::ranges::all_of(
+        bucket, [&](char chr) { return is_alnum(chr) || chr == '-' || (allow_dots && chr == '.'); });
+}
+
+[[nodiscard]] boost::urls::url with_bucket(boost::urls::url endpoint, std::string_view bucket) {
+    endpoint.set_encoded_host(std::format("{}.{}", bucket, std::string_view{endpoint.encoded_host()}));
+    return endpoint;
+}
+
+// the text of the first <name> element, S3 error documents are flat
+[[nodiscard]] std::string_view xml_element(std::string_view body, std::string_view name) {
+    const std::string open = std::format("<{}>", name);
+    const std::size_t begin = body.find(open);
+    if (begin == std::string_view::npos) {
+        return {};
+    }
+    const std::size_t end = body.find(std::format("</{}>", name), begin);
+    if (end == std::string_view::npos) {
+        return {};
+    }
+    return body.substr(begin + open.size(), end - begin - open.size());
+}
+
+} // namespace
+
+BucketRouter::BucketRouter(boost::urls::url endpoint, std::string region, AddressingStyle addressing,
+                           LoadBalancingOptions load_balancing, DnsOptions dns)
+    : default_location_{.region = std::move(region), .endpoint = std::move(endpoint)},
+      addressing_{addressing}, load_balancing_{std::move(load_balancing)}, dns_{dns} {}
+
+std::shared_ptr<LoadBalancer> BucketRouter::load_balancer(const boost::urls::url &endpoint,
+                                                          std::string_view bucket, bool is_default) {
+    const boost::urls::url primary = bucket.empty() ? endpoint : with_bucket(endpoint, bucket);
+    auto &ret = load_balancers_[std::string{primary.buffer()}];
+    if (ret != nullptr) {
+        return ret;
+    }
+
+    LoadBalancingOptions options = load_balancing_;
+    options.gateways.clear();
+    // the gateways serve the buckets of the session endpoint, not those of other regions
+    if (is_default) {
+        for (const auto &gateway : load_balancing_.gateways) {
+            if (bucket.empty()) {
+                options.gateways.push_back(gateway);
+            } else if (is_virtual_hostable(bucket, gateway)) {
+                options.gateways.push_back(with_bucket(gateway, bucket));
+            }
+        }
+    }
+    ret = std::make_shared<LoadBalancer>(primary, std::move(options), dns_);
+    return ret;
+}
+
+BucketRouter::Route BucketRouter::route(std::string_view path) {
+    const std::string_view bucket = bucket_of(path);
+    const std::scoped_lock lock{mutex_};
+    const auto location = bucket.empty() ? locations_.end() : locations_.find(std::string{bucket});
+    const bool is_default = location == locations_.end();
+    const Location &target = is_default ? default_location_ : location->second;
+    const bool is_virtual = addressing_ == AddressingStyle::VIRTUAL_HOSTED && !bucket.empty() &&
+                            is_virtual_hostable(bucket, target.endpoint);
+
+    Route ret{.load_balancer = load_balancer(target.endpoint, is_virtual ? bucket : std::string_view{},
+                                             is_default),
+              .region = target.region,
+              .path = path};
+    if (is_virtual) {
+        // "/bucket/key" -> "/key", "/bucket" -> "/"
+        ret.path = path.substr((path.starts_with('/') ? 1 : 0) + bucket.size());
+        if (ret.path.empty()) {
+            ret.path = "/";
+        }
+    }
+    return ret;
+}
+
+bool BucketRouter::learn(std::string_view path, const boost::beast::http::response_header<> &header,
+                         std::string_view body) {
+    // 301 PermanentRedirect, 307 TemporaryRedirect and 400 AuthorizationHeaderMalformed point elsewhere
+    const unsigned int status = header.result_int();
+    if (status != 301 && status != 307 && status != 400) {
+        return false;
+    }
+    const std::string_view bucket = bucket_of(path);
+    if (bucket.empty()) {
+        return false;
+    }
+    std::string_view region = header["x-amz-bucket-region"];
+    if (region.empty()) {
+        region = xml_element(body, "Region");
+    }
+    std::string_view endpoint_host = xml_element(body, "Endpoint");
+    if (region.empty() && endpoint_host.empty()) {
+        return false;
+    }
+
+    const std::scoped_lock lock{mutex_};
+    const auto location = locations_.find(std::string{bucket});
+    const Location &current = location == locations_.end() ? default_location_ : location->second;
+    Location next{.region = region.empty() ? current.region : std::string{region},
+                  .endpoint = current.endpoint};
+    if (!endpoint_host.empty()) {
+        // the endpoint may be given as a virtual host
+        if (endpoint_host.starts_with(bucket) && endpoint_host.substr(bucket.size()).starts_with('.')) {
+            endpoint_host.remove_prefix(bucket.size() + 1);
+        }
+        const auto authority = boost::urls::parse_authority(endpoint_host);
+        if (!authority) {
+            return false;
+        }
+        next.endpoint.set_encoded_host(authority->encoded_host());
+        if (authority->has_port()) {
+            next.endpoint.set_port(authority->port());
+        }
+    } else if (next.region != current.region &&
+               std::string_view{current.endpoint.encoded_host()}.ends_with(".amazonaws.com")) {
+        // AWS doesn't always say where to go, but regional endpoints follow a fixed pattern
+        next.endpoint.set_encoded_host(std::format("s3.{}.amazonaws.com", next.region));
+    }
+    if (next.region == current.region && next.endpoint == current.endpoint) {
+        return false;
+    }
+    locations_.insert_or_assign(std::string{bucket}, std::move(next));
+    return true;
+}
+
+std::vector<EndpointStats> BucketRouter::stats() const {
+    const std::scoped_lock lock{mutex_};
+    std::vector<EndpointStats> ret;
+    for (const auto &[key, load_balancer] : load_balancers_) {
+        auto stats = load_balancer->stats();
+        ret.insert(ret.end(), std::make_move_iterator(stats.begin()), std::make_move_iterator(stats.end()));
+    }
+    return ret;
+}
+
+} // namespace s3cpp::aws::s3::_internal
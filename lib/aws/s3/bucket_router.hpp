@@ -0,0 +1,65 @@
+#pragma once
+
+#include "load_balancer.hpp"
+#include "s3cpp/aws/s3/session.hpp"
+
+#include <boost/beast/http/message.hpp> // IWYU pragma: keep
+#include <boost/url/url.hpp>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace s3cpp::aws::s3::_internal {
+
+// Decides which host and region a request for a bucket goes to.
+// Every host gets its own LoadBalancer, and with it its own DNS cache and connection pools. This covers
+// virtual hosts (bucket.endpoint) as well as regional endpoints learned from redirects.
+// Redirects are remembered per bucket, so that only the first request to a bucket in another region takes
+// the extra round trip.
+class BucketRouter {
+public:
+    struct Route {
+        std::shared_ptr<LoadBalancer> load_balancer;
+        std::string region;
+        // the request path, without the bucket for virtual-hosted requests
+        std::string_view path;
+    };
+
+private:
+    struct Location {
+        std::string region;
+        boost::urls::url endpoint;
+    };
+
+    Location default_location_;
+    AddressingStyle addressing_;
+    LoadBalancingOptions load_balancing_;
+    DnsOptions dns_;
+
+    mutable std::mutex mutex_;
+    // keyed by bucket
+    std::unordered_map<std::string, Location> locations_;
+    // keyed by the url of the primary gateway
+    std::unordered_map<std::string, std::shared_ptr<LoadBalancer>> load_balancers_;
+
+    [[nodiscard]] std::shared_ptr<LoadBalancer> load_balancer(const boost::urls::url &endpoint,
+                                                              std::string_view bucket, bool is_default);
+
+public:
+    [[nodiscard]] BucketRouter(boost::urls::url endpoint, std::string region, AddressingStyle addressing,
+                               LoadBalancingOptions load_balancing, DnsOptions dns);
+
+    [[nodiscard]] Route route(std::string_view path [[clang::lifetimebound]]);
+
+    // Looks for a redirect to another region or endpoint in the response.
+    // Returns true if the bucket's location changed, and the request should be sent again.
+    [[nodiscard]] bool learn(std::string_view path, const boost::beast::http::response_header<> &header,
+                             std::string_view body);
+
+    [[nodiscard]] std::vector<EndpointStats> stats() const;
+};
+
+} // namespace s3cpp::aws::s3::_internal
@@ -2,6 +2,7 @@
 #include "s3cpp/aws/s3/client.hpp"
 #include "s3cpp/aws/s3/types.hpp"
 #include "s3cpp/meta.hpp"
+#include "status_error.hpp"
 
 #include <boost/asio/awaitable.hpp>
 #include <boost/beast/core/error.hpp>
@@ -10,6 +11,7 @@
 #include <expected>
 #include <format>
 #include <iostream>
+#include <iterator>
 #include <print>
 #include <pugixml.hpp>
 #include <string>
@@ -80,28 +82,34 @@ std::expected<ListAllMyBucketsResult, pugi::xml_parse_status> parse_list_buckets
 
 meta::crt<boost::asio::awaitable<
     std::expected<ListAllMyBucketsResult, std::variant<boost::beast::error_code, pugi::xml_parse_status>>>>
-Client::list_buckets(ListBucketsParameters parameters, boost::beast::http::fields headers) const {
+Client::list_buckets(ListBucketsParameters parameters, boost::beast::http::fields headers,
+                     RequestOptions request_options) const {
     std::string query;
-    auto add_param = [&query](std::string_view param) {
+    // formats straight into the query, without a temporary per parameter
+    auto add_param = [&query]<typename... Args>(std::format_string<Args...> fmt, Args &&...args) {
         if (!query.empty()) {
             query.append("&");
         }
-        query.append(param);
+        std::format_to(std::back_inserter(query), fmt, std::forward<Args>(args)...);
     };
 
     if (parameters.BucketRegion.has_value()) {
-        add_param(std::format("bucket-region={}", iam::urlencode_query(parameters.BucketRegion.value())));
+        add_param("bucket-region={}", iam::urlencode_query(parameters.BucketRegion.value()));
     }
     if (parameters.ContinuationToken.has_value()) {
-        add_param(
-            std::format("continuation-token={}", iam::urlencode_query(parameters.ContinuationToken.value())));
+        add_param("continuation-token={}", iam::urlencode_query(parameters.ContinuationToken.value()));
     }
-    add_param(std::format("max-buckets={}", parameters.MaxBuckets));
+    add_param("max-buckets={}", parameters.MaxBuckets);
     if (parameters.Prefix.has_value()) {
-        add_param(std::format("prefix={}", iam::urlencode_query(parameters.Prefix.value())));
+        add_param("prefix={}", iam::urlencode_query(parameters.Prefix.value()));
     }
 
-    auto res = co_await session_->get("/", query, std::move(headers), true);
+    auto res = co_await session_->get("/", query, std::move(headers), true, request_options);
+    if (res && res->result_int() / 100 != 2) {
+        std::println(std::cerr, "ERROR query {} status {}", query, res->result_int());
+        co_return std::unexpected<std::variant<boost::beast::error_code, pugi::xml_parse_status>>{
+            _internal::status_error(res->result_int())};
+    }
     if (res) {
         co_return parse_list_buckets(res.value().body())
             .transform_error([&query](pugi::xml_parse_status err) {
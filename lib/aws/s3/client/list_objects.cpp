@@ -2,6 +2,7 @@
 #include "s3cpp/aws/s3/client.hpp"
 #include "s3cpp/aws/s3/types.hpp"
 #include "s3cpp/meta.hpp"
+#include "status_error.hpp"
 
 #include <boost/asio/awaitable.hpp>
 #include <boost/beast/core/error.hpp>
@@ -11,6 +12,7 @@
 #include <expected>
 #include <format>
 #include <iostream>
+#include <iterator>
 #include <print>
 #include <pugixml.hpp>
 #include <string>
@@ -114,47 +116,47 @@ template <ListObjectsVersion api_version>
         parameters) {
 
     std::string query;
-    auto add_param = [&query](std::string_view param) {
+    // formats straight into the query, without a temporary per parameter
+    auto add_param = [&query]<typename... Args>(std::format_string<Args...> fmt, Args &&...args) {
         if (!query.empty()) {
             query.append("&");
         }
-        query.append(param);
+        std::format_to(std::back_inserter(query), fmt, std::forward<Args>(args)...);
     };
 
     if constexpr (api_version == ListObjectsVersion::V2) {
         add_param("list-type=2");
     }
 
-    add_param(std::format("max-keys={}", parameters.MaxKeys));
+    add_param("max-keys={}", parameters.MaxKeys);
 
     if constexpr (api_version == ListObjectsVersion::V1) {
         if (parameters.Marker.has_value()) {
-            add_param(std::format("marker={}", iam::urlencode_query(parameters.Marker.value())));
+            add_param("marker={}", iam::urlencode_query(parameters.Marker.value()));
         }
     }
     if constexpr (api_version == ListObjectsVersion::V2) {
         if (parameters.ContinuationToken.has_value()) {
-            add_param(std::format("continuation-token={}",
-                                  iam::urlencode_query(parameters.ContinuationToken.value())));
+            add_param("continuation-token={}", iam::urlencode_query(parameters.ContinuationToken.value()));
         }
         if (parameters.FetchOwner) {
             add_param("fetch-owner=true");
         }
         if (parameters.StartAfter.has_value()) {
-            add_param(std::format("start-after={}", parameters.StartAfter.value()));
+            add_param("start-after={}", parameters.StartAfter.value());
         }
     }
     if (parameters.Delimiter.has_value()) {
-        add_param(std::format("delimiter={}", iam::urlencode_query(parameters.Delimiter.value())));
+        add_param("delimiter={}", iam::urlencode_query(parameters.Delimiter.value()));
     }
     if (parameters.EncodingType.has_value()) {
-        add_param(std::format("encoding-type={}", parameters.EncodingType.value()));
+        add_param("encoding-type={}", parameters.EncodingType.value());
     }
     if (parameters.Prefix.has_value()) {
         if (parameters.EncodingType.value_or("") == "url") {
-            add_param(std::format("prefix={}", parameters.Prefix.value()));
+            add_param("prefix={}", parameters.Prefix.value());
         } else {
-            add_param(std::format("prefix={}", iam::urlencode_query(parameters.Prefix.value())));
+            add_param("prefix={}", iam::urlencode_query(parameters.Prefix.value()));
         }
     }
 
@@ -165,11 +167,18 @@ template <ListObjectsVersion api_version>
 
 meta::crt<boost::asio::awaitable<
     std::expected<ListObjectsResult, std::variant<boost::beast::error_code, pugi::xml_parse_status>>>>
-Client::list_objects(ListObjectsParameters parameters, boost::beast::http::fields headers) const {
+Client::list_objects(ListObjectsParameters parameters, boost::beast::http::fields headers,
+                     RequestOptions request_options) const {
     const std::string query = list_objects_prepare_query<ListObjectsVersion::V1>(parameters);
 
     auto res =
-        co_await session_->get(std::format("/{}", parameters.Bucket), query, std::move(headers), false);
+        co_await session_->get(std::format("/{}", parameters.Bucket), query, std::move(headers), false,
+                               request_options);
+    if (res && res->result_int() / 100 != 2) {
+        std::println(std::cerr, "ERROR query {} status {}", query, res->result_int());
+        co_return std::unexpected<std::variant<boost::beast::error_code, pugi::xml_parse_status>>{
+            _internal::status_error(res->result_int())};
+    }
     if (res) {
         co_return parse_list_objects<ListObjectsVersion::V1>(res.value().body())
             .transform_error([&query](pugi::xml_parse_status err) {
@@ -182,11 +191,18 @@ Client::list_objects(ListObjectsParameters parameters, boost::beast::http::field
 
 meta::crt<boost::asio::awaitable<
     std::expected<ListObjectsV2Result, std::variant<boost::beast::error_code, pugi::xml_parse_status>>>>
-Client::list_objects_v2(ListObjectsV2Parameters parameters, boost::beast::http::fields headers) const {
+Client::list_objects_v2(ListObjectsV2Parameters parameters, boost::beast::http::fields headers,
+                        RequestOptions request_options) const {
     const std::string query = list_objects_prepare_query<ListObjectsVersion::V2>(parameters);
 
     auto res =
-        co_await session_->get(std::format("/{}", parameters.Bucket), query, std::move(headers), false);
+        co_await session_->get(std::format("/{}", parameters.Bucket), query, std::move(headers), false,
+                               request_options);
+    if (res && res->result_int() / 100 != 2) {
+        std::println(std::cerr, "ERROR query {} status {}", query, res->result_int());
+        co_return std::unexpected<std::variant<boost::beast::error_code, pugi::xml_parse_status>>{
+            _internal::status_error(res->result_int())};
+    }
     if (res) {
         co_return parse_list_objects<ListObjectsVersion::V2>(res.value().body())
             .transform_error([&query](pugi::xml_parse_status err) {
@@ -0,0 +1,30 @@
+#include "status_error.hpp"
+
+#include <boost/beast/core/error.hpp>
+#include <boost/system/errc.hpp>             // IWYU pragma: keep
+#include <boost/system/generic_category.hpp> // IWYU pragma: keep
+
+namespace s3cpp::aws::s3::_internal {
+
+boost::beast::error_code status_error(unsigned int status) {
+    using boost::system::errc::errc_t;
+
+    errc_t errc = errc_t::protocol_error;
+    if (status == 400) {
+        errc = errc_t::invalid_argument;
+    } else if (status == 401 || status == 403) {
+        errc = errc_t::permission_denied;
+    } else if (status == 404) {
+        errc = errc_t::no_such_file_or_directory;
+    } else if (status == 408) {
+        errc = errc_t::timed_out;
+    } else if (status == 429 || status == 503) {
+        // throttled, and still so after the session's retries
+        errc = errc_t::resource_unavailable_try_again;
+    } else if (status >= 500) {
+        errc = errc_t::io_error;
+    }
+    return boost::beast::error_code{errc, boost::system::generic_category()};
+}
+
+} // namespace s3cpp::aws::s3::_internal
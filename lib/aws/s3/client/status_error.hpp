@@ -0,0 +1,11 @@
+#pragma once
+
+#include <boost/beast/core/error.hpp>
+
+namespace s3cpp::aws::s3::_internal {
+
+// the closest generic error to an HTTP status that isn't 2xx, for responses whose body is an S3 error rather
+// than the requested result
+[[nodiscard]] boost::beast::error_code status_error(unsigned int status);
+
+} // namespace s3cpp::aws::s3::_internal
@@ -0,0 +1,248 @@
+#include "connection_pool.hpp"
+
+#include "fair_queue.hpp"
+#include "ktls_stream.hpp"
+#include "s3cpp/aws/s3/session.hpp"
+#include "s3cpp/meta.hpp"
+#include "session_extra.hpp"
+
+#include <boost/asio/as_tuple.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/co_spawn.hpp> // IWYU pragma: keep
+#include <boost/asio/detached.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ssl/stream.hpp>
+#include <boost/asio/this_coro.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/beast/core/error.hpp>
+#include <boost/beast/core/stream_traits.hpp>
+#include <boost/beast/core/tcp_stream.hpp>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <openssl/ssl.h>
+#include <optional>
+#include <string>
+#include <sys/socket.h>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace s3cpp::aws::s3::_internal {
+
+namespace {
+
+constexpr auto token = boost::asio::as_tuple(boost::asio::use_awaitable);
+
+[[nodiscard]] boost::asio::ip::tcp::socket &get_socket(Stream &stream) {
+    return std::visit(
+        [](auto &stream_) -> boost::asio::ip::tcp::socket & {
+            return boost::beast::get_lowest_layer(stream_).socket();
+        },
+        stream);
+}
+
+// Reads whatever the TLS layer has buffered or the socket has ready without blocking, true if that is only
+// records OpenSSL handles itself, such as the NewSessionTicket messages a TLS 1.3 server sends after the
+// handshake. Those come after the handshake of a connection that warm_up put into the pool right away.
+[[nodiscard]] bool consume_tls_records(Stream &stream) {
+    std::byte data{};
+    if (stream.index() == 2) {
+        SSL *const ssl = std::get<2>(stream).native_handle();
+        std::size_t n = 0;
+        // KtlsStream keeps its socket non-blocking
+        const int ret = SSL_read_ex(ssl, &data, 1, &n);
+        return ret != 1 && SSL_get_error(ssl, ret) == SSL_ERROR_WANT_READ;
+    }
+    auto &ssl_stream = std::get<1>(stream);
+    auto &socket = ssl_stream.next_layer().socket();
+    const bool was_non_blocking = socket.non_blocking();
+    boost::system::error_code ec;
+    // NOLINTNEXTLINE(bugprone-unused-return-value)
+    socket.non_blocking(true, ec);
+    if (ec.failed()) {
+        return false;
+    }
+    const std::size_t n = ssl_stream.read_some(boost::asio::buffer(&data, 1), ec);
+    boost::system::error_code restore_ec;
+    // NOLINTNEXTLINE(bugprone-unused-return-value)
+    socket.non_blocking(was_non_blocking, restore_ec);
+    return n == 0 && ec == boost::asio::error::would_block && !restore_ec.failed();
+}
+
+// The server must not send anything on an idle HTTP/1.1 connection.
+// If the socket is readable, the peer has either closed it or sent a close_notify / error response,
+// either way the connection can't be reused. Over TLS, the bytes may also be records without application
+// data, which are consumed here.
+[[nodiscard]] bool is_alive(Stream &stream) {
+    auto &socket = get_socket(stream);
+    if (!socket.is_open()) {
+        return false;
+    }
+    std::byte probe{};
+    const auto res = ::recv(socket.native_handle(), &probe, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (res < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return true;
+    }
+    return res > 0 && stream.index() != 0 && consume_tls_records(stream);
+}
+
+template <typename TlsStream> meta::crt<boost::asio::awaitable<void>> shutdown_tls(TlsStream stream) {
+    boost::beast::get_lowest_layer(stream).expires_after(std::chrono::seconds{1});
+    co_await stream.async_shutdown(token);
+    boost::beast::error_code ec;
+    // NOLINTNEXTLINE(bugprone-unused-return-value)
+    boost::beast::get_lowest_layer(stream).socket().shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+}
+
+void close_gracefully(Stream stream) {
+    if (stream.index() == 1) {
+        auto &ssl_stream = std::get<1>(stream);
+        const auto executor = ssl_stream.get_executor();
+        boost::asio::co_spawn(executor, shutdown_tls(std::move(ssl_stream)), boost::asio::detached);
+        return;
+    }
+    if (stream.index() == 2) {
+        auto &ktls_stream = std::get<2>(stream);
+        const auto executor = ktls_stream.get_executor();
+        boost::asio::co_spawn(executor, shutdown_tls(std::move(ktls_stream)), boost::asio::detached);
+        return;
+    }
+    boost::beast::error_code ec;
+    // NOLINTNEXTLINE(bugprone-unused-return-value)
+    std::get<0>(stream).socket().shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+}
+
+} // namespace
+
+ConnectionPool::Lease::Lease(std::shared_ptr<ConnectionPool> pool, std::string key,
+                             std::unique_ptr<Connection> connection)
+    : pool_{std::move(pool)}, key_{std::move(key)}, connection_{std::move(connection)},
+      reused_{connection_ != nullptr} {}
+
+ConnectionPool::Lease::~Lease() {
+    if (pool_ != nullptr) {
+        release(Release::DISCARD);
+    }
+}
+
+void ConnectionPool::Lease::emplace(Stream stream) {
+    connection_ = std::make_unique<Connection>(std::move(stream), std::chrono::steady_clock::now());
+    reused_ = false;
+    pool_->created_++;
+}
+
+void ConnectionPool::Lease::release(Release how) {
+    pool_->give_back(key_, std::move(connection_), how);
+    pool_ = nullptr;
+}
+
+ConnectionPool::Host &ConnectionPool::host(const std::string &key) {
+    return hosts_.try_emplace(key, options_.priority_weights).first->second;
+}
+
+void ConnectionPool::wake_next(Host &host) {
+    if (auto waiter = host.waiters.pop(); waiter.has_value()) {
+        waiter.value()->try_send(boost::system::error_code{});
+    }
+}
+
+void ConnectionPool::give_back(const std::string &key, std::unique_ptr<Connection> connection,
+                               Release how) {
+    std::unique_ptr<Connection> to_close;
+    {
+        const std::scoped_lock lock{mutex_};
+        Host &host = this->host(key);
+        if (connection != nullptr && how == Release::KEEP_ALIVE &&
+            host.idle.size() < options_.max_idle_per_host) {
+            connection->last_used = std::chrono::steady_clock::now();
+            // a fully read response leaves nothing behind, keep only the capacity
+            connection->buffer.clear();
+            host.idle.push_back(std::move(connection));
+        } else {
+            host.total--;
+            to_close = std::move(connection);
+        }
+        // either way, one waiter can now make progress
+        wake_next(host);
+    }
+    if (to_close != nullptr && how != Release::DISCARD) {
+        close_gracefully(std::move(to_close->stream));
+    }
+}
+
+meta::crt<boost::asio::awaitable<std::expected<ConnectionPool::Lease, boost::system::error_code>>>
+ConnectionPool::acquire(std::string key, Priority priority) {
+    using rtype = std::expected<Lease, boost::system::error_code>;
+
+    const auto executor = co_await boost::asio::this_coro::executor;
+    while (true) {
+        std::optional<Lease> lease;
+        std::shared_ptr<Waiter> waiter;
+        std::vector<std::unique_ptr<Connection>> expired;
+        {
+            const std::scoped_lock lock{mutex_};
+            Host &host = this->host(key);
+            const auto now = std::chrono::steady_clock::now();
+            // oldest connections are at the front
+            while (!host.idle.empty() && now - host.idle.front()->last_used >= options_.idle_timeout) {
+                expired.push_back(std::move(host.idle.front()));
+                host.idle.pop_front();
+                host.total--;
+            }
+            // prefer the most recently used connection, it's the least likely to have been closed by the peer
+            while (!host.idle.empty()) {
+                auto connection = std::move(host.idle.back());
+                host.idle.pop_back();
+                if (is_alive(connection->stream)) {
+                    lease.emplace(shared_from_this(), key, std::move(connection));
+                    break;
+                }
+                host.total--;
+                evicted_++;
+            }
+            if (!lease.has_value() && host.total < options_.max_total_per_host) {
+                host.total++;
+                lease.emplace(shared_from_this(), key, nullptr);
+            }
+            if (!lease.has_value()) {
+                waiter = std::make_shared<Waiter>(executor, 1);
+                host.waiters.push(priority, waiter);
+            }
+        }
+        evicted_ += expired.size();
+        for (auto &connection : expired) {
+            close_gracefully(std::move(connection->stream));
+        }
+
+        if (lease.has_value()) {
+            if (lease->is_reused()) {
+                reused_++;
+            }
+            co_return rtype{std::in_place, std::move(lease).value()};
+        }
+        const auto [wait_ec] = co_await waiter->async_receive(token);
+        if (wait_ec.failed()) {
+            const std::scoped_lock lock{mutex_};
+            Host &host = this->host(key);
+            // if we were already woken up, hand the wakeup on to the next waiter
+            if (!host.waiters.erase(waiter)) {
+                wake_next(host);
+            }
+            co_return rtype{std::unexpect, wait_ec};
+        }
+    }
+}
+
+ConnectionPoolStats ConnectionPool::stats() const {
+    return {.created = created_.load(), .reused = reused_.load(), .evicted = evicted_.load()};
+}
+
+ConnectionPool::ConnectionPool(ConnectionPoolOptions options) : options_{options} {}
+
+} // namespace s3cpp::aws::s3::_internal
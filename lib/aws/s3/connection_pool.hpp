@@ -0,0 +1,100 @@
+#pragma once
+
+#include "fair_queue.hpp"
+#include "s3cpp/aws/s3/session.hpp"
+#include "s3cpp/meta.hpp"
+#include "session_extra.hpp"
+
+#include <array>
+#include <atomic>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/experimental/concurrent_channel.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+#include <boost/system/error_code.hpp> // IWYU pragma: keep
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace s3cpp::aws::s3::_internal {
+
+class ConnectionPool : public std::enable_shared_from_this<ConnectionPool> {
+public:
+    struct Connection {
+        Stream stream;
+        std::chrono::time_point<std::chrono::steady_clock> last_used;
+        // kept with the connection, so that its capacity is reused by the next request
+        boost::beast::flat_buffer buffer;
+    };
+
+    enum class Release : std::uint8_t { KEEP_ALIVE, CLOSE, DISCARD };
+
+    // A connection slot checked out of the pool.
+    // If no idle connection was available, the slot is empty and the caller has to emplace a fresh stream.
+    // Unless released explicitly, the connection is discarded on destruction.
+    class Lease {
+    private:
+        std::shared_ptr<ConnectionPool> pool_;
+        std::string key_;
+        std::unique_ptr<Connection> connection_;
+        bool reused_ = false;
+
+    public:
+        [[nodiscard]] Lease(std::shared_ptr<ConnectionPool> pool, std::string key,
+                            std::unique_ptr<Connection> connection);
+        ~Lease();
+
+        [[nodiscard]] Lease(const Lease &) = delete;
+        [[nodiscard]] Lease &operator=(const Lease &) = delete;
+        [[nodiscard]] Lease(Lease &&) noexcept = default;
+        [[nodiscard]] Lease &operator=(Lease &&) = delete;
+
+        [[nodiscard]] bool has_connection() const { return connection_ != nullptr; }
+        [[nodiscard]] bool is_reused() const { return reused_; }
+        [[nodiscard]] Stream &stream() { return connection_->stream; }
+        [[nodiscard]] boost::beast::flat_buffer &buffer() { return connection_->buffer; }
+
+        void emplace(Stream stream);
+        void release(Release how);
+    };
+
+private:
+    using Waiter = boost::asio::experimental::concurrent_channel<void(boost::system::error_code)>;
+
+    struct Host {
+        std::deque<std::unique_ptr<Connection>> idle;
+        std::size_t total = 0;
+        FairQueue<std::shared_ptr<Waiter>> waiters;
+
+        [[nodiscard]] explicit Host(const std::array<double, priority_count> &weights) : waiters{weights} {}
+    };
+
+    ConnectionPoolOptions options_;
+    std::mutex mutex_;
+    std::unordered_map<std::string, Host> hosts_;
+
+    std::atomic<std::size_t> created_;
+    std::atomic<std::size_t> reused_;
+    std::atomic<std::size_t> evicted_;
+
+    [[nodiscard]] Host &host(const std::string &key);
+    // wakes the waiter whose turn it is, if any
+    static void wake_next(Host &host);
+    void give_back(const std::string &key, std::unique_ptr<Connection> connection, Release how);
+
+public:
+    [[nodiscard]] explicit ConnectionPool(ConnectionPoolOptions options);
+
+    // fails only if cancelled while waiting for a free connection
+    // while the pool is at max_total_per_host, freed connections go to the waiters by priority
+    [[nodiscard]] meta::crt<boost::asio::awaitable<std::expected<Lease, boost::system::error_code>>>
+    acquire(std::string key, Priority priority = Priority::NORMAL);
+
+    [[nodiscard]] ConnectionPoolStats stats() const;
+};
+
+} // namespace s3cpp::aws::s3::_internal
@@ -1,13 +1,15 @@
 #include "dns_cache.hpp"
 
+#include "s3cpp/aws/s3/session.hpp"
 #include "s3cpp/meta.hpp"
-#include "session_extra.hpp"
 
+#include <algorithm>
 #include <atomic>
 #include <boost/asio/as_tuple.hpp>
 #include <boost/asio/awaitable.hpp>
 #include <boost/asio/co_spawn.hpp> // IWYU pragma: keep
-#include <boost/asio/io_context.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/experimental/concurrent_channel.hpp>
 #include <boost/asio/ip/basic_resolver_results.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/this_coro.hpp>
@@ -18,33 +20,21 @@
 #include <boost/system/generic_category.hpp> // IWYU pragma: keep
 #include <boost/url/url.hpp>
 #include <chrono>
-#include <exception>
+#include <cstddef>
+#include <cstdint>
 #include <expected>
 #include <memory>
 #include <mutex>
-#include <shared_mutex>
 #include <string>
 #include <utility>
+#include <vector>
 
 namespace s3cpp::aws::s3::_internal {
 
-DnsCache::DnsCache(boost::urls::url endpoint) : endpoint_url(std::move(endpoint)) {
-    boost::asio::io_context context;
-    boost::asio::co_spawn(
-        context, update(),
-        [this](std::exception_ptr exception,
-               std::shared_ptr<const s3cpp::aws::s3::_internal::DnsCache::Endpoints> &&val) {
-            if (exception) {
-                std::rethrow_exception(std::move(exception));
-            }
-            current_endpoints = std::move(val);
-        });
-    context.run();
-}
+DnsCache::DnsCache(boost::urls::url endpoint, DnsOptions options)
+    : endpoint_url(std::move(endpoint)), options(options) {}
 
-[[nodiscard]] s3cpp::meta::crt<
-    boost::asio::awaitable<std::shared_ptr<const s3cpp::aws::s3::_internal::DnsCache::Endpoints>>>
-DnsCache::update() {
+s3cpp::meta::crt<boost::asio::awaitable<void>> DnsCache::update() {
     auto executor = co_await boost::asio::this_coro::executor;
     boost::asio::ip::tcp::resolver resolver{executor};
     const std::string port_or_scheme = endpoint_url.has_port()
@@ -52,49 +42,104 @@ DnsCache::update() {
                                            : (endpoint_url.has_scheme() ? endpoint_url.scheme() : "https");
     auto [resolve_ec, resolved_eps] = co_await resolver.async_resolve(
         endpoint_url.host(), port_or_scheme, boost::asio::as_tuple(boost::asio::use_awaitable));
+    if (!resolve_ec.failed() && resolved_eps.empty()) {
+        resolve_ec = boost::system::error_code{boost::system::errc::host_unreachable,
+                                               boost::system::generic_category()};
+    }
+
+    const auto previous = current_endpoints.load();
+    const auto now = std::chrono::steady_clock::now();
+    auto next = std::make_shared<Endpoints>();
     if (resolve_ec.failed()) {
-        last_error = resolve_ec;
-        co_return nullptr;
+        next->error = resolve_ec;
+        next->failures = previous != nullptr ? previous->failures + 1 : 1;
+        // stale-while-error: keep serving what we had until it goes stale
+        if (previous != nullptr) {
+            next->endpoints = previous->endpoints;
+            next->stale_at = previous->stale_at;
+        }
+        // negative caching: until the next attempt, lookups without usable endpoints fail right away
+        const auto backoff =
+            options.min_retry_backoff * (std::int64_t{1} << std::min(next->failures - 1, std::size_t{16}));
+        next->refresh_at = now + std::min<std::chrono::milliseconds>(backoff, options.max_retry_backoff);
+    } else {
+        next->endpoints = std::move(resolved_eps);
+        next->refresh_at = now + options.ttl;
+        next->stale_at = next->refresh_at + options.max_stale;
     }
-    if (resolved_eps.empty()) {
-        last_error = boost::system::error_code{boost::system::errc::host_unreachable,
-                                               boost::system::generic_category()};
-        co_return nullptr;
+    current_endpoints.store(std::move(next));
+}
+
+void DnsCache::finish_update() {
+    std::vector<std::shared_ptr<Waiter>> woken;
+    {
+        const std::scoped_lock lock{waiters_mutex};
+        being_updated = false;
+        woken = std::exchange(waiters, {});
+    }
+    for (const auto &waiter : woken) {
+        waiter->try_send(boost::system::error_code{});
     }
-    co_return std::make_shared<s3cpp::aws::s3::_internal::DnsCache::Endpoints>(
-        std::chrono::system_clock::now(), std::move(resolved_eps));
+}
+
+s3cpp::meta::crt<boost::asio::awaitable<void>> DnsCache::update_or_wait() {
+    const auto executor = co_await boost::asio::this_coro::executor;
+    std::shared_ptr<Waiter> waiter;
+    {
+        const std::scoped_lock lock{waiters_mutex};
+        bool expected = false;
+        if (!being_updated.compare_exchange_strong(expected, true)) {
+            waiter = std::make_shared<Waiter>(executor, 1);
+            waiters.push_back(waiter);
+        }
+    }
+    if (waiter != nullptr) {
+        // a cancelled wait just looks at whatever is there
+        co_await waiter->async_receive(boost::asio::as_tuple(boost::asio::use_awaitable));
+        co_return;
+    }
+    const boost::scope::scope_exit finish{[this]() { finish_update(); }};
+    co_await update();
+}
+
+s3cpp::meta::crt<boost::asio::awaitable<void>>
+DnsCache::update_in_background(std::shared_ptr<DnsCache> self) {
+    const boost::scope::scope_exit finish{[&self]() { self->finish_update(); }};
+    co_await self->update();
 }
 
 meta::crt<boost::asio::awaitable<
     std::expected<boost::asio::ip::basic_resolver_results<boost::asio::ip::tcp>, boost::system::error_code>>>
 DnsCache::get_endpoint() {
-    std::shared_ptr<const DnsCache::Endpoints> endpoints;
-    while (true) {
-        {
-            const std::shared_lock shared_lock{endpoints_mutex};
-            endpoints = current_endpoints;
-        }
+    using rtype = std::expected<boost::asio::ip::basic_resolver_results<boost::asio::ip::tcp>,
+                                boost::system::error_code>;
+
+    std::shared_ptr<const Endpoints> endpoints = current_endpoints.load();
+    auto now = std::chrono::steady_clock::now();
+    const bool is_usable = endpoints != nullptr && !endpoints->endpoints.empty() && now < endpoints->stale_at;
+    if (endpoints == nullptr || (!is_usable && now >= endpoints->refresh_at)) {
+        // nothing to serve, so this lookup has to wait for DNS
+        co_await update_or_wait();
+        endpoints = current_endpoints.load();
+        now = std::chrono::steady_clock::now();
         if (endpoints == nullptr) {
-            co_return std::expected<boost::asio::ip::basic_resolver_results<boost::asio::ip::tcp>,
-                                    boost::system::error_code>{std::unexpect, last_error};
+            // the first resolve got cancelled
+            co_return rtype{std::unexpect, boost::system::error_code{boost::system::errc::operation_canceled,
+                                                                     boost::system::generic_category()}};
         }
-        if (endpoints->created < std::chrono::system_clock::now() - std::chrono::seconds{60}) {
-            bool expected = false;
-            // Only one coroutine should update the endpoints.
-            // Others don't need to wait on a lock though, they can just continue with the old endpoints.
-            if (being_updated.compare_exchange_strong(expected, true)) {
-                const boost::scope::scope_exit reset_flag{[this]() { being_updated = false; }};
-                auto new_endpoints = co_await update();
-                {
-                    const std::unique_lock lock{endpoints_mutex};
-                    current_endpoints = std::move(new_endpoints);
-                }
-                continue;
-            }
+    } else if (now >= endpoints->refresh_at) {
+        bool expected = false;
+        // Only one coroutine should update the endpoints.
+        // Others don't need to wait, they can just continue with the old endpoints.
+        if (being_updated.compare_exchange_strong(expected, true)) {
+            boost::asio::co_spawn(co_await boost::asio::this_coro::executor,
+                                  update_in_background(shared_from_this()), boost::asio::detached);
         }
-        break;
     }
 
+    if (endpoints->endpoints.empty() || now >= endpoints->stale_at) {
+        co_return rtype{std::unexpect, endpoints->error};
+    }
     co_return endpoints->endpoints;
 }
 
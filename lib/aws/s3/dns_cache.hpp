@@ -1,40 +1,66 @@
 #pragma once
 
+#include "s3cpp/aws/s3/session.hpp"
 #include "s3cpp/meta.hpp"
 
 #include <atomic>
 #include <boost/asio/awaitable.hpp>
+#include <boost/asio/experimental/concurrent_channel.hpp>
 #include <boost/asio/ip/basic_resolver_results.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/system/error_code.hpp> // IWYU pragma: keep
 #include <boost/url/url.hpp>
 #include <chrono>
+#include <cstddef>
 #include <expected>
 #include <memory>
-#include <shared_mutex>
+#include <mutex>
+#include <vector>
 
 namespace s3cpp::aws::s3::_internal {
 
-class DnsCache {
+// Resolved addresses are published as immutable snapshots through an atomic shared_ptr.
+// Lookups never lock and only wait on DNS when there is nothing usable yet (the first lookup, or when the
+// addresses have gone stale), otherwise expired addresses are refreshed in the background while the
+// previous ones keep being served. There is at most one resolve in flight, lookups that have to wait for
+// DNS wait for that one.
+class DnsCache : public std::enable_shared_from_this<DnsCache> {
 public:
     struct Endpoints {
-        std::chrono::time_point<std::chrono::system_clock> created;
+        // empty until the first successful resolve, kept across failed ones
         boost::asio::ip::basic_resolver_results<boost::asio::ip::tcp> endpoints;
+        // error of the last attempt
+        boost::system::error_code error;
+        std::chrono::time_point<std::chrono::steady_clock> refresh_at;
+        // endpoints are not served after this
+        std::chrono::time_point<std::chrono::steady_clock> stale_at;
+        // consecutive failed attempts, for the backoff
+        std::size_t failures = 0;
     };
 
 private:
+    using Waiter = boost::asio::experimental::concurrent_channel<void(boost::system::error_code)>;
+
     boost::urls::url endpoint_url;
-    std::shared_mutex endpoints_mutex;
-    std::shared_ptr<const Endpoints> current_endpoints;
+    DnsOptions options;
+    std::atomic<std::shared_ptr<const Endpoints>> current_endpoints;
+    // a resolve is in flight, set and cleared with waiters_mutex held if anyone may be waiting for it
     std::atomic<bool> being_updated = false;
-    std::atomic<boost::system::error_code> last_error;
+    std::mutex waiters_mutex;
+    // lookups waiting for the resolve in flight
+    std::vector<std::shared_ptr<Waiter>> waiters;
 
-    [[nodiscard]] s3cpp::meta::crt<
-        boost::asio::awaitable<std::shared_ptr<const s3cpp::aws::s3::_internal::DnsCache::Endpoints>>>
-    update();
+    [[nodiscard]] s3cpp::meta::crt<boost::asio::awaitable<void>> update();
+    // clears being_updated and wakes up the waiters
+    void finish_update();
+    // runs an update or waits for the one in flight
+    [[nodiscard]] s3cpp::meta::crt<boost::asio::awaitable<void>> update_or_wait();
+    [[nodiscard]] static s3cpp::meta::crt<boost::asio::awaitable<void>>
+    update_in_background(std::shared_ptr<DnsCache> self);
 
 public:
-    DnsCache(boost::urls::url endpoint);
+    // does not resolve yet, this happens on the first lookup
+    [[nodiscard]] DnsCache(boost::urls::url endpoint, DnsOptions options);
 
     [[nodiscard]] meta::crt<boost::asio::awaitable<std::expected<
         boost::asio::ip::basic_resolver_results<boost::asio::ip::tcp>, boost::system::error_code>>>
@@ -0,0 +1,278 @@
+#include "exchange.hpp"
+
+#include "aws_chunked.hpp"
+#include "s3cpp/aws/s3/session.hpp"
+#include "s3cpp/meta.hpp"
+#include "rate_limiter.hpp"
+#include "session_extra.hpp"
+#include "zero_copy.hpp"
+
+#include <algorithm>
+#include <array>
+#include <boost/asio/as_tuple.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/experimental/awaitable_operators.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/beast/core/stream_traits.hpp>
+#include <boost/system/error_code.hpp>      // IWYU pragma: keep
+#include <boost/system/system_category.hpp> // IWYU pragma: keep
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <sys/types.h>
+#include <unistd.h>
+#include <variant>
+#include <vector>
+
+namespace s3cpp::aws::s3::_internal {
+
+namespace {
+
+constexpr auto token = boost::asio::as_tuple(boost::asio::use_awaitable);
+
+constexpr std::size_t copy_buffer_size = 65536;
+
+constexpr std::size_t rate_limited_chunk = std::size_t{1} << 20;
+
+// fills buffer from fd at offset, a file shorter than that is an error
+[[nodiscard]] boost::system::error_code read_full(int fd, std::span<std::byte> buffer, std::uint64_t offset) {
+    std::size_t done = 0;
+    while (done < buffer.size()) {
+        const auto n =
+            ::pread(fd, buffer.data() + done, buffer.size() - done, static_cast<off_t>(offset + done));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return boost::system::error_code{errno, boost::system::system_category()};
+        }
+        if (n == 0) {
+            return boost::asio::error::eof;
+        }
+        done += static_cast<std::size_t>(n);
+    }
+    return {};
+}
+
+// Reads and frames the next chunk of an upload while the previous one is being written, so that reading and
+// hashing the payload overlap with sending it instead of taking turns.
+class ChunkPipeline {
+private:
+    struct Chunk {
+        std::span<const std::byte> data;
+        ChunkFrame frame;
+        std::size_t frame_size;
+    };
+
+    using chunk_crt = meta::crt<boost::asio::awaitable<std::expected<Chunk, boost::system::error_code>>>;
+    using ec_crt = meta::crt<boost::asio::awaitable<boost::system::error_code>>;
+
+    Exchange &exchange_;
+    UploadBody body_;
+    ChunkEncoder encoder_;
+    std::uint64_t read_ = 0;
+    // chunks of files and streams take turns between these
+    std::array<std::vector<std::byte>, 2> buffers_;
+
+    [[nodiscard]] std::uint64_t size() const {
+        if (body_.stream != nullptr) {
+            return body_.stream->size;
+        }
+        return body_.file.has_value() ? body_.file->size : body_.data.size();
+    }
+
+    // the following chunk, read into buffers_[slot] unless the body is in memory
+    [[nodiscard]] chunk_crt next(std::size_t slot) {
+        using rtype = chunk_crt::value_type;
+
+        const auto want = static_cast<std::size_t>(std::min<std::uint64_t>(size() - read_, aws_chunk_size));
+        std::span<const std::byte> data;
+        if (body_.stream != nullptr) {
+            const std::span<std::byte> dest{buffers_.at(slot).data(), want};
+            for (std::size_t filled = 0; filled < want;) {
+                const auto n = co_await body_.stream->read(dest.subspan(filled));
+                if (!n) {
+                    co_return rtype{std::unexpect, n.error()};
+                }
+                if (n.value() == 0) {
+                    // the stream is shorter than announced
+                    co_return rtype{std::unexpect, boost::asio::error::eof};
+                }
+                filled += n.value();
+            }
+            data = dest;
+        } else if (body_.file.has_value()) {
+            const std::span<std::byte> dest{buffers_.at(slot).data(), want};
+            if (const auto read_ec = read_full(body_.file->fd, dest, body_.file->offset + read_);
+                read_ec.failed()) {
+                co_return rtype{std::unexpect, read_ec};
+            }
+            data = dest;
+        } else {
+            data = body_.data.subspan(static_cast<std::size_t>(read_), want);
+        }
+        read_ += want;
+
+        rtype ret{Chunk{.data = data, .frame = {}, .frame_size = 0}};
+        ret->frame_size = encoder_.begin_chunk(data, ret->frame).size();
+        co_return ret;
+    }
+
+    [[nodiscard]] ec_crt write(std::span<const boost::asio::const_buffer> buffers) {
+        auto &stream = exchange_.lease.stream();
+        std::visit(
+            [](auto &stream_) {
+                boost::beast::get_lowest_layer(stream_).expires_after(std::chrono::seconds{300});
+            },
+            stream);
+        const auto [ec, n] = co_await std::visit(
+            [buffers](auto &stream_) { return boost::asio::async_write(stream_, buffers, token); }, stream);
+        co_return ec;
+    }
+
+    [[nodiscard]] ec_crt write(Chunk chunk) {
+        const std::string_view end = encoder_.end_chunk();
+        const std::array<boost::asio::const_buffer, 3> buffers{
+            boost::asio::buffer(chunk.frame.data(), chunk.frame_size),
+            boost::asio::buffer(chunk.data.data(), chunk.data.size()),
+            boost::asio::buffer(end.data(), end.size()),
+        };
+        if (const auto ec = co_await write(buffers); ec.failed()) {
+            co_return ec;
+        }
+        co_return co_await exchange_.throttle(chunk.data.size());
+    }
+
+public:
+    [[nodiscard]] ChunkPipeline(Exchange &exchange, UploadBody body, ChunkEncoder encoder)
+        : exchange_{exchange}, body_{body}, encoder_{std::move(encoder)} {
+        if (body_.stream != nullptr || body_.file.has_value()) {
+            const auto buffer_size =
+                static_cast<std::size_t>(std::min<std::uint64_t>(size(), aws_chunk_size));
+            buffers_ = {std::vector<std::byte>(buffer_size), std::vector<std::byte>(buffer_size)};
+        }
+    }
+
+    [[nodiscard]] ec_crt run() {
+        using namespace boost::asio::experimental::awaitable_operators;
+
+        if (size() != 0) {
+            auto current = co_await next(0);
+            if (!current) {
+                co_return current.error();
+            }
+            for (std::size_t slot = 1; read_ < size(); slot ^= 1) {
+                auto [write_ec, following] = co_await (write(current.value()) && next(slot));
+                if (write_ec.failed()) {
+                    co_return write_ec;
+                }
+                if (!following) {
+                    co_return following.error();
+                }
+                current = std::move(following);
+            }
+            if (const auto write_ec = co_await write(current.value()); write_ec.failed()) {
+                co_return write_ec;
+            }
+        }
+
+        ChunkFrame frame{};
+        const std::string_view finish = encoder_.finish(frame);
+        if (finish.empty()) {
+            co_return boost::system::error_code{};
+        }
+        const std::array<boost::asio::const_buffer, 1> buffers{
+            boost::asio::buffer(finish.data(), finish.size())};
+        co_return co_await write(buffers);
+    }
+};
+
+} // namespace
+
+meta::crt<boost::asio::awaitable<boost::system::error_code>> Exchange::throttle(std::uint64_t bytes) {
+    if (rate_limiter == nullptr || bytes == 0) {
+        co_return boost::system::error_code{};
+    }
+    co_return co_await rate_limiter->acquire(0, bytes, priority);
+}
+
+std::size_t Exchange::max_chunk() const {
+    return rate_limiter != nullptr && rate_limiter->is_limited() ? rate_limited_chunk : zero_copy_chunk;
+}
+
+meta::crt<boost::asio::awaitable<boost::system::error_code>> Exchange::send_file(FileRange file) {
+    auto &stream = lease.stream();
+    std::uint64_t sent = 0;
+    if (can_send_file(stream)) {
+        while (sent < file.size) {
+            const auto chunk =
+                static_cast<std::size_t>(std::min<std::uint64_t>(file.size - sent, max_chunk()));
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{300};
+            const auto [ec, n] =
+                co_await async_send_file(stream, file.fd, file.offset + sent, chunk, deadline);
+            sent += n;
+            if (const auto throttle_ec = co_await throttle(n); throttle_ec.failed()) {
+                co_return throttle_ec;
+            }
+            if (ec == boost::asio::error::operation_not_supported) {
+                break;
+            }
+            if (ec.failed()) {
+                co_return ec;
+            }
+        }
+    }
+
+    // TLS without kernel offload, or the kernel refused
+    std::vector<std::byte> buffer(
+        static_cast<std::size_t>(std::min<std::uint64_t>(file.size - sent, copy_buffer_size)));
+    while (sent < file.size) {
+        const std::size_t want = std::min(buffer.size(), static_cast<std::size_t>(file.size - sent));
+        const auto n = ::pread(file.fd, buffer.data(), want, static_cast<off_t>(file.offset + sent));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            co_return boost::system::error_code{errno, boost::system::system_category()};
+        }
+        if (n == 0) {
+            // the file is shorter than announced
+            co_return boost::asio::error::eof;
+        }
+        std::visit(
+            [](auto &stream_) {
+                boost::beast::get_lowest_layer(stream_).expires_after(std::chrono::seconds{300});
+            },
+            stream);
+        const auto [ec, written] = co_await std::visit(
+            [&buffer, n](auto &stream_) {
+                return boost::asio::async_write(
+                    stream_, boost::asio::buffer(buffer.data(), static_cast<std::size_t>(n)), token);
+            },
+            stream);
+        if (ec.failed()) {
+            co_return ec;
+        }
+        sent += written;
+        if (const auto throttle_ec = co_await throttle(written); throttle_ec.failed()) {
+            co_return throttle_ec;
+        }
+    }
+    co_return boost::system::error_code{};
+}
+
+meta::crt<boost::asio::awaitable<boost::system::error_code>> Exchange::send_chunked(UploadBody body,
+                                                                                 ChunkEncoder encoder) {
+    ChunkPipeline pipeline{*this, body, std::move(encoder)};
+    co_return co_await pipeline.run();
+}
+
+} // namespace s3cpp::aws::s3::_internal
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "aws_chunked.hpp"
+#include "connection_pool.hpp"
+#include "load_balancer.hpp"
+#include "rate_limiter.hpp"
+#include "s3cpp/aws/s3/session.hpp"
+#include "s3cpp/meta.hpp"
+
+#include <boost/asio/awaitable.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+#include <boost/beast/http/buffer_body.hpp>
+#include <boost/beast/http/empty_body.hpp>
+#include <boost/beast/http/parser.hpp>
+#include <boost/system/error_code.hpp> // IWYU pragma: keep
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+
+namespace s3cpp::aws::s3::_internal {
+
+// the payload of an upload, from stream if set, else from file if set, else data
+struct UploadBody {
+    std::span<const std::byte> data;
+    std::optional<FileRange> file;
+    UploadStream *stream = nullptr;
+};
+
+// A request that has been sent and whose response header has been read.
+// The body is still pending on the connection.
+struct Exchange {
+    // declared first so that the request stays outstanding until the connection is released
+    LoadBalancer::Ticket ticket;
+    ConnectionPool::Lease lease;
+    boost::beast::http::response_parser<boost::beast::http::empty_body> header_parser;
+
+    // the body is either read raw, for responses with a known length,
+    // or through a parser for chunked responses and those delimited by EOF
+    std::optional<std::uint64_t> remaining;
+    std::unique_ptr<boost::beast::http::response_parser<boost::beast::http::buffer_body>> body_parser;
+    bool done = false;
+
+    std::shared_ptr<RateLimiter> rate_limiter;
+    Priority priority = Priority::NORMAL;
+
+    // read buffer of the connection, only valid once the lease has one
+    [[nodiscard]] boost::beast::flat_buffer &buffer() { return lease.buffer(); }
+
+    // pays for bytes that went over the connection, waits while the rate limit is exceeded
+    [[nodiscard]] meta::crt<boost::asio::awaitable<boost::system::error_code>> throttle(std::uint64_t bytes);
+    // transfers that go out in one piece are split into chunks of this size, so that limits stay smooth
+    [[nodiscard]] std::size_t max_chunk() const;
+
+    // sends the body of a request whose header has already been written
+    [[nodiscard]] meta::crt<boost::asio::awaitable<boost::system::error_code>> send_file(FileRange file);
+    // sends body framed by encoder, for requests whose header has already been written
+    [[nodiscard]] meta::crt<boost::asio::awaitable<boost::system::error_code>>
+    send_chunked(UploadBody body, ChunkEncoder encoder);
+};
+
+} // namespace s3cpp::aws::s3::_internal
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "s3cpp/aws/s3/session.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <deque>
+#include <limits>
+#include <optional>
+#include <utility>
+
+namespace s3cpp::aws::s3::_internal {
+
+// Weighted fair queueing across the priority classes, for items that all cost the same (stride scheduling).
+// Every class has a virtual clock that advances by 1 / weight per item it takes. The class whose clock is
+// furthest behind goes next, so while all classes are backlogged each gets its weight's share, and a heavy
+// class can't starve a light one. Classes that were idle start at the current virtual time instead of
+// cashing in on the time they spent idle.
+template <typename T> class FairQueue {
+private:
+    struct Class {
+        std::deque<T> items;
+        double pass = 0;
+    };
+
+    std::array<double, priority_count> weights_;
+    std::array<Class, priority_count> classes_;
+    double virtual_time_ = 0;
+    std::size_t size_ = 0;
+
+public:
+    [[nodiscard]] explicit FairQueue(std::array<double, priority_count> weights) : weights_{weights} {}
+
+    [[nodiscard]] bool empty() const { return size_ == 0; }
+
+    void push(Priority priority, T item) {
+        Class &cls = classes_.at(static_cast<std::size_t>(priority));
+        if (cls.items.empty()) {
+            cls.pass = std::max(cls.pass, virtual_time_);
+        }
+        cls.items.push_back(std::move(item));
+        size_++;
+    }
+
+    [[nodiscard]] std::optional<T> pop() {
+        Class *next = nullptr;
+        std::size_t next_idx = 0;
+        // ties go to the higher class
+        for (std::size_t i = 0; i < classes_.size(); i++) {
+            if (!classes_[i].items.empty() && (next == nullptr || classes_[i].pass < next->pass)) {
+                next = &classes_[i];
+                next_idx = i;
+            }
+        }
+        if (next == nullptr) {
+            return std::nullopt;
+        }
+        virtual_time_ = next->pass;
+        next->pass += 1.0 / std::max(weights_.at(next_idx), std::numeric_limits<double>::min());
+        T ret = std::move(next->items.front());
+        next->items.pop_front();
+        size_--;
+        return ret;
+    }
+
+    // returns whether the item was still queued
+    bool erase(const T &item) {
+        for (Class &cls : classes_) {
+            if (std::erase(cls.items, item) != 0) {
+                size_--;
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+} // namespace s3cpp::aws::s3::_internal
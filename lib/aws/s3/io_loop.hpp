@@ -0,0 +1,80 @@
+#pragma once
+
+#include <boost/asio/cancel_after.hpp>
+#include <boost/asio/compose.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/socket_base.hpp>
+#include <boost/beast/core/error.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace s3cpp::aws::s3::_internal {
+
+// what a non-blocking operation has to wait for before it can make progress
+enum class Want : std::uint8_t { NOTHING, READ, WRITE };
+
+struct Progress {
+    Want want = Want::NOTHING;
+    boost::system::error_code ec;
+    std::size_t n = 0;
+};
+
+// Calls step until it no longer wants to wait, waiting for the socket in between.
+// step does the actual non-blocking syscalls and keeps its own state across calls.
+template <typename Signature, typename Step> class IoLoop {
+private:
+    boost::asio::ip::tcp::socket &socket_;
+    std::chrono::steady_clock::time_point deadline_;
+    Step step_;
+
+    template <typename Self> static void complete(Self &self, const Progress &progress) {
+        if constexpr (std::is_same_v<Signature, void(boost::system::error_code)>) {
+            self.complete(progress.ec);
+        } else {
+            self.complete(progress.ec, progress.n);
+        }
+    }
+
+public:
+    [[nodiscard]] IoLoop(boost::asio::ip::tcp::socket &socket, std::chrono::steady_clock::time_point deadline,
+                         Step step)
+        : socket_{socket}, deadline_{deadline}, step_{std::move(step)} {}
+
+    template <typename Self> void operator()(Self &self, boost::system::error_code wait_ec = {}) {
+        const auto now = std::chrono::steady_clock::now();
+        if (wait_ec.failed()) {
+            const bool timed_out = wait_ec == boost::asio::error::operation_aborted && now >= deadline_;
+            complete(self, {.ec = timed_out ? boost::beast::error::timeout : wait_ec});
+            return;
+        }
+        const Progress progress = step_();
+        if (progress.want == Want::NOTHING) {
+            complete(self, progress);
+            return;
+        }
+        if (now >= deadline_) {
+            complete(self, {.ec = boost::beast::error::timeout, .n = progress.n});
+            return;
+        }
+        const auto wait_type = progress.want == Want::READ ? boost::asio::socket_base::wait_read
+                                                           : boost::asio::socket_base::wait_write;
+        if (deadline_ == std::chrono::steady_clock::time_point::max()) {
+            socket_.async_wait(wait_type, std::move(self));
+        } else {
+            socket_.async_wait(wait_type, boost::asio::cancel_after(deadline_ - now, std::move(self)));
+        }
+    }
+};
+
+template <typename Signature, typename Step, typename CompletionToken>
+auto async_io_loop(boost::asio::ip::tcp::socket &socket, std::chrono::steady_clock::time_point deadline,
+                   Step step, CompletionToken &&token) {
+    return boost::asio::async_compose<CompletionToken, Signature>(
+        IoLoop<Signature, Step>{socket, deadline, std::move(step)}, token, socket);
+}
+
+} // namespace s3cpp::aws::s3::_internal
@@ -0,0 +1,103 @@
+#include "ktls_stream.hpp"
+
+#include "io_loop.hpp"
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/ssl/error.hpp>
+#include <boost/system/error_code.hpp>       // IWYU pragma: keep
+#include <boost/system/system_category.hpp> // IWYU pragma: keep
+#include <cerrno>
+#include <cstddef>
+#include <openssl/bio.h>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+
+namespace s3cpp::aws::s3::_internal {
+
+KtlsStream::KtlsStream(const executor_type &executor, SSL_CTX *ssl_ctx)
+    : socket_{executor}, ssl_{SSL_new(ssl_ctx)} {
+    // retrying a partial write with different buffers is fine, we never write the same bytes twice
+    SSL_set_mode(ssl_.get(), SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+}
+
+Progress KtlsStream::make_progress(int ret, std::size_t n) const {
+    if (ret > 0) {
+        return {.n = n};
+    }
+    // errno has to be read before anything else can clobber it
+    const int sys_errno = errno;
+    switch (SSL_get_error(ssl_.get(), ret)) {
+    case SSL_ERROR_WANT_READ:
+        return {.want = Want::READ};
+    case SSL_ERROR_WANT_WRITE:
+        return {.want = Want::WRITE};
+    case SSL_ERROR_ZERO_RETURN:
+        return {.ec = boost::asio::error::eof};
+    case SSL_ERROR_SYSCALL:
+        if (sys_errno != 0) {
+            return {.ec = boost::system::error_code{sys_errno, boost::system::system_category()}};
+        }
+        return {.ec = boost::asio::ssl::error::stream_truncated};
+    default: {
+        const auto code = ::ERR_get_error();
+        if (ERR_GET_REASON(code) == SSL_R_UNEXPECTED_EOF_WHILE_READING) {
+            return {.ec = boost::asio::ssl::error::stream_truncated};
+        }
+        return {.ec = boost::system::error_code{static_cast<int>(code),
+                                                boost::asio::error::get_ssl_category()}};
+    }
+    }
+}
+
+Progress KtlsStream::handshake_step() {
+    if (SSL_get_fd(ssl_.get()) < 0) {
+        boost::system::error_code ec;
+        // NOLINTNEXTLINE(bugprone-unused-return-value)
+        socket_.non_blocking(true, ec);
+        if (ec.failed()) {
+            return {.ec = ec};
+        }
+        if (SSL_set_fd(ssl_.get(), socket_.native_handle()) != 1) {
+            return {.ec = boost::system::error_code{static_cast<int>(::ERR_get_error()),
+                                                    boost::asio::error::get_ssl_category()}};
+        }
+    }
+    ::ERR_clear_error();
+    errno = 0;
+    return make_progress(SSL_connect(ssl_.get()), 0);
+}
+
+Progress KtlsStream::shutdown_step() {
+    ::ERR_clear_error();
+    errno = 0;
+    // 0 means our close_notify is out, there is no point in waiting for the server's
+    const int ret = SSL_shutdown(ssl_.get());
+    return make_progress(ret < 0 ? ret : 1, 0);
+}
+
+Progress KtlsStream::read_step(boost::asio::mutable_buffer buffer) {
+    if (buffer.size() == 0) {
+        return {};
+    }
+    ::ERR_clear_error();
+    errno = 0;
+    std::size_t n = 0;
+    return make_progress(SSL_read_ex(ssl_.get(), buffer.data(), buffer.size(), &n), n);
+}
+
+Progress KtlsStream::write_step(boost::asio::const_buffer buffer) {
+    if (buffer.size() == 0) {
+        return {};
+    }
+    ::ERR_clear_error();
+    errno = 0;
+    std::size_t n = 0;
+    return make_progress(SSL_write_ex(ssl_.get(), buffer.data(), buffer.size(), &n), n);
+}
+
+bool KtlsStream::is_ktls_send() const { return BIO_get_ktls_send(SSL_get_wbio(ssl_.get())) != 0; }
+
+bool KtlsStream::is_ktls_recv() const { return BIO_get_ktls_recv(SSL_get_rbio(ssl_.get())) != 0; }
+
+} // namespace s3cpp::aws::s3::_internal
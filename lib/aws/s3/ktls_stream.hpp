@@ -0,0 +1,117 @@
+#pragma once
+
+#include "io_loop.hpp"
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/cancel_after.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/system/error_code.hpp> // IWYU pragma: keep
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <openssl/ssl.h>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace s3cpp::aws::s3::_internal {
+
+// A TLS client stream where OpenSSL does the socket I/O itself.
+// asio::ssl::stream feeds OpenSSL through a memory BIO pair, which rules out kernel TLS. Here OpenSSL
+// reads and writes the socket directly, so it can hand the record layer to the kernel after the handshake
+// if the kernel and the negotiated cipher support it. From then on, sendfile and splice work on the socket.
+class KtlsStream {
+public:
+    using executor_type = boost::asio::any_io_executor;
+
+private:
+    struct SslDeleter {
+        void operator()(SSL *ssl) const { SSL_free(ssl); }
+    };
+
+    // records are at most 16KiB, smaller buffers get gathered into one
+    constexpr static std::size_t max_record_size = 16384;
+
+    boost::asio::ip::tcp::socket socket_;
+    // declared after the socket, OpenSSL doesn't own the file descriptor
+    std::unique_ptr<SSL, SslDeleter> ssl_;
+    std::chrono::steady_clock::time_point deadline_ = std::chrono::steady_clock::time_point::max();
+    std::vector<std::byte> write_buffer_;
+
+    // translates the return value of an SSL_* call
+    [[nodiscard]] Progress make_progress(int ret, std::size_t n) const;
+
+    [[nodiscard]] Progress handshake_step();
+    [[nodiscard]] Progress shutdown_step();
+    [[nodiscard]] Progress read_step(boost::asio::mutable_buffer buffer);
+    [[nodiscard]] Progress write_step(boost::asio::const_buffer buffer);
+
+    template <typename BufferSequence> [[nodiscard]] static auto first_buffer(const BufferSequence &buffers) {
+        for (auto it = boost::asio::buffer_sequence_begin(buffers);
+             it != boost::asio::buffer_sequence_end(buffers); ++it) {
+            if (boost::asio::buffer_size(*it) > 0) {
+                return *it;
+            }
+        }
+        return std::remove_cvref_t<decltype(*boost::asio::buffer_sequence_begin(buffers))>{};
+    }
+
+public:
+    [[nodiscard]] KtlsStream(const executor_type &executor, SSL_CTX *ssl_ctx);
+
+    [[nodiscard]] executor_type get_executor() { return socket_.get_executor(); }
+    [[nodiscard]] boost::asio::ip::tcp::socket &socket() { return socket_; }
+    [[nodiscard]] SSL *native_handle() { return ssl_.get(); }
+    [[nodiscard]] std::chrono::steady_clock::time_point deadline() const { return deadline_; }
+
+    // like beast::tcp_stream, applies to all operations started afterwards
+    void expires_after(std::chrono::steady_clock::duration duration) {
+        deadline_ = std::chrono::steady_clock::now() + duration;
+    }
+
+    // whether the kernel took over encryption / decryption
+    [[nodiscard]] bool is_ktls_send() const;
+    [[nodiscard]] bool is_ktls_recv() const;
+
+    template <typename ConnectToken>
+    auto async_connect(const boost::asio::ip::tcp::endpoint &endpoint, ConnectToken &&token) {
+        return socket_.async_connect(
+            endpoint, boost::asio::cancel_after(deadline_ - std::chrono::steady_clock::now(),
+                                                std::forward<ConnectToken>(token)));
+    }
+
+    template <typename HandshakeToken> auto async_handshake(HandshakeToken &&token) {
+        return async_io_loop<void(boost::system::error_code)>(
+            socket_, deadline_, [this]() { return handshake_step(); }, std::forward<HandshakeToken>(token));
+    }
+
+    template <typename ShutdownToken> auto async_shutdown(ShutdownToken &&token) {
+        return async_io_loop<void(boost::system::error_code)>(
+            socket_, deadline_, [this]() { return shutdown_step(); }, std::forward<ShutdownToken>(token));
+    }
+
+    template <typename MutableBufferSequence, typename ReadToken>
+    auto async_read_some(const MutableBufferSequence &buffers, ReadToken &&token) {
+        const boost::asio::mutable_buffer buffer = first_buffer(buffers);
+        return async_io_loop<void(boost::system::error_code, std::size_t)>(
+            socket_, deadline_, [this, buffer]() { return read_step(buffer); },
+            std::forward<ReadToken>(token));
+    }
+
+    template <typename ConstBufferSequence, typename WriteToken>
+    auto async_write_some(const ConstBufferSequence &buffers, WriteToken &&token) {
+        boost::asio::const_buffer buffer = first_buffer(buffers);
+        // beast hands us the header in many small pieces, each of them would become a record of its own
+        if (buffer.size() < max_record_size && boost::asio::buffer_size(buffers) > buffer.size()) {
+            write_buffer_.resize(max_record_size);
+            const std::size_t n = boost::asio::buffer_copy(boost::asio::buffer(write_buffer_), buffers);
+            buffer = boost::asio::buffer(write_buffer_.data(), n);
+        }
+        return async_io_loop<void(boost::system::error_code, std::size_t)>(
+            socket_, deadline_, [this, buffer]() { return write_step(buffer); },
+            std::forward<WriteToken>(token));
+    }
+};
+
+} // namespace s3cpp::aws::s3::_internal
@@ -0,0 +1,37 @@
+#include "latency_tracker.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+
+namespace s3cpp::aws::s3::_internal {
+
+void LatencyTracker::add(std::chrono::microseconds latency) {
+    const std::scoped_lock lock{mutex_};
+    samples_[next_] = latency;
+    next_ = (next_ + 1) % window;
+    count_ = std::min(count_ + 1, window);
+}
+
+std::optional<std::chrono::microseconds> LatencyTracker::percentile(double fraction,
+                                                                    std::size_t min_samples) const {
+    std::array<std::chrono::microseconds, window> samples;
+    std::size_t count = 0;
+    {
+        const std::scoped_lock lock{mutex_};
+        count = count_;
+        samples = samples_;
+    }
+    if (count == 0 || count < min_samples) {
+        return std::nullopt;
+    }
+    const auto idx = std::min(static_cast<std::size_t>(fraction * static_cast<double>(count)), count - 1);
+    std::ranges::nth_element(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(idx),
+                             samples.begin() + static_cast<std::ptrdiff_t>(count));
+    return samples[idx];
+}
+
+} // namespace s3cpp::aws::s3::_internal
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+
+namespace s3cpp::aws::s3::_internal {
+
+// Keeps the most recent request latencies, to derive the hedging delay from.
+class LatencyTracker {
+private:
+    static constexpr std::size_t window = 512;
+
+    mutable std::mutex mutex_;
+    std::array<std::chrono::microseconds, window> samples_{};
+    std::size_t count_ = 0;
+    std::size_t next_ = 0;
+
+public:
+    void add(std::chrono::microseconds latency);
+    // nullopt until at least min_samples latencies have been observed
+    [[nodiscard]] std::optional<std::chrono::microseconds> percentile(double fraction,
+                                                                      std::size_t min_samples) const;
+};
+
+} // namespace s3cpp::aws::s3::_internal
@@ -0,0 +1,199 @@
+#include "load_balancer.hpp"
+
+#include "dns_cache.hpp"
+#include "s3cpp/aws/s3/session.hpp"
+#include "s3cpp/meta.hpp"
+
+#include <algorithm>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/ip/basic_resolver_results.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/system/errc.hpp>             // IWYU pragma: keep
+#include <boost/system/error_code.hpp>       // IWYU pragma: keep
+#include <boost/system/generic_category.hpp> // IWYU pragma: keep
+#include <boost/url/url.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <format>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace s3cpp::aws::s3::_internal {
+
+LoadBalancer::Ticket::Ticket(std::shared_ptr<LoadBalancer> load_balancer, std::shared_ptr<Node> node)
+    : load_balancer_{std::move(load_balancer)}, node_{std::move(node)},
+      start_{std::chrono::steady_clock::now()} {}
+
+LoadBalancer::Ticket::~Ticket() {
+    if (load_balancer_ != nullptr) {
+        const std::scoped_lock lock{load_balancer_->mutex_};
+        node_->outstanding--;
+    }
+}
+
+void LoadBalancer::Ticket::restart() { start_ = std::chrono::steady_clock::now(); }
+
+void LoadBalancer::Ticket::report(bool success) {
+    load_balancer_->report(
+        *node_,
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_),
+        success);
+}
+
+LoadBalancer::LoadBalancer(const boost::urls::url &endpoint, LoadBalancingOptions options,
+                           DnsOptions dns_options)
+    : options_{std::move(options)} {
+    gateways_.emplace_back(endpoint, std::make_shared<DnsCache>(endpoint, dns_options));
+    for (const auto &gateway : options_.gateways) {
+        gateways_.emplace_back(gateway, std::make_shared<DnsCache>(gateway, dns_options));
+    }
+}
+
+void LoadBalancer::update_nodes(
+    std::size_t gateway_idx, const boost::asio::ip::basic_resolver_results<boost::asio::ip::tcp> &resolved) {
+    Gateway &gateway = gateways_[gateway_idx];
+    // the DnsCache hands out the same results until it re-resolves
+    if (gateway.resolved == resolved) {
+        return;
+    }
+    gateway.resolved = resolved;
+
+    // keep the statistics of addresses that are still around
+    std::vector<std::shared_ptr<Node>> nodes;
+    for (const auto &entry : resolved) {
+        const auto iter = std::ranges::find_if(
+            gateway.nodes, [&entry](const auto &node) { return node->address == entry.endpoint(); });
+        if (iter != gateway.nodes.end()) {
+            nodes.push_back(*iter);
+            continue;
+        }
+        auto node = std::make_shared<Node>();
+        node->gateway = gateway.url;
+        node->address = entry.endpoint();
+        node->pool_key = std::format("{}://{}@{}", gateway.url.scheme(), gateway.url.encoded_host_and_port(),
+                                     entry.endpoint().address().to_string());
+        nodes.push_back(std::move(node));
+    }
+    gateway.nodes = std::move(nodes);
+
+    nodes_.clear();
+    for (const auto &other : gateways_) {
+        nodes_.insert(nodes_.end(), other.nodes.begin(), other.nodes.end());
+    }
+}
+
+meta::crt<boost::asio::awaitable<std::expected<LoadBalancer::Ticket, boost::system::error_code>>>
+LoadBalancer::select(std::vector<const Node *> tried) {
+    using rtype = std::expected<Ticket, boost::system::error_code>;
+
+    boost::system::error_code last_error{boost::system::errc::host_unreachable,
+                                         boost::system::generic_category()};
+    for (std::size_t idx = 0; idx < gateways_.size(); idx++) {
+        const auto resolved = co_await gateways_[idx].dns_cache->get_endpoint();
+        if (!resolved) {
+            last_error = resolved.error();
+            continue;
+        }
+        const std::scoped_lock lock{mutex_};
+        update_nodes(idx, resolved.value());
+    }
+
+    const std::scoped_lock lock{mutex_};
+    if (nodes_.empty()) {
+        co_return rtype{std::unexpect, last_error};
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    const auto is_better = [](const Node &lhs, const Node &rhs) {
+        if (lhs.outstanding != rhs.outstanding) {
+            return lhs.outstanding < rhs.outstanding;
+        }
+        return lhs.latency_us < rhs.latency_us;
+    };
+    // start at a rotating offset, so that ties don't all land on the first address
+    const std::size_t offset = next_++;
+    std::shared_ptr<Node> best;
+    std::shared_ptr<Node> best_ejected;
+    for (std::size_t i = 0; i < nodes_.size(); i++) {
+        const auto &node = nodes_[(offset + i) % nodes_.size()];
+        if (std::ranges::contains(tried, node.get())) {
+            continue;
+        }
+        auto &candidate = node->ejected_until > now ? best_ejected : best;
+        if (candidate == nullptr || is_better(*node, *candidate)) {
+            candidate = node;
+        }
+    }
+    // if everything is ejected, we still have to send the request somewhere
+    if (best == nullptr) {
+        best = std::move(best_ejected);
+    }
+    if (best == nullptr) {
+        co_return rtype{std::unexpect, boost::system::error_code{boost::system::errc::host_unreachable,
+                                                                 boost::system::generic_category()}};
+    }
+    best->outstanding++;
+    co_return rtype{std::in_place, shared_from_this(), std::move(best)};
+}
+
+void LoadBalancer::report(Node &node, std::chrono::microseconds latency, bool success) {
+    const std::scoped_lock lock{mutex_};
+    const double alpha = options_.ewma_alpha;
+    const auto latency_us = static_cast<double>(latency.count());
+    node.latency_us = node.samples == 0 ? latency_us : (alpha * latency_us) + ((1 - alpha) * node.latency_us);
+    node.error_rate = (alpha * (success ? 0.0 : 1.0)) + ((1 - alpha) * node.error_rate);
+    node.samples++;
+
+    const auto now = std::chrono::steady_clock::now();
+    if (node.samples < options_.min_samples || node.ejected_until > now) {
+        return;
+    }
+
+    double fastest_us = std::numeric_limits<double>::max();
+    std::size_t healthy = 0;
+    for (const auto &other : nodes_) {
+        if (other->ejected_until > now) {
+            continue;
+        }
+        healthy++;
+        if (other.get() != &node && other->samples >= options_.min_samples) {
+            fastest_us = std::min(fastest_us, other->latency_us);
+        }
+    }
+    // never eject the last healthy address
+    if (healthy <= 1) {
+        return;
+    }
+    if (node.error_rate > options_.max_error_rate ||
+        node.latency_us > fastest_us * options_.max_latency_factor) {
+        node.ejected_until = now + options_.ejection_time;
+        // start over once the address comes back, it then gets probed first due to the zero latency
+        node.samples = 0;
+        node.latency_us = 0;
+        node.error_rate = 0;
+    }
+}
+
+std::vector<EndpointStats> LoadBalancer::stats() const {
+    const std::scoped_lock lock{mutex_};
+    const auto now = std::chrono::steady_clock::now();
+    std::vector<EndpointStats> ret;
+    ret.reserve(nodes_.size());
+    for (const auto &node : nodes_) {
+        ret.push_back({.gateway = node->gateway.buffer(),
+                       .address = node->address.address().to_string(),
+                       .outstanding = node->outstanding,
+                       .latency = std::chrono::microseconds{static_cast<std::int64_t>(node->latency_us)},
+                       .error_rate = node->error_rate,
+                       .ejected = node->ejected_until > now});
+    }
+    return ret;
+}
+
+} // namespace s3cpp::aws::s3::_internal
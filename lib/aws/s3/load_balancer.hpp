@@ -0,0 +1,96 @@
+#pragma once
+
+#include "dns_cache.hpp"
+#include "s3cpp/aws/s3/session.hpp"
+#include "s3cpp/meta.hpp"
+
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/ip/basic_resolver_results.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/system/error_code.hpp> // IWYU pragma: keep
+#include <boost/url/url.hpp>
+#include <chrono>
+#include <cstddef>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace s3cpp::aws::s3::_internal {
+
+// Spreads requests across all addresses of all gateways.
+// Picks the address with the fewest outstanding requests, and temporarily ejects addresses that are
+// failing or much slower than the rest.
+class LoadBalancer : public std::enable_shared_from_this<LoadBalancer> {
+public:
+    struct Node {
+        // scheme, host and port used for SNI and signing
+        boost::urls::url gateway;
+        boost::asio::ip::tcp::endpoint address;
+        std::string pool_key;
+
+        // guarded by LoadBalancer::mutex_
+        std::size_t outstanding = 0;
+        std::size_t samples = 0;
+        double latency_us = 0;
+        double error_rate = 0;
+        std::chrono::time_point<std::chrono::steady_clock> ejected_until;
+    };
+
+    // A request in flight on a node. Counts as outstanding until destroyed.
+    class Ticket {
+    private:
+        std::shared_ptr<LoadBalancer> load_balancer_;
+        std::shared_ptr<Node> node_;
+        std::chrono::time_point<std::chrono::steady_clock> start_;
+
+    public:
+        [[nodiscard]] Ticket(std::shared_ptr<LoadBalancer> load_balancer, std::shared_ptr<Node> node);
+        ~Ticket();
+
+        [[nodiscard]] Ticket(const Ticket &) = delete;
+        [[nodiscard]] Ticket &operator=(const Ticket &) = delete;
+        [[nodiscard]] Ticket(Ticket &&) noexcept = default;
+        [[nodiscard]] Ticket &operator=(Ticket &&) = delete;
+
+        [[nodiscard]] const Node &node() const { return *node_; }
+        // starts the latency sample over, it starts out when the ticket is handed out
+        void restart();
+        // records the time since the ticket was handed out or restarted
+        void report(bool success);
+    };
+
+private:
+    struct Gateway {
+        boost::urls::url url;
+        std::shared_ptr<DnsCache> dns_cache;
+        boost::asio::ip::basic_resolver_results<boost::asio::ip::tcp> resolved;
+        std::vector<std::shared_ptr<Node>> nodes;
+    };
+
+    LoadBalancingOptions options_;
+    mutable std::mutex mutex_;
+    std::vector<Gateway> gateways_;
+    std::vector<std::shared_ptr<Node>> nodes_;
+    std::size_t next_ = 0;
+
+    void update_nodes(std::size_t gateway_idx,
+                      const boost::asio::ip::basic_resolver_results<boost::asio::ip::tcp> &resolved);
+    void report(Node &node, std::chrono::microseconds latency, bool success);
+
+public:
+    [[nodiscard]] LoadBalancer(const boost::urls::url &endpoint, LoadBalancingOptions options,
+                               DnsOptions dns_options);
+
+    // waits for DNS if necessary, then hands out the least loaded address that is not in tried, fails with
+    // host_unreachable once every address has been tried
+    [[nodiscard]] meta::crt<boost::asio::awaitable<std::expected<Ticket, boost::system::error_code>>>
+    select(std::vector<const Node *> tried = {});
+
+    [[nodiscard]] std::vector<EndpointStats> stats() const;
+    // the endpoint given to the constructor, the gateways come after it
+    [[nodiscard]] const boost::urls::url &endpoint() const { return gateways_.front().url; }
+};
+
+} // namespace s3cpp::aws::s3::_internal
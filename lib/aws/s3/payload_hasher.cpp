@@ -0,0 +1,112 @@
+#include "payload_hasher.hpp"
+
+#include "s3cpp/aws/iam/crypto.hpp"
+#include "s3cpp/meta.hpp"
+
+#include <algorithm>
+#include <boost/asio/as_tuple.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/bind_cancellation_slot.hpp>
+#include <boost/asio/cancellation_signal.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/this_coro.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/system/error_code.hpp>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace s3cpp::aws::s3::_internal {
+
+namespace {
+
+constexpr auto token = boost::asio::as_tuple(boost::asio::use_awaitable);
+
+// below this, waiting for company costs more than hashing alone
+constexpr std::size_t min_batch_size = 1024;
+
+} // namespace
+
+meta::crt<boost::asio::awaitable<iam::_internal::sha256_digest>>
+PayloadHasher::hash(std::span<const std::byte> body) {
+    const std::string_view data{meta::safe_reinterpret_cast<const char *>(body.data()), body.size()};
+    if (body.size() < min_batch_size || iam::_internal::sha256_batch_lanes() == 1) {
+        co_return iam::_internal::sha256(data);
+    }
+
+    // Once data is in pending_, this must not return before it is out of there again or the leader is done
+    // reading it, the caller may free it right after. An operation_aborted thrown by a co_await on a
+    // cancelled request would skip that.
+    const bool throws_if_cancelled = co_await boost::asio::this_coro::throw_if_cancelled();
+    co_await boost::asio::this_coro::throw_if_cancelled(false);
+    const auto digest = co_await hash_batched(data);
+    co_await boost::asio::this_coro::throw_if_cancelled(throws_if_cancelled);
+    co_return digest;
+}
+
+meta::crt<boost::asio::awaitable<iam::_internal::sha256_digest>>
+PayloadHasher::hash_batched(std::string_view data) {
+    const auto executor = co_await boost::asio::this_coro::executor;
+    auto pending = std::make_shared<Pending>(data, iam::_internal::sha256_digest{}, nullptr);
+    bool is_leader = false;
+    {
+        const std::scoped_lock lock{mutex_};
+        is_leader = !has_leader_;
+        has_leader_ = true;
+        if (!is_leader) {
+            pending->waiter = std::make_shared<Waiter>(executor, 1);
+        }
+        pending_.push_back(pending);
+    }
+
+    if (!is_leader) {
+        if (const auto [ec] = co_await pending->waiter->async_receive(token); !ec.failed()) {
+            co_return pending->digest;
+        }
+        // cancelled, by a timeout say
+        bool is_queued = false;
+        {
+            const std::scoped_lock lock{mutex_};
+            if (const auto it = std::ranges::find(pending_, pending); it != pending_.end()) {
+                pending_.erase(it);
+                is_queued = true;
+            }
+        }
+        if (is_queued) {
+            co_return iam::_internal::sha256(data);
+        }
+        // the leader took data into its batch already and sends once it is done with it
+        co_await pending->waiter->async_receive(
+            boost::asio::bind_cancellation_slot(boost::asio::cancellation_slot{}, token));
+        co_return pending->digest;
+    }
+
+    // lets the requests that are ready to run sign up
+    co_await boost::asio::post(executor, boost::asio::use_awaitable);
+    std::vector<std::shared_ptr<Pending>> batch;
+    {
+        const std::scoped_lock lock{mutex_};
+        batch = std::exchange(pending_, {});
+        has_leader_ = false;
+    }
+    std::vector<std::string_view> inputs;
+    inputs.reserve(batch.size());
+    for (const auto &entry : batch) {
+        inputs.push_back(entry->data);
+    }
+    std::vector<iam::_internal::sha256_digest> digests(batch.size());
+    iam::_internal::sha256_batch(inputs, digests);
+    for (std::size_t i = 0; i < batch.size(); i++) {
+        batch[i]->digest = digests[i];
+        if (batch[i]->waiter != nullptr) {
+            batch[i]->waiter->try_send(boost::system::error_code{});
+        }
+    }
+    co_return pending->digest;
+}
+
+} // namespace s3cpp::aws::s3::_internal
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "s3cpp/aws/iam/crypto.hpp"
+#include "s3cpp/meta.hpp"
+
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/experimental/concurrent_channel.hpp>
+#include <boost/system/error_code.hpp> // IWYU pragma: keep
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace s3cpp::aws::s3::_internal {
+
+// Hashes the bodies of requests that are signed at the same time in one iam::_internal::sha256_batch.
+// The first caller (the leader) yields once so that the others can join, then hashes every body that
+// arrived in the meantime, its own included, and hands the digests out. Many parts or small objects
+// uploaded at once are thus hashed side by side in the vector lanes instead of one after the other.
+class PayloadHasher {
+private:
+    using Waiter = boost::asio::experimental::concurrent_channel<void(boost::system::error_code)>;
+
+    struct Pending {
+        std::string_view data;
+        iam::_internal::sha256_digest digest;
+        std::shared_ptr<Waiter> waiter;
+    };
+
+    std::mutex mutex_;
+    std::vector<std::shared_ptr<Pending>> pending_;
+    bool has_leader_ = false;
+
+    [[nodiscard]] meta::crt<boost::asio::awaitable<iam::_internal::sha256_digest>>
+    hash_batched(std::string_view data);
+
+public:
+    [[nodiscard]] meta::crt<boost::asio::awaitable<iam::_internal::sha256_digest>>
+    hash(std::span<const std::byte> body);
+};
+
+} // namespace s3cpp::aws::s3::_internal
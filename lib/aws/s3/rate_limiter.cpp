@@ -0,0 +1,139 @@
+#include "rate_limiter.hpp"
+
+#include "s3cpp/aws/s3/session.hpp"
+#include "s3cpp/meta.hpp"
+#include "turn_queue.hpp"
+
+#include <algorithm>
+#include <array>
+#include <boost/asio/as_tuple.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/this_coro.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/beast/core/error.hpp>
+#include <boost/url/url.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+
+namespace s3cpp::aws::s3::_internal {
+
+namespace {
+
+constexpr auto token = boost::asio::as_tuple(boost::asio::use_awaitable);
+
+} // namespace
+
+void RateLimiter::Bucket::configure(std::optional<double> rate, std::chrono::milliseconds burst,
+                                    clock::time_point now) {
+    if (!rate.has_value() || rate.value() <= 0) {
+        rate_ = 0;
+        return;
+    }
+    // settle what accrued at the old rate before switching
+    std::ignore = take(0, now);
+    const bool was_limited = is_limited();
+    rate_ = rate.value();
+    capacity_ = std::max(rate_ * std::chrono::duration<double>(burst).count(), 1.0);
+    tokens_ = was_limited ? std::min(tokens_, capacity_) : capacity_;
+    last_refill_ = now;
+}
+
+std::chrono::nanoseconds RateLimiter::Bucket::take(double tokens, clock::time_point now) {
+    if (!is_limited()) {
+        return {};
+    }
+    const double elapsed = std::chrono::duration<double>(now - last_refill_).count();
+    tokens_ = std::min(capacity_, tokens_ + (elapsed * rate_)) - tokens;
+    last_refill_ = now;
+    if (tokens_ >= 0) {
+        return {};
+    }
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::duration<double>(-tokens_ / rate_));
+}
+
+RateLimiter::RateLimiter(std::shared_ptr<RateLimiter> parent,
+                         const std::array<double, priority_count> &priority_weights)
+    : parent_{std::move(parent)}, turns_{priority_weights} {}
+
+void RateLimiter::configure(const RateLimit &limit) {
+    const auto now = clock::now();
+    const std::scoped_lock lock{mutex_};
+    requests_.configure(limit.requests_per_second, limit.burst, now);
+    bytes_.configure(limit.bytes_per_second, limit.burst, now);
+}
+
+bool RateLimiter::is_limited() const {
+    {
+        const std::scoped_lock lock{mutex_};
+        if (requests_.is_limited() || bytes_.is_limited()) {
+            return true;
+        }
+    }
+    return parent_ != nullptr && parent_->is_limited();
+}
+
+std::chrono::nanoseconds RateLimiter::reserve(std::size_t requests, std::uint64_t bytes,
+                                              clock::time_point now) {
+    std::chrono::nanoseconds ret{};
+    {
+        const std::scoped_lock lock{mutex_};
+        ret = std::max(requests_.take(static_cast<double>(requests), now),
+                       bytes_.take(static_cast<double>(bytes), now));
+    }
+    if (parent_ != nullptr) {
+        ret = std::max(ret, parent_->reserve(requests, bytes, now));
+    }
+    return ret;
+}
+
+meta::crt<boost::asio::awaitable<boost::beast::error_code>>
+RateLimiter::acquire(std::size_t requests, std::uint64_t bytes, Priority priority) {
+    if (!is_limited()) {
+        co_return boost::beast::error_code{};
+    }
+    if (const auto turn_ec = co_await turns_.acquire(priority); turn_ec.failed()) {
+        co_return turn_ec;
+    }
+    const auto wait = reserve(requests, bytes, clock::now());
+    boost::beast::error_code ret;
+    if (wait > std::chrono::nanoseconds::zero()) {
+        boost::asio::steady_timer timer{co_await boost::asio::this_coro::executor, wait};
+        const auto [wait_ec] = co_await timer.async_wait(token);
+        ret = wait_ec;
+    }
+    turns_.release();
+    co_return ret;
+}
+
+std::shared_ptr<RateLimiter> RateLimiter::global() {
+    static const auto ret = std::make_shared<RateLimiter>(nullptr, ConnectionPoolOptions{}.priority_weights);
+    return ret;
+}
+
+std::shared_ptr<RateLimiter> RateLimiter::for_endpoint(const boost::urls::url &endpoint) {
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::weak_ptr<RateLimiter>> limiters;
+
+    const std::string key{endpoint.encoded_origin()};
+    const std::scoped_lock lock{mutex};
+    std::erase_if(limiters, [](const auto &entry) { return entry.second.expired(); });
+    auto &entry = limiters[key];
+    if (auto ret = entry.lock(); ret != nullptr) {
+        return ret;
+    }
+    auto ret = std::make_shared<RateLimiter>(global(), ConnectionPoolOptions{}.priority_weights);
+    entry = ret;
+    return ret;
+}
+
+} // namespace s3cpp::aws::s3::_internal
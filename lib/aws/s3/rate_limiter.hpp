@@ -0,0 +1,70 @@
+#pragma once
+
+#include "s3cpp/aws/s3/session.hpp"
+#include "s3cpp/meta.hpp"
+#include "turn_queue.hpp"
+
+#include <array>
+#include <boost/asio/awaitable.hpp>
+#include <boost/beast/core/error.hpp>
+#include <boost/url/url.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+namespace s3cpp::aws::s3::_internal {
+
+// One level of a hierarchy of token buckets: process wide, per endpoint and per Session.
+// Taking tokens takes them from the level and all of its parents, the caller waits for the slowest one.
+// Buckets may go into debt, so that transfers that can't be split are still paid for in full. Later
+// callers then queue up behind the debt, by priority.
+class RateLimiter {
+private:
+    using clock = std::chrono::steady_clock;
+
+    class Bucket {
+    private:
+        // tokens per second, 0 is unlimited
+        double rate_ = 0;
+        double capacity_ = 0;
+        double tokens_ = 0;
+        clock::time_point last_refill_;
+
+    public:
+        void configure(std::optional<double> rate, std::chrono::milliseconds burst, clock::time_point now);
+        [[nodiscard]] bool is_limited() const { return rate_ > 0; }
+        // returns how long until the bucket is out of debt again
+        [[nodiscard]] std::chrono::nanoseconds take(double tokens, clock::time_point now);
+    };
+
+    std::shared_ptr<RateLimiter> parent_;
+    mutable std::mutex mutex_;
+    Bucket requests_;
+    Bucket bytes_;
+    TurnQueue turns_;
+
+    [[nodiscard]] std::chrono::nanoseconds reserve(std::size_t requests, std::uint64_t bytes,
+                                                   clock::time_point now);
+
+public:
+    // priority_weights order the callers of acquire, parents are only reserved from
+    [[nodiscard]] RateLimiter(std::shared_ptr<RateLimiter> parent,
+                              const std::array<double, priority_count> &priority_weights);
+
+    // takes effect for everything that acquires afterwards, debt from before stays
+    void configure(const RateLimit &limit);
+    // whether this level or any parent has a limit
+    [[nodiscard]] bool is_limited() const;
+
+    [[nodiscard]] meta::crt<boost::asio::awaitable<boost::beast::error_code>>
+    acquire(std::size_t requests, std::uint64_t bytes, Priority priority);
+
+    [[nodiscard]] static std::shared_ptr<RateLimiter> global();
+    // shared by all Sessions with the same endpoint, lives as long as one of them
+    [[nodiscard]] static std::shared_ptr<RateLimiter> for_endpoint(const boost::urls::url &endpoint);
+};
+
+} // namespace s3cpp::aws::s3::_internal
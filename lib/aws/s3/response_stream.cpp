@@ -0,0 +1,248 @@
+#include "s3cpp/aws/s3/response_stream.hpp"
+
+#include "connection_pool.hpp"
+#include "exchange.hpp"
+#include "zero_copy.hpp"
+
+#include <algorithm>
+#include <boost/asio/as_tuple.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/beast/core/error.hpp>
+#include <boost/beast/core/stream_traits.hpp>
+#include <boost/beast/http/buffer_body.hpp>
+#include <boost/beast/http/error.hpp>
+#include <boost/beast/http/message.hpp> // IWYU pragma: keep
+#include <boost/beast/http/parser.hpp>
+#include <boost/beast/http/read.hpp>
+#include <boost/none.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <optional>
+#include <span>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace s3cpp::aws::s3 {
+
+namespace {
+
+constexpr auto token = boost::asio::as_tuple(boost::asio::use_awaitable);
+
+void finish(_internal::Exchange &exchange, bool keep_alive) {
+    exchange.done = true;
+    exchange.lease.release(keep_alive ? _internal::ConnectionPool::Release::KEEP_ALIVE
+                                      : _internal::ConnectionPool::Release::CLOSE);
+}
+
+void discard(_internal::Exchange &exchange) {
+    if (!exchange.done) {
+        exchange.done = true;
+        exchange.lease.release(_internal::ConnectionPool::Release::DISCARD);
+    }
+}
+
+} // namespace
+
+ResponseStream::ResponseStream(std::unique_ptr<_internal::Exchange> exchange)
+    : exchange_{std::move(exchange)} {
+    auto &header_parser = exchange_->header_parser;
+    if (header_parser.is_done()) {
+        finish(*exchange_, header_parser.keep_alive());
+    } else if (!header_parser.chunked() && header_parser.content_length().has_value()) {
+        exchange_->remaining = header_parser.content_length().value();
+    } else {
+        exchange_->body_parser =
+            std::make_unique<boost::beast::http::response_parser<boost::beast::http::buffer_body>>(
+                std::move(header_parser));
+        exchange_->body_parser->body_limit(boost::none);
+    }
+}
+
+ResponseStream::~ResponseStream() = default;
+ResponseStream::ResponseStream(ResponseStream &&) noexcept = default;
+ResponseStream &ResponseStream::operator=(ResponseStream &&) noexcept = default;
+
+const boost::beast::http::response_header<> &ResponseStream::header() const {
+    if (exchange_->body_parser != nullptr) {
+        return exchange_->body_parser->get().base();
+    }
+    return exchange_->header_parser.get().base();
+}
+
+std::optional<std::uint64_t> ResponseStream::content_length() const {
+    if (exchange_->body_parser != nullptr) {
+        return exchange_->body_parser->content_length();
+    }
+    return exchange_->header_parser.content_length();
+}
+
+bool ResponseStream::is_done() const { return exchange_->done; }
+
+ResponseStream::read_crt ResponseStream::read_some(std::span<std::byte> buffer) {
+    using rtype = read_crt::value_type;
+
+    _internal::Exchange &exchange = *exchange_;
+    if (exchange.done || buffer.empty()) {
+        co_return 0;
+    }
+    auto &stream = exchange.lease.stream();
+    // the timeout applies to each read, so that large bodies don't run into it
+    std::visit(
+        [](auto &stream_) {
+            boost::beast::get_lowest_layer(stream_).expires_after(std::chrono::seconds{300});
+        },
+        stream);
+
+    if (exchange.remaining.has_value()) {
+        std::uint64_t &remaining = exchange.remaining.value();
+        std::size_t read_n = 0;
+        if (exchange.buffer().size() > 0) {
+            // leftovers from reading the header
+            read_n = std::min({buffer.size(), exchange.buffer().size(), static_cast<std::size_t>(remaining)});
+            boost::asio::buffer_copy(boost::asio::buffer(buffer.data(), read_n), exchange.buffer().data());
+            exchange.buffer().consume(read_n);
+        } else {
+            // straight from the socket into the caller's buffer
+            const std::size_t want = std::min(buffer.size(), static_cast<std::size_t>(remaining));
+            const auto [ec, n] = co_await std::visit(
+                [&](auto &stream_) {
+                    return stream_.async_read_some(boost::asio::buffer(buffer.data(), want), token);
+                },
+                stream);
+            if (ec.failed()) {
+                exchange.done = true;
+                exchange.lease.release(_internal::ConnectionPool::Release::DISCARD);
+                co_return rtype{std::unexpect, ec};
+            }
+            read_n = n;
+        }
+        remaining -= read_n;
+        if (remaining == 0) {
+            finish(exchange, exchange.header_parser.keep_alive());
+        }
+        if (const auto wait_ec = co_await exchange.throttle(read_n); wait_ec.failed()) {
+            co_return rtype{std::unexpect, wait_ec};
+        }
+        co_return read_n;
+    }
+
+    auto &parser = *exchange.body_parser;
+    std::size_t read_n = 0;
+    // the parser may consume chunk headers without producing any body
+    while (read_n == 0 && !parser.is_done()) {
+        parser.get().body().data = buffer.data();
+        parser.get().body().size = buffer.size();
+        const auto [ec, n] = co_await std::visit(
+            [&](auto &stream_) {
+                return boost::beast::http::async_read_some(stream_, exchange.buffer(), parser, token);
+            },
+            stream);
+        if (ec.failed() && ec != boost::beast::http::error::need_buffer) {
+            exchange.done = true;
+            exchange.lease.release(_internal::ConnectionPool::Release::DISCARD);
+            co_return rtype{std::unexpect, ec};
+        }
+        read_n = buffer.size() - parser.get().body().size;
+    }
+    if (parser.is_done()) {
+        finish(exchange, parser.keep_alive());
+    }
+    if (const auto wait_ec = co_await exchange.throttle(read_n); wait_ec.failed()) {
+        co_return rtype{std::unexpect, wait_ec};
+    }
+    co_return read_n;
+}
+
+ResponseStream::read_crt ResponseStream::read(std::span<std::byte> buffer) {
+    std::size_t total = 0;
+    while (total < buffer.size()) {
+        const auto res = co_await read_some(buffer.subspan(total));
+        if (!res) {
+            co_return res;
+        }
+        if (res.value() == 0) {
+            break;
+        }
+        total += res.value();
+    }
+    co_return total;
+}
+
+ResponseStream::read_crt ResponseStream::write_to(int fd, std::uint64_t offset) {
+    using rtype = read_crt::value_type;
+
+    _internal::Exchange &exchange = *exchange_;
+    std::uint64_t total = 0;
+    if (!exchange.done && exchange.remaining.has_value()) {
+        std::uint64_t &remaining = exchange.remaining.value();
+        auto &stream = exchange.lease.stream();
+        if (exchange.buffer().size() > 0) {
+            // leftovers from reading the header
+            const auto data = exchange.buffer().cdata();
+            const auto n = static_cast<std::size_t>(std::min<std::uint64_t>(data.size(), remaining));
+            const std::span<const std::byte> leftovers{static_cast<const std::byte *>(data.data()), n};
+            if (const auto ec = _internal::pwrite_all(fd, leftovers, offset); ec.failed()) {
+                discard(exchange);
+                co_return rtype{std::unexpect, ec};
+            }
+            exchange.buffer().consume(n);
+            remaining -= n;
+            total += n;
+            if (const auto wait_ec = co_await exchange.throttle(n); wait_ec.failed()) {
+                discard(exchange);
+                co_return rtype{std::unexpect, wait_ec};
+            }
+        }
+        while (remaining > 0 && _internal::can_receive_file(stream)) {
+            const auto chunk =
+                static_cast<std::size_t>(std::min<std::uint64_t>(remaining, exchange.max_chunk()));
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{300};
+            const auto [ec, n] =
+                co_await _internal::async_receive_file(stream, fd, offset + total, chunk, deadline);
+            remaining -= n;
+            total += n;
+            if (const auto wait_ec = co_await exchange.throttle(n); wait_ec.failed()) {
+                discard(exchange);
+                co_return rtype{std::unexpect, wait_ec};
+            }
+            if (ec == boost::asio::error::operation_not_supported) {
+                break;
+            }
+            if (ec.failed()) {
+                discard(exchange);
+                co_return rtype{std::unexpect, ec};
+            }
+        }
+        if (remaining == 0) {
+            finish(exchange, exchange.header_parser.keep_alive());
+            co_return total;
+        }
+    }
+
+    // chunked bodies, TLS in user space, and whatever the kernel refused
+    std::vector<std::byte> buffer(65536);
+    while (true) {
+        const auto res = co_await read_some(buffer);
+        if (!res) {
+            co_return res;
+        }
+        if (res.value() == 0) {
+            break;
+        }
+        const auto data = std::span<const std::byte>{buffer}.first(res.value());
+        if (const auto ec = _internal::pwrite_all(fd, data, offset + total); ec.failed()) {
+            discard(exchange);
+            co_return rtype{std::unexpect, ec};
+        }
+        total += res.value();
+    }
+    co_return total;
+}
+
+} // namespace s3cpp::aws::s3
@@ -0,0 +1,207 @@
+#include "retry_policy.hpp"
+
+#include "s3cpp/aws/s3/session.hpp"
+#include "s3cpp/meta.hpp"
+#include "turn_queue.hpp"
+
+#include <algorithm>
+#include <array>
+#include <boost/asio/as_tuple.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/this_coro.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/beast/core/error.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <string_view>
+
+namespace s3cpp::aws::s3::_internal {
+
+namespace {
+
+constexpr auto token = boost::asio::as_tuple(boost::asio::use_awaitable);
+
+// multiplicative decrease on throttling, and the scaling constant of the cubic recovery
+constexpr double beta = 0.7;
+constexpr double scale_c = 0.4;
+constexpr double min_fill_rate = 0.5;
+constexpr std::chrono::milliseconds measure_interval{500};
+
+constexpr std::array throttling_codes{
+    std::string_view{"SlowDown"},
+    std::string_view{"Throttling"},
+    std::string_view{"ThrottlingException"},
+    std::string_view{"ThrottledException"},
+    std::string_view{"RequestThrottled"},
+    std::string_view{"RequestThrottledException"},
+    std::string_view{"RequestLimitExceeded"},
+    std::string_view{"TooManyRequestsException"},
+    std::string_view{"BandwidthLimitExceeded"},
+    std::string_view{"ProvisionedThroughputExceededException"},
+};
+
+constexpr std::array transient_codes{
+    std::string_view{"InternalError"},
+    std::string_view{"ServiceUnavailable"},
+    std::string_view{"RequestTimeout"},
+    std::string_view{"RequestTimeoutException"},
+    std::string_view{"IDPCommunicationError"},
+};
+
+[[nodiscard]] std::mt19937_64 &rng() {
+    thread_local std::mt19937_64 engine{std::random_device{}()};
+    return engine;
+}
+
+} // namespace
+
+void AdaptiveRateLimiter::refill(clock::time_point now) {
+    const double elapsed = std::chrono::duration<double>(now - last_refill_).count();
+    tokens_ = std::min(capacity_, tokens_ + (elapsed * fill_rate_));
+    last_refill_ = now;
+}
+
+std::chrono::nanoseconds AdaptiveRateLimiter::reserve() {
+    if (!enabled_) {
+        return {};
+    }
+    refill(clock::now());
+    tokens_ -= 1;
+    if (tokens_ >= 0) {
+        return {};
+    }
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::duration<double>(-tokens_ / fill_rate_));
+}
+
+void AdaptiveRateLimiter::update(bool throttled) {
+    const auto now = clock::now();
+
+    measured_count_++;
+    if (measured_since_ == clock::time_point{}) {
+        measured_since_ = now;
+    } else if (const auto elapsed = now - measured_since_; elapsed >= measure_interval) {
+        const double current =
+            static_cast<double>(measured_count_) / std::chrono::duration<double>(elapsed).count();
+        measured_rate_ = (0.8 * current) + (0.2 * measured_rate_);
+        measured_count_ = 0;
+        measured_since_ = now;
+    }
+
+    double new_rate = 0;
+    if (throttled) {
+        const double rate_to_use = enabled_ ? std::min(measured_rate_, fill_rate_) : measured_rate_;
+        last_max_rate_ = rate_to_use;
+        last_throttle_ = now;
+        new_rate = rate_to_use * beta;
+        if (!enabled_) {
+            enabled_ = true;
+            last_refill_ = now;
+        }
+    } else {
+        if (!enabled_) {
+            return;
+        }
+        const double since_throttle = std::chrono::duration<double>(now - last_throttle_).count();
+        const double inflection = std::cbrt(last_max_rate_ * (1 - beta) / scale_c);
+        new_rate = (scale_c * std::pow(since_throttle - inflection, 3)) + last_max_rate_;
+    }
+    // never run away from what we actually manage to send
+    new_rate = std::max(std::min(new_rate, 2 * measured_rate_), min_fill_rate);
+
+    refill(now);
+    fill_rate_ = new_rate;
+    capacity_ = std::max(new_rate, 1.0);
+    tokens_ = std::min(tokens_, capacity_);
+}
+
+RetryPolicy::RetryPolicy(RetryOptions options, const std::array<double, priority_count> &priority_weights)
+    : options_{options}, budget_{options.retry_budget}, turns_{priority_weights} {}
+
+RetryPolicy::Outcome RetryPolicy::classify(unsigned int status, std::string_view s3_error_code) {
+    if (status < 400) {
+        return Outcome::SUCCESS;
+    }
+    // S3 reports SlowDown as a 503 without a body on HEAD requests
+    if (status == 429 || status == 503 || std::ranges::contains(throttling_codes, s3_error_code)) {
+        return Outcome::THROTTLED;
+    }
+    if (status == 500 || status == 502 || status == 504 ||
+        std::ranges::contains(transient_codes, s3_error_code)) {
+        return Outcome::RETRYABLE;
+    }
+    return Outcome::NOT_RETRYABLE;
+}
+
+RetryPolicy::Outcome RetryPolicy::classify(const boost::beast::error_code &error, bool is_idempotent) {
+    if (error == boost::asio::error::operation_aborted) {
+        return Outcome::NOT_RETRYABLE;
+    }
+    // we can't tell whether the server acted on a request whose response got lost
+    return is_idempotent ? Outcome::RETRYABLE : Outcome::NOT_RETRYABLE;
+}
+
+meta::crt<boost::asio::awaitable<boost::beast::error_code>> RetryPolicy::acquire(Priority priority) {
+    if (!options_.adaptive_rate_limit) {
+        co_return boost::beast::error_code{};
+    }
+    if (const auto turn_ec = co_await turns_.acquire(priority); turn_ec.failed()) {
+        co_return turn_ec;
+    }
+    std::chrono::nanoseconds wait;
+    {
+        const std::scoped_lock lock{mutex_};
+        wait = rate_limiter_.reserve();
+    }
+    boost::beast::error_code ret;
+    if (wait > std::chrono::nanoseconds::zero()) {
+        boost::asio::steady_timer timer{co_await boost::asio::this_coro::executor, wait};
+        const auto [wait_ec] = co_await timer.async_wait(token);
+        ret = wait_ec;
+    }
+    turns_.release();
+    co_return ret;
+}
+
+void RetryPolicy::record(Outcome outcome, std::size_t attempt) {
+    const std::scoped_lock lock{mutex_};
+    if (options_.adaptive_rate_limit) {
+        rate_limiter_.update(outcome == Outcome::THROTTLED);
+    }
+    if (outcome == Outcome::SUCCESS) {
+        // a successful retry pays back what it took, first attempts slowly refill the budget
+        budget_ = std::min(options_.retry_budget, budget_ + (attempt > 1 ? options_.retry_cost : 1));
+    }
+}
+
+bool RetryPolicy::should_retry(Outcome outcome, std::size_t attempt) {
+    if (outcome == Outcome::SUCCESS || outcome == Outcome::NOT_RETRYABLE ||
+        attempt >= options_.max_attempts) {
+        return false;
+    }
+    const std::scoped_lock lock{mutex_};
+    if (budget_ < options_.retry_cost) {
+        return false;
+    }
+    budget_ -= options_.retry_cost;
+    return true;
+}
+
+meta::crt<boost::asio::awaitable<boost::beast::error_code>>
+RetryPolicy::backoff(std::size_t attempt) const {
+    const auto exponential = options_.base_backoff * (std::int64_t{1} << std::min(attempt, std::size_t{20}));
+    const auto ceiling = std::min<std::chrono::milliseconds>(options_.max_backoff, exponential);
+    std::uniform_int_distribution<std::chrono::milliseconds::rep> dist{0, ceiling.count()};
+    boost::asio::steady_timer timer{co_await boost::asio::this_coro::executor,
+                                    std::chrono::milliseconds{dist(rng())}};
+    const auto [wait_ec] = co_await timer.async_wait(token);
+    co_return wait_ec;
+}
+
+} // namespace s3cpp::aws::s3::_internal
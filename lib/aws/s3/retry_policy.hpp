@@ -0,0 +1,77 @@
+#pragma once
+
+#include "s3cpp/aws/s3/session.hpp"
+#include "s3cpp/meta.hpp"
+#include "turn_queue.hpp"
+
+#include <array>
+#include <boost/asio/awaitable.hpp>
+#include <boost/beast/core/error.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+
+namespace s3cpp::aws::s3::_internal {
+
+// Client side rate limiter that only kicks in once the server starts throttling.
+// The allowed rate drops multiplicatively on every throttling response and recovers along a cubic
+// curve, like TCP CUBIC and the adaptive retry mode of the AWS SDKs.
+class AdaptiveRateLimiter {
+private:
+    using clock = std::chrono::steady_clock;
+
+    bool enabled_ = false;
+    // token bucket, tokens_ may go negative to queue up senders
+    double fill_rate_ = 0;
+    double capacity_ = 0;
+    double tokens_ = 0;
+    clock::time_point last_refill_;
+
+    double last_max_rate_ = 0;
+    clock::time_point last_throttle_;
+
+    // sending rate, measured in half second buckets
+    double measured_rate_ = 0;
+    std::size_t measured_count_ = 0;
+    clock::time_point measured_since_;
+
+    void refill(clock::time_point now);
+
+public:
+    // takes a token, returns how long the caller has to wait before sending
+    [[nodiscard]] std::chrono::nanoseconds reserve();
+    void update(bool throttled);
+};
+
+class RetryPolicy {
+public:
+    enum class Outcome : std::uint8_t { SUCCESS, RETRYABLE, THROTTLED, NOT_RETRYABLE };
+
+private:
+    RetryOptions options_;
+    std::mutex mutex_;
+    std::size_t budget_;
+    AdaptiveRateLimiter rate_limiter_;
+    TurnQueue turns_;
+
+public:
+    [[nodiscard]] RetryPolicy(RetryOptions options,
+                              const std::array<double, priority_count> &priority_weights);
+
+    [[nodiscard]] static Outcome classify(unsigned int status, std::string_view s3_error_code);
+    [[nodiscard]] static Outcome classify(const boost::beast::error_code &error, bool is_idempotent);
+
+    // waits for the rate limiter, if it is active, behind the waiting attempts of higher priority
+    [[nodiscard]] meta::crt<boost::asio::awaitable<boost::beast::error_code>> acquire(Priority priority);
+    // feeds the outcome of an attempt back into the budget and rate limiter
+    void record(Outcome outcome, std::size_t attempt);
+    // whether to retry after the given attempt, takes the cost of the retry from the budget
+    [[nodiscard]] bool should_retry(Outcome outcome, std::size_t attempt);
+    // sleeps before the next attempt, with capped exponential backoff and full jitter
+    [[nodiscard]] meta::crt<boost::asio::awaitable<boost::beast::error_code>>
+    backoff(std::size_t attempt) const;
+};
+
+} // namespace s3cpp::aws::s3::_internal
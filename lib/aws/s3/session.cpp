@@ -1,31 +1,69 @@
 #include "s3cpp/aws/s3/session.hpp"
 
-#include "dns_cache.hpp"
+#include "aws_chunked.hpp"
+#include "bucket_router.hpp"
+#include "connection_pool.hpp"
+#include "exchange.hpp"
+#include "latency_tracker.hpp"
+#include "load_balancer.hpp"
+#include "payload_hasher.hpp"
+#include "rate_limiter.hpp"
+#include "retry_policy.hpp"
+#include "s3cpp/aws/iam/canonicalize.hpp"
+#include "s3cpp/aws/iam/crypto.hpp"
 #include "s3cpp/aws/iam/session.hpp"
 #include "s3cpp/aws/iam/urlencode.hpp"
+#include "s3cpp/aws/s3/response_stream.hpp"
+#include "s3cpp/meta.hpp"
 #include "session_extra.hpp"
+#include "signing_key_cache.hpp"
+#include "single_flight.hpp"
+#include "tls_session_cache.hpp"
+#include "transport_context.hpp"
 
+#include <array>
 #include <boost/asio/any_io_executor.hpp>
 #include <boost/asio/as_tuple.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/cancellation_type.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/deferred.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/experimental/awaitable_operators.hpp>
+#include <boost/asio/experimental/parallel_group.hpp>
+#include <boost/asio/ssl/error.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/asio/this_coro.hpp>
 #include <boost/asio/use_awaitable.hpp>
-#include <boost/beast/core/flat_buffer.hpp>
+#include <boost/beast/core/error.hpp>
+#include <boost/beast/core/stream_traits.hpp>
+#include <boost/beast/http/error.hpp>
+#include <boost/beast/http/field.hpp>
 #include <boost/beast/http/fields.hpp>  // IWYU pragma: keep
 #include <boost/beast/http/message.hpp> // IWYU pragma: keep
+#include <boost/beast/http/parser.hpp>
 #include <boost/beast/http/read.hpp>
+#include <boost/beast/http/serializer.hpp>
 #include <boost/beast/http/span_body.hpp>
 #include <boost/beast/http/string_body.hpp> // IWYU pragma: keep
 #include <boost/beast/http/verb.hpp>
 #include <boost/beast/http/write.hpp>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <expected>
+#include <exception>
 #include <format>
 #include <memory>
+#include <memory_resource>
+#include <optional>
 #include <span>
+#include <sstream>
 #include <string>
 #include <string_view>
 #include <utility>
 #include <variant>
+#include <vector>
 
 namespace s3cpp::aws::s3 {
 
@@ -33,84 +71,683 @@ namespace {
 
 constexpr auto token = boost::asio::as_tuple(boost::asio::use_awaitable);
 
+// a pooled connection may have been closed by the server right as we picked it up
+[[nodiscard]] bool is_stale_connection_error(const boost::beast::error_code &error) {
+    return error == boost::beast::http::error::end_of_stream || error == boost::asio::error::eof ||
+           error == boost::asio::error::connection_reset || error == boost::asio::error::broken_pipe ||
+           error == boost::asio::ssl::error::stream_truncated;
 }
 
-Session::crt Session::method_impl(boost::beast::http::verb method, std::string_view path,
-                                  bool is_path_encoded, std::string_view query,
-                                  boost::beast::http::fields headers, std::span<const std::byte> body) const {
-    using rtype = Session::crt::value_type;
+// the address can't be reached, another one of the same endpoint may well be
+[[nodiscard]] bool is_connect_failure(const boost::beast::error_code &error) {
+    return error == boost::asio::error::connection_refused || error == boost::asio::error::host_unreachable ||
+           error == boost::asio::error::network_unreachable || error == boost::asio::error::timed_out ||
+           error == boost::asio::error::address_family_not_supported ||
+           error == boost::beast::error::timeout || is_stale_connection_error(error);
+}
+
+// the <Code> of an S3 error response, if any
+[[nodiscard]] std::string_view
+s3_error_code(const boost::beast::http::response<boost::beast::http::string_body> &response) {
+    if (response.result_int() < 400) {
+        return {};
+    }
+    const std::string_view body = response.body();
+    const std::size_t begin = body.find("<Code>");
+    if (begin == std::string_view::npos) {
+        return {};
+    }
+    const std::size_t end = body.find("</Code>", begin);
+    if (end == std::string_view::npos) {
+        return {};
+    }
+    return body.substr(begin + 6, end - begin - 6);
+}
+
+// an attempt worth keeping, anything else waits for the other copy of a hedged request
+template <typename Result> [[nodiscard]] bool is_successful_attempt(const Result &res) {
+    return res && res->result_int() < 500;
+}
+
+// the cancellation condition of a hedged request, once one copy succeeds the other one gets cancelled
+struct FirstSuccess {
+    template <typename Result>
+    [[nodiscard]] boost::asio::cancellation_type_t operator()(const std::exception_ptr &exception,
+                                                              const Result &res) const {
+        return exception == nullptr && is_successful_attempt(res) ? boost::asio::cancellation_type::all
+                                                                  : boost::asio::cancellation_type::none;
+    }
+};
+
+// races the operation against the timeout, the loser gets cancelled
+template <typename T>
+[[nodiscard]] meta::crt<boost::asio::awaitable<std::expected<T, boost::beast::error_code>>>
+with_timeout(boost::asio::awaitable<std::expected<T, boost::beast::error_code>> operation,
+             std::optional<std::chrono::milliseconds> timeout) {
+    using namespace boost::asio::experimental::awaitable_operators;
+    using rtype = std::expected<T, boost::beast::error_code>;
+
+    if (!timeout.has_value()) {
+        co_return co_await std::move(operation);
+    }
+    boost::asio::steady_timer timer{co_await boost::asio::this_coro::executor, timeout.value()};
+    auto res = co_await (std::move(operation) || timer.async_wait(token));
+    if (res.index() == 0) {
+        co_return std::get<0>(std::move(res));
+    }
+    // the timer also completes first when the whole request gets cancelled
+    if (const auto [wait_ec] = std::get<1>(res); wait_ec.failed()) {
+        co_return rtype{std::unexpect, wait_ec};
+    }
+    co_return rtype{std::unexpect, boost::beast::error::timeout};
+}
+
+// everything that can change the response
+// every field is prefixed with its length, raw paths may contain any separator
+[[nodiscard]] std::string coalescing_key(boost::beast::http::verb method, std::string_view path,
+                                         bool is_path_encoded, std::string_view query,
+                                         const boost::beast::http::fields &headers) {
+    std::string ret = std::format("{} {} {}:{}{}:{}", boost::beast::http::to_string(method),
+                                  is_path_encoded ? 'e' : 'r', path.size(), path, query.size(), query);
+    for (const auto &field : headers) {
+        const std::string_view name = field.name_string();
+        const std::string_view value = field.value();
+        ret += std::format("{}:{}{}:{}", name.size(), name, value.size(), value);
+    }
+    return ret;
+}
+
+// open_impl sends the body according to x-amz-content-sha256, a value set by the caller wins
+void set_payload_signing(boost::beast::http::fields &headers, PayloadSigning signing) {
+    if (headers.find("x-amz-content-sha256") != headers.end()) {
+        return;
+    }
+    switch (signing) {
+    case PayloadSigning::SIGNED:
+        break;
+    case PayloadSigning::UNSIGNED:
+        headers.set("x-amz-content-sha256", _internal::unsigned_payload);
+        break;
+    case PayloadSigning::UNSIGNED_TRAILER:
+        headers.set("x-amz-content-sha256", _internal::streaming_unsigned_payload_trailer);
+        break;
+    case PayloadSigning::SIGNED_STREAMING:
+        headers.set("x-amz-content-sha256", _internal::streaming_signed_payload);
+        break;
+    }
+}
 
-    std::string_view encoded_path = path;
-    std::string encoded_path_buf;
-    if (!is_path_encoded && iam::urlencode_path_required(path)) {
-        encoded_path_buf = iam::urlencode_path(path);
-        encoded_path = encoded_path_buf;
+} // namespace
+
+Session::exchange_crt Session::open_impl(boost::beast::http::verb method, std::string_view path,
+                                         bool is_path_encoded, std::string_view query,
+                                         boost::beast::http::fields headers,
+                                         std::span<const std::byte> body,
+                                         std::optional<FileRange> file, Priority priority,
+                                         std::optional<UploadStream> upload_stream) const {
+    using rtype = std::expected<std::unique_ptr<_internal::Exchange>, boost::beast::error_code>;
+
+    const bool is_upload = file.has_value() && method == boost::beast::http::verb::put;
+    if (is_upload && headers["x-amz-content-sha256"].empty()) {
+        // signing the payload would mean reading the whole file before sending the first byte
+        headers.set("x-amz-content-sha256", _internal::unsigned_payload);
     }
-    std::string_view encoded_target;
-    std::string encoded_target_buf;
-    if (query.empty()) {
-        encoded_target = encoded_path;
+    // the body goes out aws-chunked, followed by its checksum or with every chunk signed
+    const std::string_view content_sha256{headers["x-amz-content-sha256"]};
+    const bool is_trailer = content_sha256 == _internal::streaming_unsigned_payload_trailer;
+    const bool is_signed_stream = content_sha256 == _internal::streaming_signed_payload;
+    // these bodies are written by the Exchange rather than by beast
+    const bool is_chunked = is_trailer || is_signed_stream || upload_stream.has_value();
+    const std::uint64_t payload_size = upload_stream.has_value() ? upload_stream->size
+                                       : is_upload                ? file->size
+                                                                  : body.size();
+    if (is_trailer || is_signed_stream) {
+        const std::string_view content_encoding{headers[boost::beast::http::field::content_encoding]};
+        headers.set(boost::beast::http::field::content_encoding,
+                    content_encoding.empty() ? std::string{"aws-chunked"}
+                                             : std::format("aws-chunked,{}", content_encoding));
+        headers.set("x-amz-decoded-content-length", std::to_string(payload_size));
+        if (is_trailer) {
+            headers.set("x-amz-trailer", _internal::checksum_trailer_name);
+        }
+    }
+
+    // hashed together with the bodies of the other requests signed right now
+    if (!is_chunked && !body.empty() && headers["x-amz-content-sha256"].empty()) {
+        const iam::_internal::sha256_hex payload_hash =
+            iam::_internal::hex_encode(co_await payload_hasher_->hash(body));
+        headers.set("x-amz-content-sha256", iam::_internal::to_string_view(payload_hash));
+    }
+
+    // virtual-hosted requests drop the bucket from the path
+    const auto route = transport_->bucket_router->route(path);
+    // the signed request and everything that goes into signing it
+    _internal::RequestArena arena;
+    std::pmr::string encoded_target{arena.resource()};
+    if (!is_path_encoded && iam::urlencode_path_required(route.path)) {
+        encoded_target.resize_and_overwrite(3 * route.path.size(), [&route](char *out, std::size_t /*size*/) {
+            return static_cast<std::size_t>(iam::urlencode_path_to(route.path, out) - out);
+        });
     } else {
-        encoded_target_buf = std::format("{}?{}", encoded_path, query);
-        encoded_target = encoded_target_buf;
+        encoded_target = route.path;
+    }
+    if (!query.empty()) {
+        encoded_target.append("?");
+        encoded_target.append(query);
     }
+    auto request = _internal::make_request(method, encoded_target, body, headers, arena.resource());
 
-    boost::beast::http::request<boost::beast::http::span_body<const std::byte>> request{
-        method, encoded_target, 11, body, std::move(headers)};
-    request = _internal::prepare_request(std::move(request), *this);
+    // file and chunked bodies are paid for while they are sent
+    if (const auto wait_ec = co_await rate_limiter_->acquire(1, is_chunked ? 0 : body.size(), priority);
+        wait_ec.failed()) {
+        co_return rtype{std::unexpect, wait_ec};
+    }
 
-    const bool is_ssl = endpoint.scheme() != "http";
-    // TODO: gracefully close ssl stream in all cases
     const boost::asio::any_io_executor executor = co_await boost::asio::this_coro::executor;
-    auto prep_res = co_await _internal::prepare_stream(_internal::get_ssl_stream(is_ssl, executor, ssl_ctx),
-                                                       endpoint, dns_cache_);
-    if (!prep_res) {
-        co_return rtype{std::unexpect, prep_res.error()};
+    // addresses that couldn't be connected to, the next one gets tried before giving up
+    std::vector<const _internal::LoadBalancer::Node *> unreachable;
+    boost::beast::error_code connect_ec;
+    while (true) {
+        auto ticket = co_await route.load_balancer->select(unreachable);
+        if (!ticket) {
+            co_return rtype{std::unexpect, connect_ec.failed() ? connect_ec : ticket.error()};
+        }
+        const _internal::LoadBalancer::Node &node = ticket->node();
+        // the Host header, and thus the signature, depends on the gateway
+        const auto signature =
+            _internal::prepare_request(request, *signing_keys_, node.gateway, route.region, arena.resource());
+        _internal::ChunkEncoder encoder;
+        if (is_trailer) {
+            encoder = _internal::ChunkEncoder{_internal::ChecksumTrailer{}};
+        } else if (is_signed_stream) {
+            encoder = _internal::ChunkEncoder{
+                _internal::ChunkSigner{signature.scope, signature.timestamp, signature.signature}};
+        }
+        if (is_chunked) {
+            request.content_length(encoder.length(payload_size));
+        } else if (is_upload) {
+            request.content_length(file->size);
+        }
+        const bool is_ssl = node.gateway.scheme() != "http";
+
+        auto acquired = co_await transport_->connection_pool->acquire(node.pool_key, priority);
+        if (!acquired) {
+            co_return rtype{std::unexpect, acquired.error()};
+        }
+        auto exchange =
+            std::make_unique<_internal::Exchange>(std::move(ticket.value()), std::move(acquired.value()));
+        exchange->rate_limiter = rate_limiter_;
+        exchange->priority = priority;
+        auto &lease = exchange->lease;
+        bool request_sent = false;
+        if (!lease.has_connection()) {
+            // replaying a GET has no side effects, so it may go out as 0-RTT data on a resumed session
+            std::string early_data;
+            if (is_ssl && options_.tls.early_data && !options_.tls.kernel_tls &&
+                method == boost::beast::http::verb::get) {
+                std::ostringstream serialized;
+                serialized << request;
+                early_data = std::move(serialized).str();
+            }
+            const auto prepare = [&]() {
+                return _internal::prepare_stream(
+                    _internal::get_ssl_stream(is_ssl, options_.tls.kernel_tls, executor, transport_->ssl_ctx),
+                    node.gateway, node.address, options_.transport, transport_->tls_sessions, early_data);
+            };
+            auto prep_res = co_await prepare();
+            if (!prep_res && !early_data.empty() && prep_res.error() == _internal::early_data_failed) {
+                // the half-written handshake can't be finished, start over on a new connection without 0-RTT
+                early_data.clear();
+                prep_res = co_await prepare();
+            }
+            if (!prep_res) {
+                exchange->ticket.report(false);
+                if (is_connect_failure(prep_res.error())) {
+                    unreachable.push_back(&node);
+                    connect_ec = prep_res.error();
+                    continue;
+                }
+                co_return rtype{std::unexpect, prep_res.error()};
+            }
+            lease.emplace(std::move(prep_res.value()));
+            request_sent = !early_data.empty() && _internal::early_data_accepted(lease.stream());
+        }
+        auto &stream = lease.stream();
+        std::visit(
+            [](auto &stream_) {
+                boost::beast::get_lowest_layer(stream_).expires_after(std::chrono::seconds{300});
+            },
+            stream);
+
+        if (!request_sent) {
+            boost::beast::http::request_serializer<boost::beast::http::span_body<const std::byte>,
+                                                   iam::_internal::pmr_fields>
+                serializer{request};
+            // the body of an upload, and any chunked body, doesn't go through beast
+            const bool header_only = is_upload || is_chunked;
+            const auto [send_ec, send_n] = co_await std::visit(
+                [&serializer, header_only](auto &stream_) {
+                    return header_only ? boost::beast::http::async_write_header(stream_, serializer, token)
+                                       : boost::beast::http::async_write(stream_, serializer, token);
+                },
+                stream);
+            if (send_ec.failed()) {
+                if (lease.is_reused() && is_stale_connection_error(send_ec)) {
+                    continue;
+                }
+                exchange->ticket.report(false);
+                co_return rtype{std::unexpect, send_ec};
+            }
+            if (is_chunked) {
+                const _internal::UploadBody upload{
+                    .data = body,
+                    .file = is_upload ? file : std::nullopt,
+                    .stream = upload_stream.has_value() ? &upload_stream.value() : nullptr,
+                };
+                const auto chunked_ec = co_await exchange->send_chunked(upload, std::move(encoder));
+                if (chunked_ec.failed()) {
+                    exchange->ticket.report(false);
+                    co_return rtype{std::unexpect, chunked_ec};
+                }
+            } else if (is_upload) {
+                if (const auto file_ec = co_await exchange->send_file(file.value()); file_ec.failed()) {
+                    exchange->ticket.report(false);
+                    co_return rtype{std::unexpect, file_ec};
+                }
+            }
+        }
+
+        // the latency of the address is the time to first byte, waiting for a connection, connecting and
+        // sending the body would make a busy or uploading client look like a slow address
+        exchange->ticket.restart();
+        const auto [recv_ec, recv_n] = co_await std::visit(
+            [&exchange](auto &stream_) {
+                // NOLINTNEXTLINE(clang-analyzer-core.NullDereference)
+                return boost::beast::http::async_read_header(stream_, exchange->buffer(),
+                                                             exchange->header_parser, token);
+            },
+            stream);
+        if (recv_ec.failed()) {
+            // a stream that has been sent once can't be sent again
+            if (lease.is_reused() && recv_n == 0 && !upload_stream.has_value() &&
+                is_stale_connection_error(recv_ec)) {
+                continue;
+            }
+            exchange->ticket.report(false);
+            co_return rtype{std::unexpect, recv_ec};
+        }
+
+        // time to first byte, 5xx responses count as errors of the address
+        exchange->ticket.report(exchange->header_parser.get().result_int() < 500);
+        co_return rtype{std::move(exchange)};
     }
-    auto stream = std::move(prep_res.value());
+}
 
-    boost::beast::flat_buffer buf;
-    boost::beast::http::response<boost::beast::http::string_body> response;
+Session::crt Session::request_impl(boost::beast::http::verb method, std::string_view path,
+                                   bool is_path_encoded, std::string_view query,
+                                   boost::beast::http::fields headers, std::span<const std::byte> body,
+                                   std::optional<FileRange> file, Priority priority,
+                                   std::optional<UploadStream> upload_stream) const {
+    using rtype = Session::crt::value_type;
+
+    auto maybe_exchange = co_await open_impl(method, path, is_path_encoded, query, std::move(headers), body,
+                                             file, priority, std::move(upload_stream));
+    if (!maybe_exchange) {
+        co_return rtype{std::unexpect, maybe_exchange.error()};
+    }
+    _internal::Exchange &exchange = *maybe_exchange.value();
 
-    const auto [send_ec, send_n] = co_await std::visit(
-        [&request](auto &stream_) { return boost::beast::http::async_write(stream_, request, token); },
-        stream);
-    if (send_ec.failed()) {
-        co_return rtype{std::unexpect, send_ec};
+    if (file.has_value() && method == boost::beast::http::verb::get &&
+        exchange.header_parser.get().result_int() < 300) {
+        boost::beast::http::response_header<> header = exchange.header_parser.get().base();
+        ResponseStream response_body{std::move(maybe_exchange.value())};
+        if (const auto written = co_await response_body.write_to(file->fd, file->offset); !written) {
+            co_return rtype{std::unexpect, written.error()};
+        }
+        co_return rtype{std::in_place, std::move(header)};
     }
 
+    boost::beast::http::response_parser<boost::beast::http::string_body> parser{
+        std::move(exchange.header_parser)};
     const auto [recv_ec, recv_n] = co_await std::visit(
-        [&buf, &response](auto &stream_) {
-            // NOLINTNEXTLINE(clang-analyzer-core.NullDereference)
-            return boost::beast::http::async_read(stream_, buf, response, token);
+        [&exchange, &parser](auto &stream_) {
+            return boost::beast::http::async_read(stream_, exchange.buffer(), parser, token);
         },
-        stream);
+        exchange.lease.stream());
     if (recv_ec.failed()) {
         co_return rtype{std::unexpect, recv_ec};
     }
 
-    co_return response;
+    exchange.lease.release(parser.keep_alive() ? _internal::ConnectionPool::Release::KEEP_ALIVE
+                                               : _internal::ConnectionPool::Release::CLOSE);
+    if (const auto wait_ec = co_await exchange.throttle(parser.get().body().size()); wait_ec.failed()) {
+        co_return rtype{std::unexpect, wait_ec};
+    }
+    co_return parser.release();
+}
+
+Session::crt Session::hedge_impl(std::chrono::microseconds delay, boost::beast::http::verb method,
+                                 std::string_view path, bool is_path_encoded, std::string_view query,
+                                 boost::beast::http::fields headers, Priority priority) const {
+    using rtype = Session::crt::value_type;
+
+    boost::asio::steady_timer timer{co_await boost::asio::this_coro::executor, delay};
+    const auto [wait_ec] = co_await timer.async_wait(token);
+    if (wait_ec.failed()) {
+        co_return rtype{std::unexpect, wait_ec};
+    }
+    co_return co_await request_impl(method, path, is_path_encoded, query, std::move(headers), {}, {},
+                                    priority);
+}
+
+Session::crt Session::attempt_impl(boost::beast::http::verb method, std::string_view path,
+                                   bool is_path_encoded, std::string_view query,
+                                   boost::beast::http::fields headers, std::span<const std::byte> body,
+                                   std::optional<FileRange> file, Priority priority) const {
+    using rtype = Session::crt::value_type;
+
+    // two copies writing into the same file would trample on each other
+    const bool is_hedgeable =
+        options_.hedging.enabled && !file.has_value() &&
+        (method == boost::beast::http::verb::get || method == boost::beast::http::verb::head);
+    if (!is_hedgeable) {
+        co_return co_await request_impl(method, path, is_path_encoded, query, std::move(headers), body, file,
+                                        priority);
+    }
+
+    const std::optional<std::chrono::microseconds> delay =
+        options_.hedging.delay.has_value()
+            ? options_.hedging.delay.value()
+            : latencies_->percentile(options_.hedging.percentile, options_.hedging.min_samples);
+    const auto start = std::chrono::steady_clock::now();
+    rtype res;
+    if (delay.has_value()) {
+        // The first copy to succeed wins and the other one gets cancelled. A copy that fails, say on a
+        // connection that went stale, waits for the other one instead of cancelling it.
+        const boost::asio::any_io_executor executor = co_await boost::asio::this_coro::executor;
+        auto [order, primary_exception, primary, hedge_exception, hedge] =
+            co_await boost::asio::experimental::make_parallel_group(
+                boost::asio::co_spawn(
+                    executor, request_impl(method, path, is_path_encoded, query, headers, {}, {}, priority),
+                    boost::asio::deferred),
+                boost::asio::co_spawn(executor,
+                                      hedge_impl(delay.value(), method, path, is_path_encoded, query, headers,
+                                                 priority),
+                                      boost::asio::deferred))
+                .async_wait(FirstSuccess{}, boost::asio::use_awaitable);
+        for (const auto &exception : {primary_exception, hedge_exception}) {
+            if (exception != nullptr) {
+                std::rethrow_exception(exception);
+            }
+        }
+        const std::array<rtype *, 2> results{&primary, &hedge};
+        // the one that succeeded, or the first failure if neither did
+        rtype *winner = results[order[0]];
+        if (!is_successful_attempt(*winner) && is_successful_attempt(*results[order[1]])) {
+            winner = results[order[1]];
+        }
+        res = std::move(*winner);
+    } else {
+        res =
+            co_await request_impl(method, path, is_path_encoded, query, std::move(headers), {}, {}, priority);
+    }
+    if (res && res->result_int() < 400) {
+        latencies_->add(
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start));
+    }
+    co_return res;
+}
+
+Session::crt Session::retry_impl(boost::beast::http::verb method, std::string_view path, bool is_path_encoded,
+                                 std::string_view query, boost::beast::http::fields headers,
+                                 std::span<const std::byte> body, std::optional<FileRange> file,
+                                 Priority priority) const {
+    using rtype = Session::crt::value_type;
+
+    const bool is_idempotent = method != boost::beast::http::verb::post;
+    bool redirected = false;
+    for (std::size_t attempt = 1;; attempt++) {
+        if (const auto wait_ec = co_await retry_policy_->acquire(priority); wait_ec.failed()) {
+            co_return rtype{std::unexpect, wait_ec};
+        }
+        auto res = co_await attempt_impl(method, path, is_path_encoded, query, headers, body, file, priority);
+        // the bucket lives in another region, follow right away, this doesn't count as a retry
+        if (res && !redirected && transport_->bucket_router->learn(path, res->base(), res->body())) {
+            redirected = true;
+            attempt--;
+            continue;
+        }
+        const auto outcome =
+            res ? _internal::RetryPolicy::classify(res->result_int(), s3_error_code(*res))
+                : _internal::RetryPolicy::classify(res.error(), is_idempotent);
+        retry_policy_->record(outcome, attempt);
+        if (!retry_policy_->should_retry(outcome, attempt)) {
+            co_return res;
+        }
+        if (const auto wait_ec = co_await retry_policy_->backoff(attempt); wait_ec.failed()) {
+            co_return rtype{std::unexpect, wait_ec};
+        }
+    }
+}
+
+Session::crt Session::method_impl(boost::beast::http::verb method, std::string_view path,
+                                  bool is_path_encoded, std::string_view query,
+                                  boost::beast::http::fields headers, std::span<const std::byte> body,
+                                  RequestOptions request_options, std::optional<FileRange> file) const {
+    const bool is_coalescable =
+        options_.coalesce_requests && !file.has_value() && body.empty() &&
+        (method == boost::beast::http::verb::get || method == boost::beast::http::verb::head);
+    if (!is_coalescable) {
+        return with_timeout(retry_impl(method, path, is_path_encoded, query, std::move(headers), body, file,
+                                       request_options.priority),
+                            request_options.timeout);
+    }
+    std::string key = coalescing_key(method, path, is_path_encoded, query, headers);
+    auto request = retry_impl(method, path, is_path_encoded, query, std::move(headers), body, file,
+                              request_options.priority);
+    return with_timeout(single_flight_->run(std::move(key), std::move(request)), request_options.timeout);
 }
 
 Session::crt Session::put(std::string_view path, std::span<const std::byte> data,
-                          boost::beast::http::fields headers, bool is_encoded) {
-    return method_impl(boost::beast::http::verb::put, path, is_encoded, {}, std::move(headers), data);
+                          boost::beast::http::fields headers, bool is_encoded,
+                          RequestOptions request_options) {
+    set_payload_signing(headers, request_options.payload_signing.value_or(options_.payload_signing));
+    return method_impl(boost::beast::http::verb::put, path, is_encoded, {}, std::move(headers), data,
+                       request_options);
 }
 
 Session::crt Session::put(std::string_view path, std::string_view data, boost::beast::http::fields headers,
-                          bool is_encoded) {
+                          bool is_encoded, RequestOptions request_options) {
     return put(path, std::as_bytes(std::span<const char>{data.data(), data.size()}), std::move(headers),
-               is_encoded);
+               is_encoded, request_options);
 }
 
 Session::crt Session::get(std::string_view path, std::string_view query, boost::beast::http::fields headers,
-                          bool is_path_encoded) const {
-    return method_impl(boost::beast::http::verb::get, path, is_path_encoded, query, std::move(headers), {});
+                          bool is_path_encoded, RequestOptions request_options) const {
+    return method_impl(boost::beast::http::verb::get, path, is_path_encoded, query, std::move(headers), {},
+                       request_options);
+}
+
+Session::crt Session::put_file(std::string_view path, FileRange source, boost::beast::http::fields headers,
+                               bool is_encoded, RequestOptions request_options) {
+    set_payload_signing(headers, request_options.payload_signing.value_or(options_.payload_signing));
+    return method_impl(boost::beast::http::verb::put, path, is_encoded, {}, std::move(headers), {},
+                       request_options, source);
+}
+
+Session::crt Session::put_stream(std::string_view path, UploadStream source,
+                                 boost::beast::http::fields headers, bool is_encoded,
+                                 RequestOptions request_options) {
+    const PayloadSigning signing = request_options.payload_signing.value_or(options_.payload_signing);
+    set_payload_signing(headers,
+                        signing == PayloadSigning::SIGNED ? PayloadSigning::SIGNED_STREAMING : signing);
+    return with_timeout(request_impl(boost::beast::http::verb::put, path, is_encoded, {}, std::move(headers),
+                                     {}, {}, request_options.priority, std::move(source)),
+                        request_options.timeout);
+}
+
+Session::crt Session::get_file(std::string_view path, int fd, std::uint64_t offset, std::string_view query,
+                               boost::beast::http::fields headers, bool is_path_encoded,
+                               RequestOptions request_options) const {
+    // the size is taken from the response
+    return method_impl(boost::beast::http::verb::get, path, is_path_encoded, query, std::move(headers), {},
+                       request_options, FileRange{.fd = fd, .offset = offset, .size = 0});
+}
+
+Session::exchange_crt Session::stream_impl(std::string_view path, std::string_view query,
+                                           boost::beast::http::fields headers, bool is_path_encoded,
+                                           Priority priority) const {
+    using rtype = Session::exchange_crt::value_type;
+
+    bool redirected = false;
+    for (std::size_t attempt = 1;; attempt++) {
+        if (const auto wait_ec = co_await retry_policy_->acquire(priority); wait_ec.failed()) {
+            co_return rtype{std::unexpect, wait_ec};
+        }
+        auto maybe_exchange = co_await open_impl(boost::beast::http::verb::get, path, is_path_encoded, query,
+                                                 headers, {}, {}, priority);
+        // the body is left to the caller, so only the header is known here
+        if (maybe_exchange && !redirected &&
+            transport_->bucket_router->learn(path, maybe_exchange.value()->header_parser.get().base(), {})) {
+            redirected = true;
+            attempt--;
+            continue;
+        }
+        const auto outcome =
+            maybe_exchange ? _internal::RetryPolicy::classify(
+                                 maybe_exchange.value()->header_parser.get().result_int(), {})
+                           : _internal::RetryPolicy::classify(maybe_exchange.error(), true);
+        retry_policy_->record(outcome, attempt);
+        if (!retry_policy_->should_retry(outcome, attempt)) {
+            co_return maybe_exchange;
+        }
+        if (const auto wait_ec = co_await retry_policy_->backoff(attempt); wait_ec.failed()) {
+            co_return rtype{std::unexpect, wait_ec};
+        }
+    }
+}
+
+Session::stream_crt Session::get_stream(std::string_view path, std::string_view query,
+                                        boost::beast::http::fields headers, bool is_path_encoded,
+                                        RequestOptions request_options) const {
+    using rtype = Session::stream_crt::value_type;
+
+    auto maybe_exchange = co_await with_timeout(
+        stream_impl(path, query, std::move(headers), is_path_encoded, request_options.priority),
+        request_options.timeout);
+    if (!maybe_exchange) {
+        co_return rtype{std::unexpect, maybe_exchange.error()};
+    }
+    co_return rtype{std::in_place, std::move(maybe_exchange.value())};
+}
+
+meta::crt<boost::asio::awaitable<boost::beast::error_code>>
+Session::connect_impl(std::string_view path) const {
+    const auto route = transport_->bucket_router->route(path);
+    std::vector<const _internal::LoadBalancer::Node *> unreachable;
+    boost::beast::error_code connect_ec;
+    while (true) {
+        auto ticket = co_await route.load_balancer->select(unreachable);
+        if (!ticket) {
+            co_return connect_ec.failed() ? connect_ec : ticket.error();
+        }
+        const _internal::LoadBalancer::Node &node = ticket->node();
+        auto acquired = co_await transport_->connection_pool->acquire(node.pool_key);
+        if (!acquired) {
+            co_return acquired.error();
+        }
+        auto &lease = acquired.value();
+        if (!lease.has_connection()) {
+            const bool is_ssl = node.gateway.scheme() != "http";
+            const boost::asio::any_io_executor executor = co_await boost::asio::this_coro::executor;
+            auto prep_res = co_await _internal::prepare_stream(
+                _internal::get_ssl_stream(is_ssl, options_.tls.kernel_tls, executor, transport_->ssl_ctx),
+                node.gateway, node.address, options_.transport, transport_->tls_sessions);
+            if (!prep_res) {
+                ticket->report(false);
+                if (is_connect_failure(prep_res.error())) {
+                    unreachable.push_back(&node);
+                    connect_ec = prep_res.error();
+                    continue;
+                }
+                co_return prep_res.error();
+            }
+            lease.emplace(std::move(prep_res.value()));
+        }
+        lease.release(_internal::ConnectionPool::Release::KEEP_ALIVE);
+        co_return boost::beast::error_code{};
+    }
+}
+
+Session::warm_up_crt Session::warm_up(std::size_t connections, std::string_view path) const {
+    using rtype = Session::warm_up_crt::value_type;
+
+    if (connections == 0) {
+        co_return rtype{0};
+    }
+    const boost::asio::any_io_executor executor = co_await boost::asio::this_coro::executor;
+    // all at once, each one holds on to its pool slot until connected, so none of them get the same one
+    using Operation = decltype(boost::asio::co_spawn(executor, connect_impl(path), boost::asio::deferred));
+    std::vector<Operation> operations;
+    operations.reserve(connections);
+    for (std::size_t i = 0; i < connections; i++) {
+        operations.push_back(boost::asio::co_spawn(executor, connect_impl(path), boost::asio::deferred));
+    }
+    const auto [order, exceptions, results] =
+        co_await boost::asio::experimental::make_parallel_group(std::move(operations))
+            .async_wait(boost::asio::experimental::wait_for_all(), boost::asio::use_awaitable);
+
+    std::size_t ready = 0;
+    boost::beast::error_code first_error;
+    for (std::size_t i = 0; i < connections; i++) {
+        if (exceptions[i] != nullptr) {
+            std::rethrow_exception(exceptions[i]);
+        }
+        if (!results[i].failed()) {
+            ready++;
+        } else if (!first_error.failed()) {
+            first_error = results[i];
+        }
+    }
+    if (ready == 0 && first_error.failed()) {
+        co_return rtype{std::unexpect, first_error};
+    }
+    co_return rtype{ready};
+}
+
+void Session::set_rate_limit(const RateLimit &limit) { rate_limiter_->configure(limit); }
+
+void Session::set_endpoint_rate_limit(const RateLimit &limit) {
+    _internal::RateLimiter::for_endpoint(this->endpoint)->configure(limit);
+}
+
+void Session::set_global_rate_limit(const RateLimit &limit) {
+    _internal::RateLimiter::global()->configure(limit);
+}
+
+ConnectionPoolStats Session::connection_pool_stats() const { return transport_->connection_pool->stats(); }
+
+std::vector<EndpointStats> Session::endpoint_stats() const { return transport_->bucket_router->stats(); }
+
+CoalescingStats Session::coalescing_stats() const { return single_flight_->stats(); }
+
+Session::Session(iam::Session session, SessionOptions options)
+    : iam::Session{std::move(session)}, options_{std::move(options)},
+      transport_{_internal::TransportContext::acquire(*this, options_)},
+      rate_limiter_{std::make_shared<_internal::RateLimiter>(
+          _internal::RateLimiter::for_endpoint(this->endpoint), options_.connection_pool.priority_weights)},
+      retry_policy_{std::make_shared<_internal::RetryPolicy>(options_.retry,
+                                                             options_.connection_pool.priority_weights)},
+      latencies_{std::make_shared<_internal::LatencyTracker>()},
+      single_flight_{std::make_shared<_internal::SingleFlight>()},
+      signing_keys_{std::make_shared<_internal::SigningKeyCache>(access_key, secret_access_key)},
+      payload_hasher_{std::make_shared<_internal::PayloadHasher>()} {
+    rate_limiter_->configure(options_.rate_limit);
 }
 
-Session::Session(iam::Session session)
-    : iam::Session{std::move(session)}, dns_cache_{std::make_shared<_internal::DnsCache>(this->endpoint)} {
-    ssl_ctx.set_default_verify_paths();
+Session::create_crt Session::create(iam::Session session, SessionOptions options) {
+    co_await _internal::TransportContext::preload();
+    co_return std::make_shared<Session>(std::move(session), std::move(options));
 }
 
 } // namespace s3cpp::aws::s3
@@ -1,16 +1,22 @@
 #include "session_extra.hpp"
 
-#include "dns_cache.hpp"
+#include "aws_chunked.hpp"
+#include "ktls_stream.hpp"
 #include "s3cpp/aws/iam/canonicalize.hpp"
-#include "s3cpp/aws/iam/session.hpp"
+#include "s3cpp/aws/iam/crypto.hpp"
 #include "s3cpp/aws/iam/sign_request.hpp"
-#include "s3cpp/aws/iam/string_to_sign.hpp"
-#include "s3cpp/aws/scope.hpp"
+#include "s3cpp/aws/s3/session.hpp"
 #include "s3cpp/meta.hpp"
+#include "signing_key_cache.hpp"
+#include "tls_session_cache.hpp"
 
 #include <boost/asio/any_io_executor.hpp>
 #include <boost/asio/as_tuple.hpp>
 #include <boost/asio/awaitable.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/ip/address.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/socket_base.hpp>
 #include <boost/asio/ssl/context.hpp>
 #include <boost/asio/ssl/error.hpp>
 #include <boost/asio/ssl/host_name_verification.hpp>
@@ -18,47 +24,129 @@
 #include <boost/asio/ssl/stream_base.hpp>
 #include <boost/asio/ssl/verify_mode.hpp>
 #include <boost/asio/use_awaitable.hpp>
+#include <boost/asio/write.hpp>
 #include <boost/beast/core/error.hpp>
 #include <boost/beast/core/tcp_stream.hpp>
 #include <boost/beast/http/field.hpp>
+#include <boost/beast/http/fields.hpp>  // IWYU pragma: keep
 #include <boost/beast/http/message.hpp> // IWYU pragma: keep
 #include <boost/beast/http/span_body.hpp>
+#include <boost/beast/http/verb.hpp>
+#include <boost/system/system_category.hpp> // IWYU pragma: keep
 #include <boost/url/url.hpp>
-#include <botan/hash.h>
-#include <botan/hex.h>
+#include <algorithm>
+#include <array>
+#include <cerrno>
 #include <chrono>
 #include <cstddef>
 #include <expected>
 #include <memory>
+#include <memory_resource>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <openssl/err.h>
+#include <openssl/ssl.h>
 #include <openssl/tls1.h>
+#include <span>
 #include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <tuple>
 #include <utility>
 #include <variant>
 
 namespace s3cpp::aws::s3::_internal {
 
 namespace {
+
 constexpr auto token = boost::asio::as_tuple(boost::asio::use_awaitable);
+
+[[nodiscard]] boost::beast::error_code set_option(boost::asio::ip::tcp::socket &socket, int level, int name,
+                                                  int value) {
+    if (::setsockopt(socket.native_handle(), level, name, &value, sizeof(value)) != 0) {
+        return boost::beast::error_code{errno, boost::system::system_category()};
+    }
+    return {};
+}
+
+// everything that has to happen between socket() and connect()
+[[nodiscard]] boost::beast::error_code open_socket(boost::asio::ip::tcp::socket &socket,
+                                                   const boost::asio::ip::tcp::endpoint &address,
+                                                   const TransportOptions &transport) {
+    boost::beast::error_code ec;
+    // NOLINTBEGIN(bugprone-unused-return-value)
+    socket.open(address.protocol(), ec);
+    if (ec.failed()) {
+        return ec;
+    }
+    socket.set_option(boost::asio::ip::tcp::no_delay{transport.no_delay}, ec);
+    if (ec.failed()) {
+        return ec;
+    }
+    // the window scale is negotiated in the handshake, so the buffers have to be sized before it
+    if (transport.send_buffer_size.has_value()) {
+        socket.set_option(boost::asio::socket_base::send_buffer_size{transport.send_buffer_size.value()}, ec);
+        if (ec.failed()) {
+            return ec;
+        }
+    }
+    if (transport.receive_buffer_size.has_value()) {
+        socket.set_option(
+            boost::asio::socket_base::receive_buffer_size{transport.receive_buffer_size.value()}, ec);
+        if (ec.failed()) {
+            return ec;
+        }
+    }
+    socket.set_option(boost::asio::socket_base::keep_alive{transport.keep_alive}, ec);
+    // NOLINTEND(bugprone-unused-return-value)
+    if (ec.failed()) {
+        return ec;
+    }
+    if (transport.keep_alive) {
+        for (const auto &[name, value] :
+             {std::pair{TCP_KEEPIDLE, static_cast<int>(transport.keep_alive_idle.count())},
+              std::pair{TCP_KEEPINTVL, static_cast<int>(transport.keep_alive_interval.count())},
+              std::pair{TCP_KEEPCNT, transport.keep_alive_count}}) {
+            if (ec = set_option(socket, IPPROTO_TCP, name, value); ec.failed()) {
+                return ec;
+            }
+        }
+    }
+    // older kernels don't know the option, connecting the regular way is fine then
+    if (transport.fast_open) {
+        std::ignore = set_option(socket, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, 1);
+    }
+    if (transport.local_address.has_value() &&
+        transport.local_address->is_v4() == address.address().is_v4()) {
+        // the port gets picked on connect, binding it right away would limit us to one connection per port
+        std::ignore = set_option(socket, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, 1);
+        // NOLINTNEXTLINE(bugprone-unused-return-value)
+        socket.bind(boost::asio::ip::tcp::endpoint{transport.local_address.value(), 0}, ec);
+        if (ec.failed()) {
+            return ec;
+        }
+    }
+    return {};
 }
 
-std::variant<boost::beast::tcp_stream, boost::asio::ssl::stream<boost::beast::tcp_stream>>
-get_ssl_stream(bool is_ssl, boost::asio::any_io_executor executor, boost::asio::ssl::context &ssl_ctx) {
+} // namespace
+
+Stream get_ssl_stream(bool is_ssl, bool use_ktls, boost::asio::any_io_executor executor,
+                      boost::asio::ssl::context &ssl_ctx) {
+    if (is_ssl && use_ktls) {
+        return Stream{std::in_place_index<2>, executor, ssl_ctx.native_handle()};
+    }
     if (is_ssl) {
         return boost::asio::ssl::stream<boost::beast::tcp_stream>{executor, ssl_ctx};
     }
     return {boost::beast::tcp_stream{executor}};
 }
 
-meta::crt<boost::asio::awaitable<
-    std::expected<std::variant<boost::beast::tcp_stream, boost::asio::ssl::stream<boost::beast::tcp_stream>>,
-                  boost::beast::error_code>>>
-prepare_stream(
-    std::variant<boost::beast::tcp_stream, boost::asio::ssl::stream<boost::beast::tcp_stream>> stream,
-    boost::urls::url endpoint, std::shared_ptr<DnsCache> dns_cache) {
-    using rtype = std::expected<
-        std::variant<boost::beast::tcp_stream, boost::asio::ssl::stream<boost::beast::tcp_stream>>,
-        boost::beast::error_code>;
+meta::crt<boost::asio::awaitable<std::expected<Stream, boost::beast::error_code>>>
+prepare_stream(Stream stream, boost::urls::url endpoint, boost::asio::ip::tcp::endpoint address,
+               TransportOptions transport, std::shared_ptr<TlsSessionCache> tls_sessions,
+               std::string_view early_data) {
+    using rtype = std::expected<Stream, boost::beast::error_code>;
 
     std::visit(
         [&](auto &stream_) {
@@ -66,17 +154,22 @@ prepare_stream(
         },
         stream);
 
-    const auto maybe_resolved_eps = co_await dns_cache->get_endpoint();
-    if (!maybe_resolved_eps) {
-        co_return rtype{std::unexpect, maybe_resolved_eps.error()};
+    {
+        const auto open_ec = std::visit(
+            [&](auto &stream_) {
+                return open_socket(boost::beast::get_lowest_layer(stream_).socket(), address, transport);
+            },
+            stream);
+        if (open_ec.failed()) {
+            co_return rtype{std::unexpect, open_ec};
+        }
     }
-    const auto &resolved_eps = *maybe_resolved_eps;
 
     {
-        const auto [con_ec, con_ep] = co_await std::visit(
+        const auto [con_ec] = co_await std::visit(
             [&](auto &stream_) {
                 // NOLINTNEXTLINE(clang-analyzer-core.NullDereference)
-                return boost::beast::get_lowest_layer(stream_).async_connect(resolved_eps, token);
+                return boost::beast::get_lowest_layer(stream_).async_connect(address, token);
             },
             stream);
         if (con_ec.failed()) {
@@ -84,15 +177,22 @@ prepare_stream(
         }
     }
 
-    {
-        const bool is_ssl = stream.index() == 1;
-        if (is_ssl) {
-            if (SSL_set_tlsext_host_name(std::get<1>(stream).native_handle(), endpoint.host_name().c_str()) !=
-                1) {
+    if (stream.index() != 0) {
+        const bool is_ktls = stream.index() == 2;
+        SSL *const ssl = is_ktls ? std::get<2>(stream).native_handle() : std::get<1>(stream).native_handle();
+        if (SSL_set_tlsext_host_name(ssl, endpoint.host_name().c_str()) != 1) {
+            co_return rtype{std::unexpect, boost::beast::error_code{static_cast<int>(::ERR_get_error()),
+                                                                    boost::asio::error::get_ssl_category()}};
+        }
+        if (is_ktls) {
+            // asio's verify callback only exists on its own stream, OpenSSL can check the host name itself
+            if (SSL_set1_host(ssl, endpoint.host_name().c_str()) != 1) {
                 co_return rtype{std::unexpect,
                                 boost::beast::error_code{static_cast<int>(::ERR_get_error()),
                                                          boost::asio::error::get_ssl_category()}};
             }
+            SSL_set_verify(ssl, SSL_VERIFY_PEER, nullptr);
+        } else {
             {
                 boost::beast::error_code ssl_verify_callback_ec;
                 ssl_verify_callback_ec = std::get<1>(stream).set_verify_callback(
@@ -111,42 +211,92 @@ prepare_stream(
                     co_return rtype{std::unexpect, ssl_verify_mode_ec};
                 }
             }
+        }
 
-            const auto [shake_ec] =
-                co_await std::get<1>(stream).async_handshake(boost::asio::ssl::stream_base::client, token);
-            if (shake_ec.failed()) {
-                co_return rtype{std::unexpect, shake_ec};
+        if (tls_sessions != nullptr) {
+            if (const auto session = tls_sessions->take(endpoint.host_name()); session != nullptr) {
+                if (SSL_set_session(ssl, session.get()) != 1) {
+                    co_return rtype{std::unexpect,
+                                    boost::beast::error_code{static_cast<int>(::ERR_get_error()),
+                                                             boost::asio::error::get_ssl_category()}};
+                }
+                // KtlsStream writes straight to the socket and has no way to queue up early data
+                if (!is_ktls && !early_data.empty() &&
+                    SSL_SESSION_get_max_early_data(session.get()) >= early_data.size()) {
+                    auto records = write_early_data(ssl, early_data);
+                    if (!records.has_value()) {
+                        co_return rtype{std::unexpect, early_data_failed};
+                    }
+                    const auto [early_ec, early_n] = co_await boost::asio::async_write(
+                        boost::beast::get_lowest_layer(std::get<1>(stream)),
+                        boost::asio::buffer(records.value()), token);
+                    if (early_ec.failed()) {
+                        co_return rtype{std::unexpect, early_ec};
+                    }
+                }
             }
         }
+
+        const auto [shake_ec] =
+            is_ktls
+                ? co_await std::get<2>(stream).async_handshake(token)
+                : co_await std::get<1>(stream).async_handshake(boost::asio::ssl::stream_base::client, token);
+        if (shake_ec.failed()) {
+            co_return rtype{std::unexpect, shake_ec};
+        }
     }
 
     co_return rtype{std::move(stream)};
 }
 
-boost::beast::http::request<boost::beast::http::span_body<const std::byte>>
-prepare_request(boost::beast::http::request<boost::beast::http::span_body<const std::byte>> request,
-                const iam::Session &session) {
-    request.set(boost::beast::http::field::host, session.endpoint.encoded_host_and_port());
+bool early_data_accepted(Stream &stream) {
+    return stream.index() == 1 &&
+           SSL_get_early_data_status(std::get<1>(stream).native_handle()) == SSL_EARLY_DATA_ACCEPTED;
+}
+
+ArenaRequest make_request(boost::beast::http::verb method, std::string_view target,
+                          std::span<const std::byte> body, const boost::beast::http::fields &headers,
+                          std::pmr::memory_resource *memory) {
+    ArenaRequest ret{method, target, 11, body, std::pmr::polymorphic_allocator<char>{memory}};
+    for (const auto &field : headers) {
+        ret.insert(field.name(), field.name_string(), field.value());
+    }
+    return ret;
+}
+
+RequestSignature prepare_request(ArenaRequest &request, SigningKeyCache &signing_keys,
+                                 const boost::urls::url &endpoint, std::string_view region,
+                                 std::pmr::memory_resource *memory) {
+    request.set(boost::beast::http::field::host, endpoint.encoded_host_and_port());
     if (request["x-amz-content-sha256"].empty()) {
-        auto hash = Botan::HashFunction::create_or_throw("SHA-256");
-        hash->update(std::string_view{
-            meta::safe_reinterpret_cast<const std::string_view::value_type *>(request.body().data()),
-            request.body().size()});
-        request.set("x-amz-content-sha256", Botan::hex_encode(hash->final_stdvec(), false));
+        if (request.body().empty()) {
+            request.set("x-amz-content-sha256", empty_payload_sha256);
+        } else {
+            const iam::_internal::sha256_hex hex = iam::_internal::hex_encode(iam::_internal::sha256(
+                std::string_view{meta::safe_reinterpret_cast<const std::string_view::value_type *>(
+                                     request.body().data()),
+                                 request.body().size()}));
+            request.set("x-amz-content-sha256", iam::_internal::to_string_view(hex));
+        }
     }
     request.content_length(request.payload_size());
-    const auto now = std::chrono::system_clock::now();
-    const std::string timestamp = iam::format_timestamp(now);
+    const std::array<char, 16> timestamp_buf = amz_date(std::chrono::system_clock::now());
+    const std::string_view timestamp{timestamp_buf.data(), timestamp_buf.size()};
     request.set("x-amz-date", timestamp);
     request.set(boost::beast::http::field::accept_encoding, "identity");
 
-    const Scope scope{.timestamp = timestamp.substr(0, 8), .region = session.region, .service = "s3"};
-    const auto &[canonical, signed_headers] = s3cpp::aws::iam::canonicalize_request(request);
-    const std::string sign = s3cpp::aws::iam::sign_request(session.access_key, session.secret_access_key,
-                                                           canonical, signed_headers, timestamp, scope);
+    RequestSignature ret{.scope = signing_keys.get(timestamp.substr(0, 8), region),
+                         .timestamp = timestamp_buf,
+                         .signature = {}};
+    const auto &[canonical, signed_headers] = s3cpp::aws::iam::canonicalize_request(request, memory);
+    const std::pmr::string sign = s3cpp::aws::iam::sign_request_with_key(
+        signing_keys.access_key(), ret.scope->key, canonical, signed_headers, timestamp,
+        ret.scope->credential_scope, memory);
     request.set(boost::beast::http::field::authorization, sign);
-
-    return request;
+    // the header ends with Signature=<signature>
+    std::ranges::copy(std::string_view{sign}.substr(sign.size() - ret.signature.size()),
+                      ret.signature.begin());
+    return ret;
 }
 
 } // namespace s3cpp::aws::s3::_internal
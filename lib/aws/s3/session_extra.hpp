@@ -1,6 +1,12 @@
-#include "dns_cache.hpp"
-#include "s3cpp/aws/iam/session.hpp"
+#pragma once
+
+#include "ktls_stream.hpp"
+#include "s3cpp/aws/iam/canonicalize.hpp"
+#include "s3cpp/aws/iam/crypto.hpp"
+#include "s3cpp/aws/s3/session.hpp"
 #include "s3cpp/meta.hpp"
+#include "signing_key_cache.hpp"
+#include "tls_session_cache.hpp"
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wdeprecated-declarations"
@@ -9,34 +15,82 @@
 
 #include <boost/asio/any_io_executor.hpp>
 #include <boost/asio/awaitable.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/ssl/context.hpp>
 #include <boost/asio/ssl/stream.hpp>
 #include <boost/beast/core/error.hpp>
 #include <boost/beast/core/tcp_stream.hpp>
+#include <boost/beast/http/fields.hpp>  // IWYU pragma: keep
 #include <boost/beast/http/message.hpp> // IWYU pragma: keep
+#include <boost/beast/http/verb.hpp>
 #include <boost/url/url.hpp>
+#include <array>
 #include <cstddef>
 #include <expected>
 #include <memory>
+#include <memory_resource>
+#include <span>
+#include <string_view>
 #include <variant>
 
 namespace s3cpp::aws::s3::_internal {
 
-[[nodiscard]] std::variant<boost::beast::tcp_stream, boost::asio::ssl::stream<boost::beast::tcp_stream>>
-get_ssl_stream(bool is_ssl, boost::asio::any_io_executor executor, boost::asio::ssl::context &ssl_ctx);
-
-[[nodiscard]] meta::crt<boost::asio::awaitable<
-    std::expected<std::variant<boost::beast::tcp_stream, boost::asio::ssl::stream<boost::beast::tcp_stream>>,
-                  boost::beast::error_code>>>
-prepare_stream(
-    std::variant<boost::beast::tcp_stream, boost::asio::ssl::stream<boost::beast::tcp_stream>> stream
-    [[clang::lifetimebound]],
-    boost::urls::url endpoint, std::shared_ptr<DnsCache> dns_cache);
-
-[[nodiscard]]
-boost::beast::http::request<boost::beast::http::span_body<const std::byte>>
-prepare_request(boost::beast::http::request<boost::beast::http::span_body<const std::byte>> request
-                [[clang::lifetimebound]],
-                const iam::Session &session);
+using Stream = std::variant<boost::beast::tcp_stream, boost::asio::ssl::stream<boost::beast::tcp_stream>,
+                            KtlsStream>;
+
+// use_ktls picks KtlsStream over asio's TLS stream
+[[nodiscard]] Stream get_ssl_stream(bool is_ssl, bool use_ktls, boost::asio::any_io_executor executor,
+                                    boost::asio::ssl::context &ssl_ctx);
+
+[[nodiscard]] meta::crt<boost::asio::awaitable<std::expected<Stream, boost::beast::error_code>>>
+prepare_stream(Stream stream [[clang::lifetimebound]], boost::urls::url endpoint,
+               boost::asio::ip::tcp::endpoint address, TransportOptions transport,
+               std::shared_ptr<TlsSessionCache> tls_sessions, std::string_view early_data = {});
+// prepare_stream fails with this if early_data couldn't be written, a fresh stream without it will do
+inline constexpr auto early_data_failed = boost::asio::error::try_again;
+
+// whether the server accepted the early_data passed to prepare_stream
+[[nodiscard]] bool early_data_accepted(Stream &stream);
+
+// A request whose headers, and the strings that go into signing it, live in a RequestArena.
+using ArenaRequest =
+    boost::beast::http::request<boost::beast::http::span_body<const std::byte>, iam::_internal::pmr_fields>;
+
+// Scratch memory for building and signing one request, released all at once when the arena goes away.
+// A typical request fits into the inline buffer and doesn't touch the heap, larger ones spill over to it.
+class RequestArena {
+private:
+    std::array<std::byte, 4096> buffer_;
+    std::pmr::monotonic_buffer_resource resource_{buffer_.data(), buffer_.size()};
+
+public:
+    [[nodiscard]] RequestArena() = default;
+    ~RequestArena() = default;
+
+    RequestArena(const RequestArena &) = delete;
+    RequestArena &operator=(const RequestArena &) = delete;
+    RequestArena(RequestArena &&) = delete;
+    RequestArena &operator=(RequestArena &&) = delete;
+
+    [[nodiscard]] std::pmr::memory_resource *resource() { return &resource_; }
+};
+
+[[nodiscard]] ArenaRequest make_request(boost::beast::http::verb method, std::string_view target,
+                                        std::span<const std::byte> body [[clang::lifetimebound]],
+                                        const boost::beast::http::fields &headers,
+                                        std::pmr::memory_resource *memory);
+
+// what a request was signed with, the chunk signatures of an aws-chunked body are chained from it
+struct RequestSignature {
+    std::shared_ptr<const SigningScope> scope;
+    std::array<char, 16> timestamp;
+    iam::_internal::sha256_hex signature;
+};
+
+// sets the Host header for endpoint and (re-)signs the request, all allocations come from memory
+[[nodiscard]] RequestSignature prepare_request(ArenaRequest &request, SigningKeyCache &signing_keys,
+                                               const boost::urls::url &endpoint, std::string_view region,
+                                               std::pmr::memory_resource *memory);
 
 } // namespace s3cpp::aws::s3::_internal
@@ -0,0 +1,69 @@
+#include "signing_key_cache.hpp"
+
+#include "s3cpp/aws/iam/sign_request.hpp"
+#include "s3cpp/aws/iam/string_to_sign.hpp"
+#include "s3cpp/aws/scope.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace s3cpp::aws::s3::_internal {
+
+SigningKeyCache::SigningKeyCache(std::string access_key, std::string secret_access_key)
+    : access_key_{std::move(access_key)}, secret_access_key_{std::move(secret_access_key)} {}
+
+std::shared_ptr<const SigningScope> SigningKeyCache::derive(std::string_view date,
+                                                            std::string_view region) const {
+    const Scope scope{.timestamp = std::string{date}, .region = std::string{region}, .service = "s3"};
+    return std::make_shared<const SigningScope>(scope.timestamp, scope.region, std::format("{}", scope),
+                                                iam::get_signing_key(secret_access_key_, scope));
+}
+
+std::shared_ptr<const SigningScope> SigningKeyCache::get(std::string_view date, std::string_view region) {
+    {
+        const std::scoped_lock lock{mutex_};
+        // YYYYMMDD sorts like the dates it stands for
+        if (date > date_) {
+            date_ = date;
+            scopes_.clear();
+        }
+        if (date == date_) {
+            const auto it = std::ranges::find_if(
+                scopes_, [region](const auto &scope) { return scope->region == region; });
+            if (it != scopes_.end()) {
+                return *it;
+            }
+        }
+    }
+
+    // derived outside the lock, two threads racing for a new region both derive it and one of them wins
+    auto ret = derive(date, region);
+    const std::scoped_lock lock{mutex_};
+    if (date == date_ && std::ranges::none_of(scopes_, [region](const auto &scope) {
+            return scope->region == region;
+        })) {
+        scopes_.push_back(ret);
+    }
+    return ret;
+}
+
+std::array<char, 16> amz_date(std::chrono::system_clock::time_point now) {
+    thread_local std::chrono::sys_seconds cached_second{};
+    thread_local std::array<char, 16> cached{};
+
+    const auto second = std::chrono::floor<std::chrono::seconds>(now);
+    if (second != cached_second) {
+        iam::format_timestamp_to(cached.data(), second);
+        cached_second = second;
+    }
+    return cached;
+}
+
+} // namespace s3cpp::aws::s3::_internal
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace s3cpp::aws::s3::_internal {
+
+// the SigV4 signing key and credential scope for one date and region
+struct SigningScope {
+    std::string date;
+    std::string region;
+    // date/region/s3/aws4_request
+    std::string credential_scope;
+    std::vector<std::uint8_t> key;
+};
+
+// The signing key only depends on the secret, the date, the region and the service, so it is derived once
+// per region and UTC day instead of per request.
+// The cache moves forward with the date. Requests that are still signed with the previous date around
+// midnight get their scope derived on the spot, so that they don't evict the current one.
+class SigningKeyCache {
+private:
+    std::string access_key_;
+    std::string secret_access_key_;
+
+    std::mutex mutex_;
+    std::string date_;
+    std::vector<std::shared_ptr<const SigningScope>> scopes_;
+
+    [[nodiscard]] std::shared_ptr<const SigningScope> derive(std::string_view date,
+                                                             std::string_view region) const;
+
+public:
+    [[nodiscard]] SigningKeyCache(std::string access_key, std::string secret_access_key);
+
+    [[nodiscard]] std::string_view access_key() const { return access_key_; }
+
+    // date is YYYYMMDD
+    [[nodiscard]] std::shared_ptr<const SigningScope> get(std::string_view date, std::string_view region);
+};
+
+// the x-amz-date timestamp for now, formatted at most once per second and thread
+[[nodiscard]] std::array<char, 16> amz_date(std::chrono::system_clock::time_point now);
+
+} // namespace s3cpp::aws::s3::_internal
@@ -0,0 +1,99 @@
+#include "single_flight.hpp"
+
+#include "s3cpp/aws/s3/session.hpp"
+#include "s3cpp/meta.hpp"
+
+#include <boost/asio/as_tuple.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/this_coro.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/system/error_code.hpp>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace s3cpp::aws::s3::_internal {
+
+namespace {
+
+constexpr auto token = boost::asio::as_tuple(boost::asio::use_awaitable);
+
+} // namespace
+
+SingleFlight::Landing::Landing(SingleFlight &single_flight, const std::string &key,
+                               std::shared_ptr<Flight> flight)
+    : single_flight_{&single_flight}, key_{&key}, flight_{std::move(flight)} {}
+
+SingleFlight::Landing::~Landing() {
+    single_flight_->land(*key_, *flight_, result_type{std::unexpect, boost::asio::error::operation_aborted});
+}
+
+void SingleFlight::land(const std::string &key, Flight &flight, const result_type &result) {
+    std::vector<std::shared_ptr<Waiter>> waiters;
+    {
+        const std::scoped_lock lock{mutex_};
+        if (flight.result.has_value()) {
+            return;
+        }
+        flight.result = result;
+        // later callers start a new flight, their request may have been sent after this response
+        if (const auto it = flights_.find(key); it != flights_.end() && it->second.get() == &flight) {
+            flights_.erase(it);
+        }
+        waiters = std::move(flight.waiters);
+    }
+    if (!waiters.empty()) {
+        merges_++;
+    }
+    for (const auto &waiter : waiters) {
+        waiter->try_send(boost::system::error_code{});
+    }
+}
+
+meta::crt<boost::asio::awaitable<SingleFlight::result_type>>
+SingleFlight::run(std::string key, boost::asio::awaitable<result_type> request) {
+    const auto executor = co_await boost::asio::this_coro::executor;
+    while (true) {
+        std::shared_ptr<Flight> flight;
+        std::shared_ptr<Waiter> waiter;
+        {
+            const std::scoped_lock lock{mutex_};
+            auto &entry = flights_[key];
+            if (entry == nullptr) {
+                entry = std::make_shared<Flight>();
+            } else {
+                waiter = std::make_shared<Waiter>(executor, 1);
+                entry->waiters.push_back(waiter);
+            }
+            flight = entry;
+        }
+
+        if (waiter == nullptr) {
+            const Landing landing{*this, key, flight};
+            auto res = co_await std::move(request);
+            land(key, *flight, res);
+            co_return res;
+        }
+
+        // a waiter that gives up stays in the list, waking it later is harmless
+        const auto [wait_ec] = co_await waiter->async_receive(token);
+        if (wait_ec.failed()) {
+            co_return result_type{std::unexpect, wait_ec};
+        }
+        // the result was written before the wakeup was sent and is never written again
+        const result_type &res = flight->result.value();
+        if (res || res.error() != boost::asio::error::operation_aborted) {
+            hits_++;
+            co_return res;
+        }
+        // the leader was cancelled, not the request
+    }
+}
+
+CoalescingStats SingleFlight::stats() const { return {.hits = hits_.load(), .merges = merges_.load()}; }
+
+} // namespace s3cpp::aws::s3::_internal
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "s3cpp/aws/s3/session.hpp"
+#include "s3cpp/meta.hpp"
+
+#include <atomic>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/experimental/concurrent_channel.hpp>
+#include <boost/beast/core/error.hpp>
+#include <boost/beast/http/message.hpp>
+#include <boost/beast/http/string_body.hpp>
+#include <boost/system/error_code.hpp> // IWYU pragma: keep
+#include <cstddef>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace s3cpp::aws::s3::_internal {
+
+// Coalesces identical requests that are in flight at the same time.
+// The first caller for a key (the leader) sends its request, everyone arriving before it completes waits
+// for it and gets a copy of the same response. If the leader gets cancelled, the waiters start over and one
+// of them sends its own request.
+class SingleFlight {
+public:
+    using result_type = std::expected<boost::beast::http::response<boost::beast::http::string_body>,
+                                      boost::beast::error_code>;
+
+private:
+    using Waiter = boost::asio::experimental::concurrent_channel<void(boost::system::error_code)>;
+
+    struct Flight {
+        std::optional<result_type> result;
+        std::vector<std::shared_ptr<Waiter>> waiters;
+    };
+
+    // lands the flight if the leader goes away without a result
+    class Landing {
+    private:
+        SingleFlight *single_flight_;
+        const std::string *key_;
+        std::shared_ptr<Flight> flight_;
+
+    public:
+        [[nodiscard]] Landing(SingleFlight &single_flight, const std::string &key,
+                              std::shared_ptr<Flight> flight);
+        ~Landing();
+
+        Landing(const Landing &) = delete;
+        Landing &operator=(const Landing &) = delete;
+        Landing(Landing &&) = delete;
+        Landing &operator=(Landing &&) = delete;
+    };
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_ptr<Flight>> flights_;
+
+    std::atomic<std::size_t> hits_;
+    std::atomic<std::size_t> merges_;
+
+    // publishes the result to the waiters, only the first call per flight has an effect
+    void land(const std::string &key, Flight &flight, const result_type &result);
+
+public:
+    // request is only awaited if no identical request is in flight
+    [[nodiscard]] meta::crt<boost::asio::awaitable<result_type>>
+    run(std::string key, boost::asio::awaitable<result_type> request);
+
+    [[nodiscard]] CoalescingStats stats() const;
+};
+
+} // namespace s3cpp::aws::s3::_internal
@@ -0,0 +1,243 @@
+#include "tls_session_cache.hpp"
+
+#include <boost/scope/scope_exit.hpp>
+#include <botan/hex.h>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <exception>
+#include <fcntl.h>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <openssl/bio.h>
+#include <openssl/crypto.h>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <optional>
+#include <print>
+#include <string>
+#include <string_view>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <system_error>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace s3cpp::aws::s3::_internal {
+
+namespace {
+
+[[nodiscard]] bool is_usable(const SSL_SESSION *session) {
+    return SSL_SESSION_is_resumable(session) == 1 &&
+           SSL_SESSION_get_time(session) + SSL_SESSION_get_timeout(session) > std::time(nullptr);
+}
+
+// NOLINTBEGIN(bugprone-easily-swappable-parameters)
+void free_cache_ref([[maybe_unused]] void *parent, void *ptr, [[maybe_unused]] CRYPTO_EX_DATA *ex_data,
+                    [[maybe_unused]] int idx, [[maybe_unused]] long argl, [[maybe_unused]] void *argp) {
+    // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+    delete static_cast<std::shared_ptr<TlsSessionCache> *>(ptr);
+}
+// NOLINTEND(bugprone-easily-swappable-parameters)
+
+[[nodiscard]] int cache_ex_index() {
+    static const int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, &free_cache_ref);
+    return index;
+}
+
+int new_session_callback(SSL *ssl, SSL_SESSION *session) {
+    auto *cache = static_cast<std::shared_ptr<TlsSessionCache> *>(
+        SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), cache_ex_index()));
+    if (cache == nullptr) {
+        return 0;
+    }
+    (*cache)->put(session);
+    // we took ownership of the reference
+    return 1;
+}
+
+} // namespace
+
+TlsSessionCache::TlsSessionCache(std::optional<std::filesystem::path> persist_path)
+    : persist_path_{std::move(persist_path)} {
+    if (persist_path_.has_value()) {
+        load();
+    }
+}
+
+// NOLINTNEXTLINE(bugprone-exception-escape)
+TlsSessionCache::~TlsSessionCache() {
+    if (persist_path_.has_value()) {
+        save();
+    }
+}
+
+std::shared_ptr<TlsSessionCache> TlsSessionCache::attach(SSL_CTX *ssl_ctx,
+                                                         std::optional<std::filesystem::path> persist_path) {
+    auto ret = std::make_shared<TlsSessionCache>(std::move(persist_path));
+    // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+    SSL_CTX_set_ex_data(ssl_ctx, cache_ex_index(), new std::shared_ptr<TlsSessionCache>{ret});
+    // we do the lookup ourselves, OpenSSL's internal store is keyed by session id and meant for servers
+    SSL_CTX_set_session_cache_mode(ssl_ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(ssl_ctx, &new_session_callback);
+    return ret;
+}
+
+void TlsSessionCache::put(SSL_SESSION *session) {
+    SessionPtr owned{session};
+    const char *host = SSL_SESSION_get0_hostname(session);
+    if (host == nullptr || !is_usable(session)) {
+        return;
+    }
+    const std::scoped_lock lock{mutex_};
+    auto &host_sessions = sessions_[host];
+    host_sessions.push_back(std::move(owned));
+    if (host_sessions.size() > max_sessions_per_host) {
+        host_sessions.pop_front();
+    }
+}
+
+TlsSessionCache::SessionPtr TlsSessionCache::take(std::string_view host) {
+    const std::scoped_lock lock{mutex_};
+    const auto iter = sessions_.find(std::string{host});
+    if (iter == sessions_.end()) {
+        return nullptr;
+    }
+    auto &host_sessions = iter->second;
+    while (!host_sessions.empty()) {
+        SessionPtr session = std::move(host_sessions.back());
+        host_sessions.pop_back();
+        if (!is_usable(session.get())) {
+            continue;
+        }
+        if (SSL_SESSION_get_protocol_version(session.get()) < TLS1_3_VERSION) {
+            // TLS 1.2 sessions may be resumed any number of times
+            SSL_SESSION_up_ref(session.get());
+            host_sessions.emplace_back(session.get());
+        }
+        return session;
+    }
+    return nullptr;
+}
+
+// file format: one "<host> <hex encoded DER session>" per line
+void TlsSessionCache::load() {
+    std::ifstream file{*persist_path_};
+    std::string host;
+    std::string encoded;
+    while (file >> host >> encoded) {
+        std::vector<std::uint8_t> der;
+        try {
+            der = Botan::hex_decode(encoded);
+        } catch (const std::exception &) {
+            std::println(std::cerr, "WARN ignoring malformed TLS session for {} in {}", host,
+                         persist_path_->string());
+            continue;
+        }
+        const unsigned char *der_ptr = der.data();
+        SessionPtr session{d2i_SSL_SESSION(nullptr, &der_ptr, static_cast<long>(der.size()))};
+        if (session == nullptr || !is_usable(session.get())) {
+            continue;
+        }
+        auto &host_sessions = sessions_[host];
+        if (host_sessions.size() < max_sessions_per_host) {
+            host_sessions.push_back(std::move(session));
+        }
+    }
+}
+
+void TlsSessionCache::save() {
+    const std::scoped_lock lock{mutex_};
+    std::string contents;
+    for (const auto &[host, host_sessions] : sessions_) {
+        for (const auto &session : host_sessions) {
+            if (!is_usable(session.get())) {
+                continue;
+            }
+            const int der_len = i2d_SSL_SESSION(session.get(), nullptr);
+            if (der_len <= 0) {
+                continue;
+            }
+            std::vector<std::uint8_t> der(static_cast<std::size_t>(der_len));
+            unsigned char *der_ptr = der.data();
+            i2d_SSL_SESSION(session.get(), &der_ptr);
+            std::format_to(std::back_inserter(contents), "{} {}\n", host, Botan::hex_encode(der, false));
+        }
+    }
+
+    // write to a temporary file first so that a crash doesn't leave a truncated cache behind
+    std::filesystem::path tmp_path = *persist_path_;
+    tmp_path += ".tmp";
+    {
+        // the sessions hold the secrets to resume them, only we may read them
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg)
+        const int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+        if (fd < 0) {
+            std::println(std::cerr, "WARN failed to write TLS session cache {}: {}", tmp_path.string(),
+                         std::generic_category().message(errno));
+            return;
+        }
+        const boost::scope::scope_exit close_fd{[fd]() { ::close(fd); }};
+        // O_CREAT leaves the mode of a file that is already there alone
+        bool failed = ::fchmod(fd, S_IRUSR | S_IWUSR) != 0;
+        for (std::size_t written = 0; !failed && written < contents.size();) {
+            const ssize_t res = ::write(fd, contents.data() + written, contents.size() - written);
+            if (res < 0 && errno == EINTR) {
+                continue;
+            }
+            failed = res < 0;
+            written += failed ? 0 : static_cast<std::size_t>(res);
+        }
+        if (failed) {
+            std::println(std::cerr, "WARN failed to write TLS session cache {}: {}", tmp_path.string(),
+                         std::generic_category().message(errno));
+            return;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, *persist_path_, ec);
+    if (ec) {
+        std::println(std::cerr, "WARN failed to write TLS session cache {}: {}", persist_path_->string(),
+                     ec.message());
+    }
+}
+
+std::optional<std::string> write_early_data(SSL *ssl, std::string_view data) {
+    // asio's ssl engine only flushes records that were produced during its own operations.
+    // Temporarily redirect the write side into a memory BIO so that we can send the ClientHello and the
+    // early data ourselves. The handshake then continues through the engine as usual.
+    BIO *const engine_bio = SSL_get_wbio(ssl);
+    BIO *const capture_bio = BIO_new(BIO_s_mem());
+    if (capture_bio == nullptr || BIO_up_ref(engine_bio) != 1) {
+        BIO_free(capture_bio);
+        ::ERR_clear_error();
+        return std::nullopt;
+    }
+    SSL_set0_wbio(ssl, capture_bio);
+
+    std::size_t written{};
+    const int res = SSL_write_early_data(ssl, data.data(), data.size(), &written);
+
+    char *captured{};
+    const long captured_len = BIO_get_mem_data(capture_bio, &captured);
+    std::string ret{captured, static_cast<std::size_t>(captured_len)};
+
+    // also frees capture_bio
+    SSL_set0_wbio(ssl, engine_bio);
+
+    if (res != 1 || written != data.size()) {
+        // the errors, if any, belong to this attempt, the next operation on the thread mustn't see them
+        ::ERR_clear_error();
+        return std::nullopt;
+    }
+    return ret;
+}
+
+} // namespace s3cpp::aws::s3::_internal
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <openssl/ssl.h>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace s3cpp::aws::s3::_internal {
+
+// Client side TLS session cache.
+// Sessions are keyed by SNI host name and handed out for resumption on new connections.
+// TLS 1.3 tickets are single use, TLS 1.2 sessions are kept until they expire.
+class TlsSessionCache {
+public:
+    struct SessionDeleter {
+        void operator()(SSL_SESSION *session) const { SSL_SESSION_free(session); }
+    };
+    using SessionPtr = std::unique_ptr<SSL_SESSION, SessionDeleter>;
+
+private:
+    constexpr static std::size_t max_sessions_per_host = 16;
+
+    std::optional<std::filesystem::path> persist_path_;
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::deque<SessionPtr>> sessions_;
+
+    void load();
+    void save();
+
+public:
+    [[nodiscard]] explicit TlsSessionCache(std::optional<std::filesystem::path> persist_path);
+    ~TlsSessionCache();
+
+    TlsSessionCache(const TlsSessionCache &) = delete;
+    TlsSessionCache &operator=(const TlsSessionCache &) = delete;
+    TlsSessionCache(TlsSessionCache &&) = delete;
+    TlsSessionCache &operator=(TlsSessionCache &&) = delete;
+
+    // Installs a cache on ssl_ctx. The context keeps its own reference, new sessions negotiated on any
+    // connection created from ssl_ctx end up in the returned cache.
+    [[nodiscard]] static std::shared_ptr<TlsSessionCache>
+    attach(SSL_CTX *ssl_ctx, std::optional<std::filesystem::path> persist_path);
+
+    void put(SSL_SESSION *session);
+    [[nodiscard]] SessionPtr take(std::string_view host);
+};
+
+// Writes the ClientHello and data as TLS 1.3 early data.
+// Must be called on a fresh connection after SSL_set_session, before the handshake.
+// Returns the records that need to be sent on the underlying socket.
+// If not all of data could be written, the handshake is in an unknown state and ssl can't be used anymore.
+[[nodiscard]] std::optional<std::string> write_early_data(SSL *ssl, std::string_view data);
+
+} // namespace s3cpp::aws::s3::_internal
@@ -0,0 +1,140 @@
+#include "transport_context.hpp"
+
+#include "bucket_router.hpp"
+#include "connection_pool.hpp"
+#include "s3cpp/aws/iam/session.hpp"
+#include "s3cpp/aws/s3/session.hpp"
+#include "s3cpp/meta.hpp"
+#include "tls_session_cache.hpp"
+
+#include <atomic>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/co_spawn.hpp> // IWYU pragma: keep
+#include <boost/asio/error.hpp>
+#include <boost/asio/ssl/error.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/system/error_code.hpp>   // IWYU pragma: keep
+#include <boost/system/system_error.hpp> // IWYU pragma: keep
+#include <format>
+#include <memory>
+#include <mutex>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <openssl/x509_vfy.h>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+
+namespace s3cpp::aws::s3::_internal {
+
+namespace {
+
+struct StoreDeleter {
+    void operator()(X509_STORE *store) const { X509_STORE_free(store); }
+};
+
+std::atomic<bool> ca_store_loaded = false;
+
+// parsing the system bundle takes milliseconds, and the store is safe to share between SSL_CTXs and threads
+[[nodiscard]] X509_STORE *ca_store() {
+    static const std::unique_ptr<X509_STORE, StoreDeleter> store = [] {
+        std::unique_ptr<X509_STORE, StoreDeleter> ret{X509_STORE_new()};
+        if (ret == nullptr || X509_STORE_set_default_paths(ret.get()) != 1) {
+            throw boost::system::system_error{boost::system::error_code{
+                static_cast<int>(::ERR_get_error()), boost::asio::error::get_ssl_category()}};
+        }
+        ca_store_loaded = true;
+        return ret;
+    }();
+    return store.get();
+}
+
+[[nodiscard]] meta::crt<boost::asio::awaitable<void>> load_ca_store() {
+    std::ignore = ca_store();
+    co_return;
+}
+
+// the options that end up in the context, credentials and per-request behavior are left out
+[[nodiscard]] std::string context_key(const iam::Session &session, const SessionOptions &options) {
+    const auto &transport = options.transport;
+    const auto &pool = options.connection_pool;
+    const auto &tls = options.tls;
+    const auto &dns = options.dns;
+    const auto &load_balancing = options.load_balancing;
+
+    std::string ret = std::format("{} {} {}", std::string_view{session.endpoint.buffer()}, session.region,
+                                  static_cast<int>(options.addressing));
+    ret += std::format(" {} {} {} {} {} {} {} {} {}", transport.no_delay,
+                       transport.send_buffer_size.value_or(0), transport.receive_buffer_size.value_or(0),
+                       transport.keep_alive, transport.keep_alive_idle.count(),
+                       transport.keep_alive_interval.count(), transport.keep_alive_count, transport.fast_open,
+                       transport.local_address ? transport.local_address->to_string() : "");
+    ret += std::format(" {} {} {}", pool.max_idle_per_host, pool.max_total_per_host,
+                       pool.idle_timeout.count());
+    for (const double weight : pool.priority_weights) {
+        ret += std::format(" {}", weight);
+    }
+    ret += std::format(" {} {} {}", tls.session_resumption, tls.kernel_tls,
+                       tls.session_cache_file ? tls.session_cache_file->string() : "");
+    ret += std::format(" {} {} {} {}", dns.ttl.count(), dns.max_stale.count(), dns.min_retry_backoff.count(),
+                       dns.max_retry_backoff.count());
+    ret += std::format(" {} {} {} {} {}", load_balancing.ewma_alpha, load_balancing.max_error_rate,
+                       load_balancing.max_latency_factor, load_balancing.min_samples,
+                       load_balancing.ejection_time.count());
+    for (const auto &gateway : load_balancing.gateways) {
+        ret += std::format(" {}", std::string_view{gateway.buffer()});
+    }
+    return ret;
+}
+
+} // namespace
+
+TransportContext::TransportContext(const iam::Session &session, const SessionOptions &options)
+    : bucket_router{std::make_shared<BucketRouter>(session.endpoint, session.region, options.addressing,
+                                                   options.load_balancing, options.dns)},
+      connection_pool{std::make_shared<ConnectionPool>(options.connection_pool)} {
+    X509_STORE *const store = ca_store();
+    // SSL_CTX_set_cert_store takes over a reference
+    X509_STORE_up_ref(store);
+    SSL_CTX_set_cert_store(ssl_ctx.native_handle(), store);
+    if (options.tls.kernel_tls) {
+        // only takes effect on KtlsStream, asio's stream never lets OpenSSL near the socket
+        SSL_CTX_set_options(ssl_ctx.native_handle(), SSL_OP_ENABLE_KTLS);
+    }
+    if (options.tls.session_resumption) {
+        tls_sessions = TlsSessionCache::attach(ssl_ctx.native_handle(), options.tls.session_cache_file);
+    }
+}
+
+std::shared_ptr<TransportContext> TransportContext::acquire(const iam::Session &session,
+                                                            const SessionOptions &options) {
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::weak_ptr<TransportContext>> contexts;
+
+    if (!options.transport.shared) {
+        return std::make_shared<TransportContext>(session, options);
+    }
+    const std::string key = context_key(session, options);
+    const std::scoped_lock lock{mutex};
+    std::erase_if(contexts, [](const auto &entry) { return entry.second.expired(); });
+    auto &entry = contexts[key];
+    if (auto ret = entry.lock(); ret != nullptr) {
+        return ret;
+    }
+    auto ret = std::make_shared<TransportContext>(session, options);
+    entry = ret;
+    return ret;
+}
+
+meta::crt<boost::asio::awaitable<void>> TransportContext::preload() {
+    if (ca_store_loaded) {
+        co_return;
+    }
+    // everyone waits for the same store, one thread is plenty
+    static boost::asio::thread_pool loader{1};
+    co_await boost::asio::co_spawn(loader, load_ca_store(), boost::asio::use_awaitable);
+}
+
+} // namespace s3cpp::aws::s3::_internal
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "bucket_router.hpp"
+#include "connection_pool.hpp"
+#include "s3cpp/aws/iam/session.hpp"
+#include "s3cpp/aws/s3/session.hpp"
+#include "s3cpp/meta.hpp"
+#include "tls_session_cache.hpp"
+
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/ssl/context.hpp>
+#include <memory>
+
+namespace s3cpp::aws::s3::_internal {
+
+// Everything a Session needs to talk to its endpoint that doesn't depend on the credentials.
+// Sessions with the same endpoint, region and transport related options share one context, and with it
+// the SSL_CTX, TLS session tickets, DNS caches, learned bucket regions and connection pools. Contexts live
+// as long as a Session uses them.
+// All SSL_CTXs of the process share one CA store, which is only parsed once.
+struct TransportContext {
+    boost::asio::ssl::context ssl_ctx{boost::asio::ssl::context::tls_client};
+    std::shared_ptr<TlsSessionCache> tls_sessions;
+    std::shared_ptr<BucketRouter> bucket_router;
+    std::shared_ptr<ConnectionPool> connection_pool;
+
+    [[nodiscard]] TransportContext(const iam::Session &session, const SessionOptions &options);
+
+    // the shared context for session and options, created if there is none yet or sharing is turned off
+    // blocks on loading the CA store unless preload has completed
+    [[nodiscard]] static std::shared_ptr<TransportContext> acquire(const iam::Session &session,
+                                                                   const SessionOptions &options);
+
+    // loads the CA store on a background thread
+    [[nodiscard]] static meta::crt<boost::asio::awaitable<void>> preload();
+};
+
+} // namespace s3cpp::aws::s3::_internal
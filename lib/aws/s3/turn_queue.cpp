@@ -0,0 +1,64 @@
+#include "turn_queue.hpp"
+
+#include "s3cpp/aws/s3/session.hpp"
+#include "s3cpp/meta.hpp"
+
+#include <array>
+#include <boost/asio/as_tuple.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/this_coro.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/system/error_code.hpp>
+#include <memory>
+#include <mutex>
+
+namespace s3cpp::aws::s3::_internal {
+
+namespace {
+
+constexpr auto token = boost::asio::as_tuple(boost::asio::use_awaitable);
+
+} // namespace
+
+TurnQueue::TurnQueue(const std::array<double, priority_count> &weights) : waiters_{weights} {}
+
+void TurnQueue::pass_on() {
+    if (auto waiter = waiters_.pop(); waiter.has_value()) {
+        waiter.value()->try_send(boost::system::error_code{});
+        return;
+    }
+    taken_ = false;
+}
+
+meta::crt<boost::asio::awaitable<boost::system::error_code>> TurnQueue::acquire(Priority priority) {
+    const auto executor = co_await boost::asio::this_coro::executor;
+    std::shared_ptr<Waiter> waiter;
+    {
+        const std::scoped_lock lock{mutex_};
+        if (!taken_) {
+            taken_ = true;
+        } else {
+            waiter = std::make_shared<Waiter>(executor, 1);
+            waiters_.push(priority, waiter);
+        }
+    }
+    if (waiter == nullptr) {
+        co_return boost::system::error_code{};
+    }
+    const auto [wait_ec] = co_await waiter->async_receive(token);
+    if (wait_ec.failed()) {
+        const std::scoped_lock lock{mutex_};
+        // if the turn was handed to us already, hand it on
+        if (!waiters_.erase(waiter)) {
+            pass_on();
+        }
+    }
+    co_return wait_ec;
+}
+
+void TurnQueue::release() {
+    const std::scoped_lock lock{mutex_};
+    pass_on();
+}
+
+} // namespace s3cpp::aws::s3::_internal
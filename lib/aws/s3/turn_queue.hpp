@@ -0,0 +1,38 @@
+#pragma once
+
+#include "fair_queue.hpp"
+#include "s3cpp/aws/s3/session.hpp"
+#include "s3cpp/meta.hpp"
+
+#include <array>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/experimental/concurrent_channel.hpp>
+#include <boost/system/error_code.hpp> // IWYU pragma: keep
+#include <memory>
+#include <mutex>
+
+namespace s3cpp::aws::s3::_internal {
+
+// Lets one caller at a time take tokens from a rate limiter, the others wait in a FairQueue by priority.
+// The caller holding the turn keeps it until it has slept off its own debt, so whoever reserves next is
+// picked by priority instead of by who came first.
+class TurnQueue {
+private:
+    using Waiter = boost::asio::experimental::concurrent_channel<void(boost::system::error_code)>;
+
+    std::mutex mutex_;
+    bool taken_ = false;
+    FairQueue<std::shared_ptr<Waiter>> waiters_;
+
+    // hands the turn to the waiter whose turn it is, or frees it
+    void pass_on();
+
+public:
+    [[nodiscard]] explicit TurnQueue(const std::array<double, priority_count> &weights);
+
+    // fails only if cancelled while waiting, the turn must not be released then
+    [[nodiscard]] meta::crt<boost::asio::awaitable<boost::system::error_code>> acquire(Priority priority);
+    void release();
+};
+
+} // namespace s3cpp::aws::s3::_internal
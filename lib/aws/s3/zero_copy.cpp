@@ -0,0 +1,258 @@
+#include "zero_copy.hpp"
+
+#include "io_loop.hpp"
+#include "ktls_stream.hpp"
+#include "session_extra.hpp"
+
+#include <algorithm>
+#include <array>
+#include <boost/asio/as_tuple.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/beast/core/stream_traits.hpp>
+#include <boost/system/errc.hpp>             // IWYU pragma: keep
+#include <boost/system/error_code.hpp>       // IWYU pragma: keep
+#include <boost/system/generic_category.hpp> // IWYU pragma: keep
+#include <boost/system/system_category.hpp>  // IWYU pragma: keep
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fcntl.h>
+#include <openssl/ssl.h>
+#include <span>
+#include <sys/sendfile.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <utility>
+#include <variant>
+
+namespace s3cpp::aws::s3::_internal {
+
+namespace {
+
+constexpr auto token = boost::asio::as_tuple(boost::asio::use_awaitable);
+
+constexpr int pipe_size = 1 << 20;
+
+[[nodiscard]] boost::system::error_code last_error() {
+    return boost::system::error_code{errno, boost::system::system_category()};
+}
+
+[[nodiscard]] bool is_unsupported(int error) {
+    return error == EINVAL || error == ENOSYS || error == EOPNOTSUPP;
+}
+
+[[nodiscard]] boost::asio::ip::tcp::socket &get_socket(Stream &stream) {
+    return std::visit(
+        [](auto &stream_) -> boost::asio::ip::tcp::socket & {
+            return boost::beast::get_lowest_layer(stream_).socket();
+        },
+        stream);
+}
+
+// sendfile and splice block on a blocking socket, whatever the flags say. asio's epoll reactor happens to
+// leave its sockets non-blocking, the io_uring one doesn't, so this is set explicitly.
+[[nodiscard]] boost::system::error_code make_non_blocking(boost::asio::ip::tcp::socket &socket) {
+    boost::system::error_code ec;
+    if (!socket.non_blocking()) {
+        // NOLINTNEXTLINE(bugprone-unused-return-value)
+        socket.non_blocking(true, ec);
+    }
+    return ec;
+}
+
+class Pipe {
+private:
+    std::array<int, 2> fds_{-1, -1};
+
+public:
+    [[nodiscard]] Pipe() = default;
+    ~Pipe() {
+        for (const int fd : fds_) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+    }
+
+    Pipe(const Pipe &) = delete;
+    Pipe &operator=(const Pipe &) = delete;
+    [[nodiscard]] Pipe(Pipe &&other) noexcept : fds_{std::exchange(other.fds_, {-1, -1})} {}
+    Pipe &operator=(Pipe &&other) = delete;
+
+    [[nodiscard]] boost::system::error_code open() {
+        if (fds_[0] >= 0) {
+            return {};
+        }
+        if (::pipe2(fds_.data(), O_NONBLOCK | O_CLOEXEC) != 0) {
+            return last_error();
+        }
+        // fewer round trips for large bodies, the default is only 64KiB
+        ::fcntl(fds_[1], F_SETPIPE_SZ, pipe_size);
+        return {};
+    }
+
+    [[nodiscard]] int read_end() const { return fds_[0]; }
+    [[nodiscard]] int write_end() const { return fds_[1]; }
+};
+
+// for destinations that don't support splice, e.g. files opened with O_APPEND
+[[nodiscard]] boost::system::error_code drain(int pipe_fd, int fd, std::uint64_t offset, std::size_t size) {
+    std::array<std::byte, 16384> buffer{};
+    while (size > 0) {
+        const auto n = ::read(pipe_fd, buffer.data(), std::min(size, buffer.size()));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return last_error();
+        }
+        const auto read_n = static_cast<std::size_t>(n);
+        if (const auto ec = pwrite_all(fd, std::span{buffer}.first(read_n), offset); ec.failed()) {
+            return ec;
+        }
+        offset += read_n;
+        size -= read_n;
+    }
+    return {};
+}
+
+} // namespace
+
+bool can_send_file(Stream &stream) {
+    if (stream.index() == 2) {
+        return std::get<2>(stream).is_ktls_send();
+    }
+    return stream.index() == 0;
+}
+
+bool can_receive_file(Stream &stream) {
+    if (stream.index() == 2) {
+        auto &ktls_stream = std::get<2>(stream);
+        return ktls_stream.is_ktls_recv() && SSL_has_pending(ktls_stream.native_handle()) == 0;
+    }
+    return stream.index() == 0;
+}
+
+transfer_awaitable async_send_file(Stream &stream, int fd, std::uint64_t offset, std::size_t size,
+                                   std::chrono::steady_clock::time_point deadline) {
+    auto &socket = get_socket(stream);
+    // with kTLS, sendfile on the socket is exactly what SSL_sendfile does
+    auto step = [&socket, fd, offset, size, sent = std::size_t{0}]() mutable -> Progress {
+        if (const auto ec = make_non_blocking(socket); ec.failed()) {
+            return {.ec = ec};
+        }
+        while (sent < size) {
+            auto file_offset = static_cast<off_t>(offset + sent);
+            const auto n = ::sendfile(socket.native_handle(), fd, &file_offset, size - sent);
+            if (n > 0) {
+                sent += static_cast<std::size_t>(n);
+                continue;
+            }
+            if (n == 0) {
+                // the file is shorter than announced
+                return {.ec = boost::asio::error::eof, .n = sent};
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return {.want = Want::WRITE, .n = sent};
+            }
+            if (is_unsupported(errno)) {
+                return {.ec = boost::asio::error::operation_not_supported, .n = sent};
+            }
+            return {.ec = last_error(), .n = sent};
+        }
+        return {.n = sent};
+    };
+    return async_io_loop<void(boost::system::error_code, std::size_t)>(socket, deadline, std::move(step),
+                                                                        token);
+}
+
+transfer_awaitable async_receive_file(Stream &stream, int fd, std::uint64_t offset, std::size_t size,
+                                      std::chrono::steady_clock::time_point deadline) {
+    auto &socket = get_socket(stream);
+    const bool is_tls = stream.index() != 0;
+    // socket -> pipe -> file, the pipe is always drained before reading from the socket again
+    auto step = [&socket, fd, offset, size, is_tls, pipe = Pipe{}, in_pipe = std::size_t{0},
+                 moved = std::size_t{0}]() mutable -> Progress {
+        if (const auto ec = pipe.open(); ec.failed()) {
+            return {.ec = ec};
+        }
+        if (const auto ec = make_non_blocking(socket); ec.failed()) {
+            return {.ec = ec};
+        }
+        while (moved < size) {
+            if (in_pipe == 0) {
+                const auto n = ::splice(socket.native_handle(), nullptr, pipe.write_end(), nullptr,
+                                        std::min(size - moved, static_cast<std::size_t>(pipe_size)),
+                                        SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+                if (n == 0) {
+                    return {.ec = boost::asio::error::eof, .n = moved};
+                }
+                if (n < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                        return {.want = Want::READ, .n = moved};
+                    }
+                    // kTLS refuses to splice anything but application data, e.g. a key update,
+                    // the record stays queued so that OpenSSL can deal with it
+                    if (is_tls && errno == EINVAL) {
+                        return {.ec = boost::asio::error::operation_not_supported, .n = moved};
+                    }
+                    return {.ec = last_error(), .n = moved};
+                }
+                in_pipe = static_cast<std::size_t>(n);
+            }
+            while (in_pipe > 0) {
+                auto file_offset = static_cast<loff_t>(offset + moved);
+                const auto n = ::splice(pipe.read_end(), nullptr, fd, &file_offset, in_pipe, SPLICE_F_MOVE);
+                if (n > 0) {
+                    in_pipe -= static_cast<std::size_t>(n);
+                    moved += static_cast<std::size_t>(n);
+                    continue;
+                }
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n < 0 && !is_unsupported(errno)) {
+                    return {.ec = last_error(), .n = moved};
+                }
+                if (const auto ec = drain(pipe.read_end(), fd, offset + moved, in_pipe); ec.failed()) {
+                    return {.ec = ec, .n = moved};
+                }
+                moved += std::exchange(in_pipe, 0);
+                return {.ec = boost::asio::error::operation_not_supported, .n = moved};
+            }
+        }
+        return {.n = moved};
+    };
+    return async_io_loop<void(boost::system::error_code, std::size_t)>(socket, deadline, std::move(step),
+                                                                        token);
+}
+
+boost::system::error_code pwrite_all(int fd, std::span<const std::byte> data, std::uint64_t offset) {
+    while (!data.empty()) {
+        const auto n = ::pwrite(fd, data.data(), data.size(), static_cast<off_t>(offset));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return last_error();
+        }
+        if (n == 0) {
+            return boost::system::error_code{boost::system::errc::io_error,
+                                             boost::system::generic_category()};
+        }
+        data = data.subspan(static_cast<std::size_t>(n));
+        offset += static_cast<std::uint64_t>(n);
+    }
+    return {};
+}
+
+} // namespace s3cpp::aws::s3::_internal
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "session_extra.hpp"
+
+#include <boost/asio/awaitable.hpp>
+#include <boost/system/error_code.hpp> // IWYU pragma: keep
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <tuple>
+
+namespace s3cpp::aws::s3::_internal {
+
+// Moves data between files and connections without copying it through user space.
+// This works on plain TCP connections, and on TLS connections once the kernel has taken over the record
+// layer. Whenever the kernel refuses, the operations stop with operation_not_supported after moving what
+// they could, and the caller continues with regular reads and writes.
+
+// largest amount of data moved per operation, the deadline applies to each of them
+constexpr std::size_t zero_copy_chunk = std::size_t{64} << 20;
+
+using transfer_awaitable = boost::asio::awaitable<std::tuple<boost::system::error_code, std::size_t>>;
+
+[[nodiscard]] bool can_send_file(Stream &stream);
+// also requires that OpenSSL doesn't hold on to any received data
+[[nodiscard]] bool can_receive_file(Stream &stream);
+
+// sends size bytes of fd starting at offset, with sendfile
+[[nodiscard]] transfer_awaitable async_send_file(Stream &stream, int fd, std::uint64_t offset,
+                                                 std::size_t size,
+                                                 std::chrono::steady_clock::time_point deadline);
+
+// receives size bytes into fd starting at offset, with splice
+[[nodiscard]] transfer_awaitable async_receive_file(Stream &stream, int fd, std::uint64_t offset,
+                                                    std::size_t size,
+                                                    std::chrono::steady_clock::time_point deadline);
+
+[[nodiscard]] boost::system::error_code pwrite_all(int fd, std::span<const std::byte> data,
+                                                   std::uint64_t offset);
+
+} // namespace s3cpp::aws::s3::_internal
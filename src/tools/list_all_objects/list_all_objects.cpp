@@ -1,4 +1,5 @@
 #include "misc.hpp"
+#include "runtime.hpp"
 #include "s3cpp/aws/iam/session.hpp"
 #include "s3cpp/aws/s3/client.hpp"
 #include "s3cpp/aws/s3/session.hpp"
@@ -10,8 +11,9 @@
 #include <boost/accumulators/statistics/rolling_window.hpp>
 #include <boost/accumulators/statistics/stats.hpp>
 #include <boost/algorithm/string/trim.hpp>
+#include <boost/asio/co_spawn.hpp>
 #include <boost/asio/posix/stream_descriptor.hpp>
-#include <boost/asio/thread_pool.hpp>
+#include <boost/asio/use_future.hpp>
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/parsers.hpp>
 #include <boost/program_options/value_semantic.hpp>
@@ -34,6 +36,7 @@
 #include <string>
 #include <thread>
 #include <utility>
+#include <vector>
 
 using namespace s3cpp::tools::list_all_objects;
 
@@ -46,9 +49,26 @@ namespace {
     return buffer.str();
 }
 
+// "<requests/s> [<bytes/s>]", a missing file or 0 lifts the limit
+[[nodiscard]] s3cpp::aws::s3::RateLimit read_rate_limit(const std::filesystem::path &path) {
+    s3cpp::aws::s3::RateLimit ret;
+    std::ifstream stream{path};
+    double requests = 0;
+    double bytes = 0;
+    if (stream >> requests && requests > 0) {
+        ret.requests_per_second = requests;
+    }
+    if (stream >> bytes && bytes > 0) {
+        ret.bytes_per_second = bytes;
+    }
+    return ret;
+}
+
 struct Options {
     std::string bucket;
     std::string endpoint;
+    std::string region;
+    s3cpp::aws::s3::AddressingStyle addressing{};
     std::string access_key;
     std::string secret_key;
     std::string output_file;
@@ -58,6 +78,9 @@ struct Options {
     double scale_up_factor{};
     double scale_down_factor{};
     std::size_t scaling_interval_seconds{};
+    std::size_t warm_up_connections{};
+    bool thread_per_core{};
+    std::string rate_limit_file;
 };
 
 [[nodiscard]] Options parse_opts(int argc, char **argv) {
@@ -70,6 +93,8 @@ struct Options {
         ("help,h", "print this help")
         ("bucket,b",  boost::program_options::value<std::string>(&ret.bucket)->required(), "S3 bucket name")
         ("endpoint,e",  boost::program_options::value<std::string>(&ret.endpoint)->required(), "endpoint URL, including protocol and (if required) port")
+        ("region", boost::program_options::value<std::string>(&ret.region)->default_value("default"), "region to sign requests for, buckets in other regions are followed automatically")
+        ("addressing", boost::program_options::value<std::string>()->default_value("path"), "bucket addressing style (path or virtual)")
         ("access-key-file", boost::program_options::value<std::string>(&ret.access_key)->required(), "path to access key file")
         ("secret-access-key-file", boost::program_options::value<std::string>(&ret.secret_key)->required(), "path to secret key file")
         ("output-file,o", boost::program_options::value<std::string>(&ret.output_file)->required(), "path to output file")
@@ -78,6 +103,9 @@ struct Options {
         ("scale-up-factor", boost::program_options::value<double>(&ret.scale_up_factor)->default_value(1.2), "multiply workers by this factor when scaling up")
         ("scale-down-factor", boost::program_options::value<double>(&ret.scale_down_factor)->default_value(0.8), "multiply workers by this factor when scaling down")
         ("scaling-interval", boost::program_options::value<std::size_t>(&ret.scaling_interval_seconds)->default_value(1), "scaling check interval in seconds")
+        ("warm-up", boost::program_options::value<std::size_t>(&ret.warm_up_connections)->default_value(0), "connections to open before starting")
+        ("thread-per-core", boost::program_options::bool_switch(&ret.thread_per_core), "run one pinned event loop with its own connections per CPU instead of a shared thread pool")
+        ("rate-limit-file", boost::program_options::value<std::string>(&ret.rate_limit_file), "file containing \"<requests/s> [<bytes/s>]\", re-read every second so that a running listing can be throttled")
     ;
     // clang-format on
 
@@ -101,6 +129,17 @@ struct Options {
         exit(1);
     }
 
+    const std::string addressing_str = varmap["addressing"].as<std::string>();
+    if (addressing_str == "path") {
+        ret.addressing = s3cpp::aws::s3::AddressingStyle::PATH;
+    } else if (addressing_str == "virtual") {
+        ret.addressing = s3cpp::aws::s3::AddressingStyle::VIRTUAL_HOSTED;
+    } else {
+        std::println(std::cerr, "Invalid addressing style '{}'. Must be 'path' or 'virtual'.",
+                     addressing_str);
+        exit(1);
+    }
+
     const std::string output_format_str = varmap["format"].as<std::string>();
     if (output_format_str == "plain") {
         ret.output_format = s3cpp::tools::list_all_objects::OutputFormat::PLAIN;
@@ -125,12 +164,46 @@ struct Options {
 int main(int argc, char **argv) {
     const Options options = parse_opts(argc, argv);
 
-    const auto session = std::make_shared<s3cpp::aws::s3::Session>(
-        s3cpp::aws::iam::Session{.access_key = options.access_key,
-                                 .secret_access_key = options.secret_key,
-                                 .region = "default",
-                                 .endpoint = boost::urls::url{options.endpoint}});
-    const s3cpp::aws::s3::Client client{session};
+    auto runtime = options.thread_per_core ? Runtime::thread_per_core()
+                                           : Runtime::thread_pool(std::thread::hardware_concurrency());
+
+    const s3cpp::aws::iam::Session credentials{.access_key = options.access_key,
+                                               .secret_access_key = options.secret_key,
+                                               .region = options.region,
+                                               .endpoint = boost::urls::url{options.endpoint}};
+    s3cpp::aws::s3::SessionOptions session_options{.addressing = options.addressing};
+    // shards don't share connections, TLS state or DNS caches, so that no two cores touch the same ones
+    session_options.transport.shared = !options.thread_per_core;
+
+    const std::string bucket_path = "/" + options.bucket;
+    std::vector<s3cpp::aws::s3::Client> clients;
+    std::size_t warmed_up = 0;
+    for (std::size_t shard = 0; shard < runtime->size(); shard++) {
+        // created on the shard's own thread, so that its memory is local to the shard's NUMA node
+        const auto session =
+            boost::asio::co_spawn(runtime->executor(shard),
+                                  s3cpp::aws::s3::Session::create(credentials, session_options),
+                                  boost::asio::use_future)
+                .get();
+        // connections belong to the executor they were opened on, so each shard warms up its own
+        const std::size_t connections = (options.warm_up_connections + runtime->size() - 1) / runtime->size();
+        if (connections > 0) {
+            const auto warm_up_res =
+                boost::asio::co_spawn(runtime->executor(shard), session->warm_up(connections, bucket_path),
+                                      boost::asio::use_future)
+                    .get();
+            if (!warm_up_res) {
+                std::println(std::cerr, "failed to warm up connections: {}", warm_up_res.error().message());
+                return 1;
+            }
+            warmed_up += warm_up_res.value();
+        }
+        clients.emplace_back(session);
+    }
+    if (warmed_up > 0) {
+        std::println("opened {} connections", warmed_up);
+    }
+
     const auto metrics = std::make_shared<Metrics>();
 
     // Create worker scaling configuration from command line options
@@ -165,6 +238,17 @@ int main(int argc, char **argv) {
         }
     }};
 
+    const std::jthread rate_limit_thread{[&options](const std::stop_token &token) {
+        if (options.rate_limit_file.empty()) {
+            return;
+        }
+        // the global level covers all shards
+        while (!token.stop_requested()) {
+            s3cpp::aws::s3::Session::set_global_rate_limit(read_rate_limit(options.rate_limit_file));
+            std::this_thread::sleep_for(std::chrono::seconds{1});
+        }
+    }};
+
     // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg)
     const auto output_file_fd = open(options.output_file.c_str(), O_CREAT | O_TRUNC | O_WRONLY | O_CLOEXEC,
                                      S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
@@ -173,13 +257,12 @@ int main(int argc, char **argv) {
         return 1;
     }
 
-    auto pool = std::make_unique<boost::asio::thread_pool>(std::thread::hardware_concurrency());
-    boost::asio::posix::stream_descriptor output_file_stream{*pool, output_file_fd};
-    const WorkerManager worker_manager{client,
+    boost::asio::posix::stream_descriptor output_file_stream{runtime->executor(0), output_file_fd};
+    const WorkerManager worker_manager{std::move(clients),
                                        options.bucket,
                                        metrics,
                                        std::move(output_file_stream),
-                                       std::move(pool),
+                                       std::move(runtime),
                                        scaling_config,
                                        options.api_version,
                                        options.output_format};
@@ -8,6 +8,8 @@
 #include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <queue>
 #include <vector>
 
@@ -27,6 +29,12 @@ struct PrefixQueueEntry {
 };
 using PrefixQueue = std::priority_queue<PrefixQueueEntry, std::vector<PrefixQueueEntry>, std::greater<>>;
 
+// one per shard, prefixes discovered on a shard are queued on it
+struct SharedPrefixQueue {
+    std::shared_ptr<PrefixQueue> queue = std::make_shared<PrefixQueue>();
+    std::shared_ptr<std::mutex> mutex = std::make_shared<std::mutex>();
+};
+
 struct Metrics {
     std::atomic<std::size_t> total_ops;
     std::atomic<std::size_t> total_queue_length;
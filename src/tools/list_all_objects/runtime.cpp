@@ -0,0 +1,81 @@
+#include "runtime.hpp"
+
+#include <algorithm>
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <print>
+#include <pthread.h>
+#include <sched.h>
+#include <thread>
+
+namespace s3cpp::tools::list_all_objects {
+
+std::unique_ptr<Runtime> Runtime::thread_pool(std::size_t threads) {
+    std::unique_ptr<Runtime> ret{new Runtime{}};
+    ret->pool = std::make_unique<boost::asio::thread_pool>(threads);
+    return ret;
+}
+
+std::unique_ptr<Runtime> Runtime::thread_per_core() {
+    std::unique_ptr<Runtime> ret{new Runtime{}};
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    if (sched_getaffinity(0, sizeof(cpus), &cpus) != 0) {
+        // we can't know where we are allowed to run, so don't pin
+        for (unsigned int cpu = 0; cpu < std::max(std::thread::hardware_concurrency(), 1U); cpu++) {
+            ret->shards.push_back(std::make_unique<Shard>(-1));
+        }
+    } else {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &cpus)) {
+                ret->shards.push_back(std::make_unique<Shard>(cpu));
+            }
+        }
+    }
+
+    for (const auto &shard : ret->shards) {
+        shard->thread = std::thread{[&shard = *shard]() {
+            if (shard.cpu >= 0) {
+                cpu_set_t cpu;
+                CPU_ZERO(&cpu);
+                CPU_SET(shard.cpu, &cpu);
+                if (const int error = pthread_setaffinity_np(pthread_self(), sizeof(cpu), &cpu); error != 0) {
+                    std::println(std::cerr, "WARN failed to pin shard to cpu {}: {}", shard.cpu,
+                                 strerror(error));
+                }
+            }
+            shard.io_context.run();
+        }};
+    }
+    return ret;
+}
+
+Runtime::~Runtime() { join(); }
+
+std::size_t Runtime::size() const { return pool != nullptr ? 1 : shards.size(); }
+
+boost::asio::any_io_executor Runtime::executor(std::size_t shard) const {
+    if (pool != nullptr) {
+        return pool->get_executor();
+    }
+    return shards.at(shard)->io_context.get_executor();
+}
+
+void Runtime::join() {
+    if (pool != nullptr) {
+        pool->join();
+    }
+    for (const auto &shard : shards) {
+        shard->work_guard.reset();
+        if (shard->thread.joinable()) {
+            shard->thread.join();
+        }
+    }
+}
+
+} // namespace s3cpp::tools::list_all_objects
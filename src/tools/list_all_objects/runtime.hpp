@@ -0,0 +1,51 @@
+#pragma once
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace s3cpp::tools::list_all_objects {
+
+// Where the workers run.
+// Either one thread pool that every coroutine may hop around on, or one single threaded io_context per
+// CPU (a shard), run by a thread pinned to that CPU. Coroutines spawned on a shard never leave it.
+class Runtime {
+private:
+    struct Shard {
+        int cpu;
+        boost::asio::io_context io_context{1};
+        boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work_guard{
+            io_context.get_executor()};
+        std::thread thread;
+    };
+
+    std::unique_ptr<boost::asio::thread_pool> pool;
+    std::vector<std::unique_ptr<Shard>> shards;
+
+    [[nodiscard]] Runtime() = default;
+
+public:
+    [[nodiscard]] static std::unique_ptr<Runtime> thread_pool(std::size_t threads);
+    // one shard per CPU this process may run on
+    [[nodiscard]] static std::unique_ptr<Runtime> thread_per_core();
+    ~Runtime();
+
+    Runtime(const Runtime &) = delete;
+    Runtime &operator=(const Runtime &) = delete;
+    Runtime(Runtime &&) = delete;
+    Runtime &operator=(Runtime &&) = delete;
+
+    // 1 for the thread pool
+    [[nodiscard]] std::size_t size() const;
+    [[nodiscard]] boost::asio::any_io_executor executor(std::size_t shard) const;
+
+    // waits for all spawned work to finish
+    void join();
+};
+
+} // namespace s3cpp::tools::list_all_objects
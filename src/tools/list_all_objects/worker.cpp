@@ -6,9 +6,6 @@
 #include "s3cpp/meta.hpp"
 
 #include <boost/asio/awaitable.hpp>
-#include <boost/asio/steady_timer.hpp>
-#include <boost/asio/this_coro.hpp>
-#include <boost/asio/use_awaitable.hpp>
 #include <boost/beast/core/error.hpp>
 #include <boost/describe/members.hpp>
 #include <boost/describe/modifiers.hpp>
@@ -90,31 +87,26 @@ list_one_impl(s3cpp::aws::s3::Client client, std::string bucket, std::optional<s
             return std::format("pugixml error {}", std::to_underlying(error));
         }
     };
-    constexpr int max_retries = 5;
-    for (int retries = 1; retries <= max_retries; retries++) {
-        std::string errstr;
-        if constexpr (api_version == s3cpp::tools::list_all_objects::ListObjectsApiVersion::V1) {
-            auto res = co_await client.list_objects(
-                {.Bucket = bucket, .Marker = continuation_token, .Delimiter = "/", .Prefix = prefix});
-            if (res) {
-                co_return res.value();
-            }
-            errstr = std::visit(Visitor{}, res.error());
-        } else {
-            auto res = co_await client.list_objects_v2({.Bucket = bucket,
-                                                        .ContinuationToken = continuation_token,
-                                                        .Delimiter = "/",
-                                                        .Prefix = prefix});
-            if (res) {
-                co_return res.value();
-            }
-            errstr = std::visit(Visitor{}, res.error());
+    // the session retries throttling and transient failures already, within its retry budget
+    std::string errstr;
+    if constexpr (api_version == s3cpp::tools::list_all_objects::ListObjectsApiVersion::V1) {
+        auto res = co_await client.list_objects(
+            {.Bucket = bucket, .Marker = continuation_token, .Delimiter = "/", .Prefix = prefix});
+        if (res) {
+            co_return res.value();
         }
-        std::println(std::cerr, "WARN in prefix {} {} - retry {}", my_prefix, errstr, retries);
-        boost::asio::steady_timer timer{co_await boost::asio::this_coro::executor, std::chrono::seconds{1}};
-        co_await timer.async_wait(boost::asio::use_awaitable);
+        errstr = std::visit(Visitor{}, res.error());
+    } else {
+        auto res = co_await client.list_objects_v2({.Bucket = bucket,
+                                                    .ContinuationToken = continuation_token,
+                                                    .Delimiter = "/",
+                                                    .Prefix = prefix});
+        if (res) {
+            co_return res.value();
+        }
+        errstr = std::visit(Visitor{}, res.error());
     }
-    std::println(std::cerr, "ERROR no success after {} retries on prefix {}", max_retries, my_prefix);
+    std::println(std::cerr, "ERROR in prefix {} {}", my_prefix, errstr);
     if constexpr (api_version == s3cpp::tools::list_all_objects::ListObjectsApiVersion::V1) {
         co_return s3cpp::aws::s3::ListObjectsResult{};
     } else {
@@ -142,27 +134,38 @@ namespace s3cpp::tools::list_all_objects {
 
 bool Worker::is_done() { return stats->total_queue_length == 0; }
 
-meta::crt<boost::asio::awaitable<std::optional<std::tuple<aws::s3::CommonPrefix, std::size_t>>>>
-Worker::get_next_prefix() {
-    const std::scoped_lock lock{*queue_mutex};
+std::optional<std::tuple<aws::s3::CommonPrefix, std::size_t>>
+Worker::take_prefix(const SharedPrefixQueue &shared) {
+    const std::scoped_lock lock{*shared.mutex};
     const PrefixQueueEntry *top{};
     while (true) {
         // someone took the last work element from the queue while we were waiting on the lock
-        if (prefix_queue->empty()) {
-            co_return std::nullopt;
+        if (shared.queue->empty()) {
+            return std::nullopt;
         }
-        const PrefixQueueEntry &maybe_top = prefix_queue->top();
+        const PrefixQueueEntry &maybe_top = shared.queue->top();
         if (maybe_top.paths.empty()) {
-            prefix_queue->pop();
+            shared.queue->pop();
         } else {
             top = &maybe_top;
             break;
         }
     }
-    const auto ret = std::make_tuple(std::move(top->paths.back()), top->depth);
+    auto ret = std::make_tuple(std::move(top->paths.back()), top->depth);
     top->paths.pop_back();
     stats->total_queue_length--;
-    co_return ret;
+    return ret;
+}
+
+meta::crt<boost::asio::awaitable<std::optional<std::tuple<aws::s3::CommonPrefix, std::size_t>>>>
+Worker::get_next_prefix() {
+    // work only moves to another shard when that shard has run dry, the subtree below then stays there
+    for (std::size_t i = 0; i < queues.size(); i++) {
+        if (auto ret = take_prefix(queues[(home + i) % queues.size()]); ret.has_value()) {
+            co_return ret;
+        }
+    }
+    co_return std::nullopt;
 }
 
 meta::crt<boost::asio::awaitable<std::variant<aws::s3::ListObjectsResult, aws::s3::ListObjectsV2Result>>>
@@ -218,7 +221,8 @@ meta::crt<boost::asio::awaitable<void>> Worker::process_prefix(aws::s3::CommonPr
         write_objects(contents.value_or(std::vector<aws::s3::Object>{}));
 
         {
-            const std::scoped_lock lock{*queue_mutex};
+            const SharedPrefixQueue &own = queues[home];
+            const std::scoped_lock lock{*own.mutex};
             stats->total_objects_found += contents.value_or(std::vector<aws::s3::Object>{}).size();
 
             // Only add queue entry if there are actual sub-prefixes to process
@@ -227,7 +231,7 @@ meta::crt<boost::asio::awaitable<void>> Worker::process_prefix(aws::s3::CommonPr
             auto prefixes = std::move(common_prefixes).value_or(std::vector<aws::s3::CommonPrefix>{});
             if (!prefixes.empty()) {
                 stats->total_queue_length += prefixes.size();
-                prefix_queue->emplace(depth + 1, std::move(prefixes));
+                own.queue->emplace(depth + 1, std::move(prefixes));
             }
 
             stats->total_ops++;
@@ -299,10 +303,10 @@ bool Worker::should_terminate_early() const {
 
 Worker::Worker(aws::s3::Client client, std::string bucket, std::shared_ptr<Metrics> stats,
                std::shared_ptr<boost::lockfree::stack<std::string>> write_stack,
-               std::shared_ptr<PrefixQueue> prefix_queue, std::shared_ptr<std::mutex> queue_mutex,
-               ListObjectsApiVersion api_version, OutputFormat output_format)
+               std::vector<SharedPrefixQueue> queues, std::size_t home, ListObjectsApiVersion api_version,
+               OutputFormat output_format)
     : client{std::move(client)}, bucket{std::move(bucket)}, stats{std::move(stats)},
-      write_stack{std::move(write_stack)}, api_version{api_version}, prefix_queue{std::move(prefix_queue)},
-      queue_mutex{std::move(queue_mutex)}, output_format{output_format} {}
+      write_stack{std::move(write_stack)}, api_version{api_version}, queues{std::move(queues)}, home{home},
+      output_format{output_format} {}
 
 } // namespace s3cpp::tools::list_all_objects
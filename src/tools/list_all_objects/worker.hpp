@@ -9,12 +9,12 @@
 #include <boost/lockfree/stack.hpp>
 #include <cstddef>
 #include <memory>
-#include <mutex>
 #include <optional>
 #include <span>
 #include <string>
 #include <tuple>
 #include <variant>
+#include <vector>
 
 namespace s3cpp::tools::list_all_objects {
 
@@ -26,13 +26,16 @@ private:
     std::shared_ptr<boost::lockfree::stack<std::string>> write_stack;
     ListObjectsApiVersion api_version;
 
-    // Shared queue and synchronization - references to WorkerManager's state
-    std::shared_ptr<PrefixQueue> prefix_queue;
-    std::shared_ptr<std::mutex> queue_mutex;
+    // Shared queues, one per shard - references to WorkerManager's state
+    std::vector<SharedPrefixQueue> queues;
+    // the shard this worker runs on
+    std::size_t home;
 
     OutputFormat output_format;
 
     [[nodiscard]] bool is_done();
+    [[nodiscard]] std::optional<std::tuple<aws::s3::CommonPrefix, std::size_t>>
+    take_prefix(const SharedPrefixQueue &shared);
     [[nodiscard]] meta::crt<
         boost::asio::awaitable<std::optional<std::tuple<aws::s3::CommonPrefix, std::size_t>>>>
     get_next_prefix();
@@ -48,7 +51,7 @@ private:
 public:
     [[nodiscard]] Worker(aws::s3::Client client, std::string bucket, std::shared_ptr<Metrics> stats,
                          std::shared_ptr<boost::lockfree::stack<std::string>> write_stack,
-                         std::shared_ptr<PrefixQueue> prefix_queue, std::shared_ptr<std::mutex> queue_mutex,
+                         std::vector<SharedPrefixQueue> queues, std::size_t home,
                          ListObjectsApiVersion api_version, OutputFormat output_format);
 
     [[nodiscard]] meta::crt<boost::asio::awaitable<void>> work();
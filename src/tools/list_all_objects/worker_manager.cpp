@@ -1,6 +1,7 @@
 #include "worker_manager.hpp"
 
 #include "misc.hpp"
+#include "runtime.hpp"
 #include "s3cpp/aws/s3/client.hpp"
 #include "s3cpp/meta.hpp"
 #include "worker.hpp"
@@ -22,7 +23,6 @@
 #include <boost/asio/posix/stream_descriptor.hpp>
 #include <boost/asio/steady_timer.hpp>
 #include <boost/asio/this_coro.hpp>
-#include <boost/asio/thread_pool.hpp>
 #include <boost/asio/use_awaitable.hpp>
 #include <boost/asio/write.hpp>
 #include <boost/lockfree/stack.hpp>
@@ -37,6 +37,7 @@
 #include <string>
 #include <thread>
 #include <utility>
+#include <vector>
 
 namespace {
 
@@ -74,25 +75,26 @@ writer_coroutine(boost::asio::posix::stream_descriptor output_file_stream,
 
 namespace s3cpp::tools::list_all_objects {
 
-WorkerManager::WorkerManager(s3cpp::aws::s3::Client client, std::string bucket,
+WorkerManager::WorkerManager(std::vector<s3cpp::aws::s3::Client> clients, std::string bucket,
                              std::shared_ptr<Metrics> metrics,
                              boost::asio::posix::stream_descriptor output_file_stream,
-                             std::unique_ptr<boost::asio::thread_pool> pool, WorkerScalingConfig config,
+                             std::unique_ptr<Runtime> runtime, WorkerScalingConfig config,
                              ListObjectsApiVersion api_version, OutputFormat output_format)
-    : client{std::move(client)}, bucket{std::move(bucket)}, metrics{std::move(metrics)},
-      pool{std::move(pool)}, config{config}, api_version{api_version}, output_format{output_format} {
-    // Initialize the shared queue with the root prefix (empty prefix)
+    : clients{std::move(clients)}, bucket{std::move(bucket)}, metrics{std::move(metrics)},
+      runtime{std::move(runtime)}, config{config}, api_version{api_version}, output_format{output_format},
+      shared_queues(this->runtime->size()) {
+    // Initialize the shared queue of the first shard with the root prefix (empty prefix)
     {
-        const std::scoped_lock lock{*shared_queue_mutex};
-        shared_prefix_queue->emplace(PrefixQueueEntry{.depth = 0, .paths = {{}}});
+        const std::scoped_lock lock{*shared_queues.front().mutex};
+        shared_queues.front().queue->emplace(PrefixQueueEntry{.depth = 0, .paths = {{}}});
         this->metrics->total_queue_length++;
     }
     this->metrics->target_workers = std::max(this->metrics->target_workers.load(), 1UL);
 
-    boost::asio::co_spawn(*this->pool, scaling_worker(scaling_cancellation_signal->slot()),
+    boost::asio::co_spawn(this->runtime->executor(0), scaling_worker(scaling_cancellation_signal->slot()),
                           boost::asio::detached);
     boost::asio::co_spawn(
-        *this->pool,
+        this->runtime->executor(0),
         writer_coroutine(std::move(output_file_stream), write_stack, writer_cancellation_signal->slot()),
         boost::asio::detached);
 }
@@ -102,36 +104,38 @@ WorkerManager::WorkerManager(s3cpp::aws::s3::Client client, std::string bucket,
 WorkerManager::~WorkerManager() {
     // Wait for all work to complete
     while (true) {
-        {
-            const std::scoped_lock lock{*shared_queue_mutex};
-
-            // Clean up empty entries like workers do in get_next_prefix()
-            while (!shared_prefix_queue->empty()) {
-                const auto &entry = shared_prefix_queue->top();
+        const bool done = metrics->total_queue_length == 0 && metrics->active_workers == 0;
+        for (const auto &shared : shared_queues) {
+            const std::scoped_lock lock{*shared.mutex};
+            auto &queue = *shared.queue;
+
+            // Clean up empty entries like workers do in take_prefix()
+            while (!queue.empty()) {
+                const auto &entry = queue.top();
                 if (entry.paths.empty()) {
-                    shared_prefix_queue->pop();
+                    queue.pop();
                 } else {
                     break;
                 }
             }
 
-            if (metrics->total_queue_length == 0 && metrics->active_workers == 0) {
-                // After cleanup, queue should be empty
-                if (!shared_prefix_queue->empty()) {
-                    std::print(std::cerr,
-                               "ERROR: prefix queue not empty but no active workers and zero queue length\n"
-                               "remaining prefixes:\n");
-                    while (!shared_prefix_queue->empty()) {
-                        const auto &entry = shared_prefix_queue->top();
-                        for (const auto &elem : entry.paths) {
-                            std::print(std::cerr, "  prefix: {}\n", elem.Prefix.value_or("<empty>"));
-                        }
-                        shared_prefix_queue->pop();
+            // After cleanup, queue should be empty
+            if (done && !queue.empty()) {
+                std::print(std::cerr,
+                           "ERROR: prefix queue not empty but no active workers and zero queue length\n"
+                           "remaining prefixes:\n");
+                while (!queue.empty()) {
+                    const auto &entry = queue.top();
+                    for (const auto &elem : entry.paths) {
+                        std::print(std::cerr, "  prefix: {}\n", elem.Prefix.value_or("<empty>"));
                     }
+                    queue.pop();
                 }
-                break;
             }
         }
+        if (done) {
+            break;
+        }
         std::this_thread::sleep_for(std::chrono::milliseconds{1000});
     }
 
@@ -139,7 +143,7 @@ WorkerManager::~WorkerManager() {
     scaling_cancellation_signal->emit(boost::asio::cancellation_type::total);
     writer_cancellation_signal->emit(boost::asio::cancellation_type::total);
 
-    pool->join();
+    runtime->join();
 }
 
 meta::crt<boost::asio::awaitable<void>>
@@ -189,7 +193,12 @@ WorkerManager::scaling_worker(boost::asio::cancellation_slot cancellation_slot)
             if (current_running < desired_workers) {
                 const std::size_t workers_to_spawn = desired_workers - current_running;
                 for (std::size_t i = 0; i < workers_to_spawn; i++) {
-                    boost::asio::co_spawn(*pool, spawn_worker(), boost::asio::detached);
+                    const std::size_t shard = next_shard++ % runtime->size();
+                    // the coroutine frame gets allocated on the shard's own thread
+                    boost::asio::co_spawn(
+                        runtime->executor(shard),
+                        [this, shard]() -> boost::asio::awaitable<void> { return spawn_worker(shard); },
+                        boost::asio::detached);
                 }
             }
         }
@@ -235,9 +244,9 @@ std::size_t WorkerManager::calculate_desired_workers(double current_ops_per_seco
     return desired_workers;
 }
 
-s3cpp::meta::crt<boost::asio::awaitable<void>> WorkerManager::spawn_worker() {
-    Worker worker{client,      bucket,       metrics, write_stack, shared_prefix_queue, shared_queue_mutex,
-                  api_version, output_format};
+s3cpp::meta::crt<boost::asio::awaitable<void>> WorkerManager::spawn_worker(std::size_t shard) {
+    Worker worker{clients.at(shard), bucket, metrics,     write_stack,  shared_queues,
+                  shard,             api_version, output_format};
 
     (metrics->active_workers)++;
     const boost::scope::scope_exit decrement_active_workers{[this]() { (metrics->active_workers)--; }};
@@ -1,40 +1,42 @@
 #pragma once
 
 #include "misc.hpp"
+#include "runtime.hpp"
 #include "s3cpp/aws/s3/client.hpp"
 #include "s3cpp/meta.hpp"
 
 #include <boost/asio/awaitable.hpp>
 #include <boost/asio/cancellation_signal.hpp>
 #include <boost/asio/posix/stream_descriptor.hpp>
-#include <boost/asio/thread_pool.hpp>
 #include <boost/lockfree/stack.hpp>
 #include <cstddef>
 #include <memory>
-#include <mutex>
 #include <string>
+#include <vector>
 
 namespace s3cpp::tools::list_all_objects {
 
 class WorkerManager {
 private:
-    s3cpp::aws::s3::Client client;
+    // one per shard of the runtime
+    std::vector<s3cpp::aws::s3::Client> clients;
     std::string bucket;
     std::shared_ptr<Metrics> metrics;
     std::shared_ptr<boost::lockfree::stack<std::string>> write_stack =
         std::make_shared<boost::lockfree::stack<std::string>>(1024);
-    std::unique_ptr<boost::asio::thread_pool> pool;
+    std::unique_ptr<Runtime> runtime;
     WorkerScalingConfig config;
     ListObjectsApiVersion api_version;
     OutputFormat output_format;
 
-    // Shared worker state
-    std::shared_ptr<PrefixQueue> shared_prefix_queue = std::make_shared<PrefixQueue>();
-    std::shared_ptr<std::mutex> shared_queue_mutex = std::make_shared<std::mutex>();
+    // Shared worker state, one queue per shard
+    std::vector<SharedPrefixQueue> shared_queues;
+    // workers are spread across shards round robin
+    std::size_t next_shard = 0;
 
     [[nodiscard]] std::size_t calculate_desired_workers(double current_ops_per_second) const;
 
-    [[nodiscard]] meta::crt<boost::asio::awaitable<void>> spawn_worker();
+    [[nodiscard]] meta::crt<boost::asio::awaitable<void>> spawn_worker(std::size_t shard);
 
     // wrapped in unique_ptr so that the class stays moveable
     std::unique_ptr<boost::asio::cancellation_signal> scaling_cancellation_signal =
@@ -45,10 +47,11 @@ private:
     scaling_worker(boost::asio::cancellation_slot cancellation_slot);
 
 public:
-    [[nodiscard]] WorkerManager(s3cpp::aws::s3::Client client, std::string bucket,
+    // clients holds one client per shard of runtime, and output_file_stream runs on shard 0
+    [[nodiscard]] WorkerManager(std::vector<s3cpp::aws::s3::Client> clients, std::string bucket,
                                 std::shared_ptr<Metrics> metrics,
                                 boost::asio::posix::stream_descriptor output_file_stream,
-                                std::unique_ptr<boost::asio::thread_pool> pool, WorkerScalingConfig config,
+                                std::unique_ptr<Runtime> runtime, WorkerScalingConfig config,
                                 ListObjectsApiVersion api_version, OutputFormat output_format);
     ~WorkerManager();
 
@@ -0,0 +1,123 @@
+#include "bucket_router.hpp"
+#include "s3cpp/aws/s3/session.hpp"
+
+#include <boost/beast/http/message.hpp> // IWYU pragma: keep
+#include <boost/beast/http/status.hpp>
+#include <boost/url/url.hpp>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+namespace {
+
+using s3cpp::aws::s3::AddressingStyle;
+using s3cpp::aws::s3::_internal::BucketRouter;
+
+[[nodiscard]] BucketRouter make_router(std::string_view endpoint) {
+    return BucketRouter{boost::urls::url{endpoint}, "us-east-1", AddressingStyle::VIRTUAL_HOSTED, {}, {}};
+}
+
+// the host, region and path a request for path goes to
+[[nodiscard]] bool check_route(BucketRouter &router, std::string_view path, std::string_view host,
+                               std::string_view region, std::string_view routed_path) {
+    const auto route = router.route(path);
+    const std::string_view routed_host = route.load_balancer->endpoint().encoded_host();
+    if (routed_host != host || route.region != region || route.path != routed_path) {
+        std::cerr << path << " went to " << routed_host << " in " << route.region << " as " << route.path
+                  << ", expected " << host << " in " << region << " as " << routed_path << "\n";
+        return false;
+    }
+    return true;
+}
+
+[[nodiscard]] boost::beast::http::response_header<> make_header(unsigned int status) {
+    boost::beast::http::response_header<> ret;
+    ret.result(status);
+    return ret;
+}
+
+} // namespace
+
+// NOLINTNEXTLINE(bugprone-exception-escape)
+int main() {
+    // virtual hosts drop the bucket from the path
+    {
+        BucketRouter router = make_router("https://s3.us-east-1.amazonaws.com");
+        if (!check_route(router, "/bucket/key", "bucket.s3.us-east-1.amazonaws.com", "us-east-1", "/key") ||
+            !check_route(router, "/bucket", "bucket.s3.us-east-1.amazonaws.com", "us-east-1", "/") ||
+            !check_route(router, "/", "s3.us-east-1.amazonaws.com", "us-east-1", "/")) {
+            return 1;
+        }
+    }
+
+    // a dotted bucket doesn't match the wildcard certificate, so it stays path-style over https only
+    {
+        BucketRouter https = make_router("https://s3.us-east-1.amazonaws.com");
+        BucketRouter http = make_router("http://s3.us-east-1.amazonaws.com");
+        if (!check_route(https, "/my.bucket/key", "s3.us-east-1.amazonaws.com", "us-east-1",
+                         "/my.bucket/key") ||
+            !check_route(http, "/my.bucket/key", "my.bucket.s3.us-east-1.amazonaws.com", "us-east-1",
+                         "/key")) {
+            return 1;
+        }
+    }
+
+    // 301 with only the region header, the regional endpoint follows from the region
+    {
+        BucketRouter router = make_router("https://s3.us-east-1.amazonaws.com");
+        auto header = make_header(301);
+        header.set("x-amz-bucket-region", "eu-west-1");
+        if (!router.learn("/bucket/key", header, "") ||
+            !check_route(router, "/bucket/key", "bucket.s3.eu-west-1.amazonaws.com", "eu-west-1", "/key") ||
+            !check_route(router, "/other/key", "other.s3.us-east-1.amazonaws.com", "us-east-1", "/key")) {
+            std::cerr << "301 with x-amz-bucket-region wasn't followed\n";
+            return 1;
+        }
+        // nothing new to learn the second time
+        if (router.learn("/bucket/key", header, "")) {
+            std::cerr << "the same redirect was learned twice\n";
+            return 1;
+        }
+    }
+
+    // 301 with the endpoint as a virtual host, the bucket isn't prepended a second time
+    {
+        BucketRouter router = make_router("https://s3.us-east-1.amazonaws.com");
+        constexpr std::string_view body = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                                          "<Error><Code>PermanentRedirect</Code>"
+                                          "<Endpoint>bucket.s3.eu-central-1.amazonaws.com</Endpoint>"
+                                          "<Bucket>bucket</Bucket></Error>";
+        if (!router.learn("/bucket/key", make_header(301), body) ||
+            !check_route(router, "/bucket/key", "bucket.s3.eu-central-1.amazonaws.com", "us-east-1",
+                         "/key")) {
+            std::cerr << "301 with a virtual-host <Endpoint> wasn't followed\n";
+            return 1;
+        }
+    }
+
+    // 400 AuthorizationHeaderMalformed names the region in the body
+    {
+        BucketRouter router = make_router("https://s3.us-east-1.amazonaws.com");
+        constexpr std::string_view body = "<Error><Code>AuthorizationHeaderMalformed</Code>"
+                                          "<Message>the region 'us-east-1' is wrong; "
+                                          "expecting 'ap-south-1'</Message>"
+                                          "<Region>ap-south-1</Region></Error>";
+        if (!router.learn("/bucket/key", make_header(400), body) ||
+            !check_route(router, "/bucket/key", "bucket.s3.ap-south-1.amazonaws.com", "ap-south-1", "/key")) {
+            std::cerr << "400 AuthorizationHeaderMalformed wasn't followed\n";
+            return 1;
+        }
+    }
+
+    // other responses aren't redirects, even with a region header
+    {
+        BucketRouter router = make_router("https://s3.us-east-1.amazonaws.com");
+        auto header = make_header(200);
+        header.set("x-amz-bucket-region", "eu-west-1");
+        if (router.learn("/bucket/key", header, "") || router.learn("/bucket/key", make_header(400), "") ||
+            !check_route(router, "/bucket/key", "bucket.s3.us-east-1.amazonaws.com", "us-east-1", "/key")) {
+            std::cerr << "learned a redirect from a response that isn't one\n";
+            return 1;
+        }
+    }
+}
@@ -1,4 +1,207 @@
+#include "s3cpp/aws/iam/urlencode.hpp"
+
+#include <array>
 #include <boost/url/parse_query.hpp>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// every kernel: scalar, SSE2 and AVX2
+constexpr std::array<std::size_t, 3> kernels{0, 16, 32};
+
+// around the block widths of the kernels
+constexpr std::array<std::size_t, 10> lengths{0, 1, 15, 16, 17, 31, 32, 33, 63, 65};
+
+[[nodiscard]] bool is_unreserved(unsigned char chr) {
+    return (chr >= 'A' && chr <= 'Z') || (chr >= 'a' && chr <= 'z') || (chr >= '0' && chr <= '9') ||
+           chr == '-' || chr == '.' || chr == '_' || chr == '~';
+}
+
+// byte by byte, as the kernels have to do it
+[[nodiscard]] std::string reference_encode(std::string_view input, bool path) {
+    constexpr std::string_view digits = "0123456789ABCDEF";
+    std::string ret;
+    for (const char chr : input) {
+        const auto byte = static_cast<unsigned char>(chr);
+        if (is_unreserved(byte) || (path && byte == '/')) {
+            ret += chr;
+        } else {
+            ret += '%';
+            ret += digits[byte >> 4];
+            ret += digits[byte & 0x0f];
+        }
+    }
+    return ret;
+}
+
+[[nodiscard]] int hex_value(char chr) {
+    if (chr >= '0' && chr <= '9') {
+        return chr - '0';
+    }
+    if (chr >= 'A' && chr <= 'F') {
+        return chr - 'A' + 10;
+    }
+    if (chr >= 'a' && chr <= 'f') {
+        return chr - 'a' + 10;
+    }
+    return -1;
+}
+
+// nullopt for a malformed escape
+[[nodiscard]] std::optional<std::string> reference_decode(std::string_view input, bool plus) {
+    std::string ret;
+    for (std::size_t i = 0; i < input.size(); i++) {
+        if (plus && input[i] == '+') {
+            ret += ' ';
+        } else if (input[i] == '%') {
+            if (i + 2 >= input.size()) {
+                return std::nullopt;
+            }
+            const int high = hex_value(input[i + 1]);
+            const int low = hex_value(input[i + 2]);
+            if (high < 0 || low < 0) {
+                return std::nullopt;
+            }
+            ret += static_cast<char>((high << 4) | low);
+            i += 2;
+        } else {
+            ret += input[i];
+        }
+    }
+    return ret;
+}
+
+// bytes that pass, bytes to escape, and the ones a decoder cares about
+constexpr std::string_view alphabet = "aZ09-._~/ +%:?&=\x01\x7f\x80\xc3\xa9\xff";
+
+[[nodiscard]] std::string make_input(std::size_t length, std::uint32_t &seed) {
+    std::string ret;
+    for (std::size_t i = 0; i < length; i++) {
+        seed = (seed * 1664525) + 1013904223;
+        ret += alphabet[(seed >> 16) % alphabet.size()];
+    }
+    return ret;
+}
+
+// the current kernel against the reference on one input
+[[nodiscard]] bool check_kernel(std::size_t kernel, std::string_view input) {
+    using namespace s3cpp::aws::iam;
+    const std::string expected = reference_encode(input, false);
+    const std::string expected_path = reference_encode(input, true);
+    if (urlencode(input) != expected || urlencode_query(input) != expected ||
+        urlencode_path(input) != expected_path || urlencode_required(input) != (expected != input) ||
+        urlencode_path_required(input) != (expected_path != input)) {
+        std::cerr << "kernel " << kernel << " encoded " << input.size() << " bytes wrong: " << expected
+                  << " vs " << urlencode(input) << "\n";
+        return false;
+    }
+    for (const bool plus : {false, true}) {
+        const auto decoded = plus ? urldecode_query(input) : urldecode(input);
+        const auto expected_decoded = reference_decode(input, plus);
+        if (decoded.has_value() != expected_decoded.has_value() ||
+            (decoded.has_value() && decoded.value() != expected_decoded.value())) {
+            std::cerr << "kernel " << kernel << " decoded " << input << " wrong\n";
+            return false;
+        }
+    }
+    // encoding round trips for every byte
+    if (urldecode(expected).value_or("") != input || urldecode(expected_path).value_or("") != input) {
+        std::cerr << "kernel " << kernel << " didn't round trip " << input.size() << " bytes\n";
+        return false;
+    }
+    return true;
+}
+
+[[nodiscard]] bool check_kernel(std::size_t kernel) {
+    std::uint32_t seed = 42;
+    for (const std::size_t length : lengths) {
+        for (std::size_t i = 0; i < 64; i++) {
+            if (!check_kernel(kernel, make_input(length, seed))) {
+                return false;
+            }
+        }
+        // nothing to escape, so only the block copies run
+        if (!check_kernel(kernel, std::string(length, 'k'))) {
+            return false;
+        }
+    }
+    // escapes that start in one block and end in the next, and escapes cut off at the end
+    for (const std::size_t width : {16, 32}) {
+        for (std::size_t at = width - 3; at <= width; at++) {
+            for (const std::string_view escape : {"%C3%A9", "%2F", "%zz", "%4", "%"}) {
+                std::string input(at, 'k');
+                input += escape;
+                if (!check_kernel(kernel, input) || !check_kernel(kernel, input + std::string(width, 'k'))) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+// NOLINTNEXTLINE(bugprone-exception-escape)
+int main() {
+    std::cout << boost::urls::parse_query("id=42&name=jane+doe&page+size=20").value();
+
+    // long enough for the vector kernels, with something to escape in and after the first block
+    constexpr std::string_view key = "photos/2024/summer holiday/IMG 0001+edit~v2.jpg";
+    if (s3cpp::aws::iam::urlencode(key) !=
+        "photos%2F2024%2Fsummer%20holiday%2FIMG%200001%2Bedit~v2.jpg") {
+        std::cerr << "urlencode failed, got \n" << s3cpp::aws::iam::urlencode(key) << "\n";
+        return 1;
+    }
+    const std::string encoded_path = s3cpp::aws::iam::urlencode_path(key);
+    if (encoded_path != "photos/2024/summer%20holiday/IMG%200001%2Bedit~v2.jpg") {
+        std::cerr << "urlencode_path failed, got \n" << encoded_path << "\n";
+        return 1;
+    }
+    if (!s3cpp::aws::iam::urlencode_path_required(key) ||
+        s3cpp::aws::iam::urlencode_path_required("photos/2024/summer-holiday/IMG_0001.edit~v2.jpg") ||
+        !s3cpp::aws::iam::urlencode_query_required("photos/2024/summer-holiday/IMG_0001.edit~v2.jpg")) {
+        std::cerr << "urlencode_*_required failed\n";
+        return 1;
+    }
+    if (s3cpp::aws::iam::urldecode(encoded_path).value_or("") != key) {
+        std::cerr << "urldecode failed\n";
+        return 1;
+    }
+
+    // the keys and values of the query above, as parse_query decodes them
+    constexpr std::array<std::pair<std::string_view, std::string_view>, 3> params{{
+        {"42", "42"},
+        {"jane+doe", "jane doe"},
+        {"page+size", "page size"},
+    }};
+    for (const auto &[encoded, decoded] : params) {
+        if (s3cpp::aws::iam::urldecode_query(encoded).value_or("") != decoded) {
+            std::cerr << "urldecode_query failed for " << encoded << "\n";
+            return 1;
+        }
+    }
+
+    if (s3cpp::aws::iam::urldecode("trailing%4").has_value() ||
+        s3cpp::aws::iam::urldecode("bad%zzdigits").has_value()) {
+        std::cerr << "urldecode accepted a malformed escape\n";
+        return 1;
+    }
 
-int main() { std::cout << boost::urls::parse_query("id=42&name=jane+doe&page+size=20").value(); }
+    for (const std::size_t kernel : kernels) {
+        if (!s3cpp::aws::iam::_internal::use_urlencode_kernel(kernel)) {
+            continue;
+        }
+        if (!check_kernel(kernel)) {
+            return 1;
+        }
+    }
+    s3cpp::aws::iam::_internal::use_default_urlencode_kernel();
+}
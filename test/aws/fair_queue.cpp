@@ -0,0 +1,113 @@
+#include "fair_queue.hpp"
+#include "s3cpp/aws/s3/session.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <iostream>
+#include <optional>
+#include <vector>
+
+namespace {
+
+using s3cpp::aws::s3::Priority;
+using s3cpp::aws::s3::_internal::FairQueue;
+
+constexpr std::array<double, s3cpp::aws::s3::priority_count> weights{16, 4, 1};
+
+// pops n items, or fewer if the queue runs dry
+[[nodiscard]] std::vector<Priority> pop(FairQueue<Priority> &queue, std::size_t n) {
+    std::vector<Priority> ret;
+    for (std::size_t i = 0; i < n; i++) {
+        const std::optional<Priority> item = queue.pop();
+        if (!item.has_value()) {
+            break;
+        }
+        ret.push_back(item.value());
+    }
+    return ret;
+}
+
+[[nodiscard]] std::size_t count(const std::vector<Priority> &items, Priority priority) {
+    return static_cast<std::size_t>(std::ranges::count(items, priority));
+}
+
+} // namespace
+
+int main() {
+    // BULK arrives first, REALTIME still goes ahead, but BULK gets its share of every round
+    {
+        FairQueue<Priority> queue{weights};
+        for (std::size_t i = 0; i < 100; i++) {
+            queue.push(Priority::BULK, Priority::BULK);
+        }
+        for (std::size_t i = 0; i < 400; i++) {
+            queue.push(Priority::REALTIME, Priority::REALTIME);
+        }
+        const auto first = pop(queue, 2);
+        if (first.size() != 2 || first[0] != Priority::REALTIME) {
+            std::cerr << "REALTIME didn't overtake the BULK items queued before it\n";
+            return 1;
+        }
+        const auto rounds = pop(queue, 10 * 17);
+        for (std::size_t round = 0; round < 10; round++) {
+            const std::vector<Priority> items{rounds.begin() + static_cast<std::ptrdiff_t>(round * 17),
+                                              rounds.begin() + static_cast<std::ptrdiff_t>((round + 1) * 17)};
+            if (count(items, Priority::BULK) != 1 || count(items, Priority::REALTIME) != 16) {
+                std::cerr << "round " << round << " of 17 pops got " << count(items, Priority::REALTIME)
+                          << " REALTIME and " << count(items, Priority::BULK) << " BULK, expected 16 and 1\n";
+                return 1;
+            }
+        }
+    }
+
+    // all three classes backlogged share by weight
+    {
+        FairQueue<Priority> queue{weights};
+        for (std::size_t i = 0; i < 1000; i++) {
+            queue.push(Priority::BULK, Priority::BULK);
+            queue.push(Priority::NORMAL, Priority::NORMAL);
+            queue.push(Priority::REALTIME, Priority::REALTIME);
+        }
+        const auto items = pop(queue, 21 * 20);
+        if (count(items, Priority::REALTIME) != 16 * 20 || count(items, Priority::NORMAL) != 4 * 20 ||
+            count(items, Priority::BULK) != 20) {
+            std::cerr << "shares by weight are off: " << count(items, Priority::REALTIME) << " REALTIME, "
+                      << count(items, Priority::NORMAL) << " NORMAL, " << count(items, Priority::BULK)
+                      << " BULK\n";
+            return 1;
+        }
+    }
+
+    // a class that was idle doesn't get to catch up on the time it spent idle
+    {
+        FairQueue<Priority> queue{weights};
+        for (std::size_t i = 0; i < 200; i++) {
+            queue.push(Priority::REALTIME, Priority::REALTIME);
+        }
+        if (pop(queue, 100).size() != 100) {
+            std::cerr << "queue ran dry early\n";
+            return 1;
+        }
+        for (std::size_t i = 0; i < 50; i++) {
+            queue.push(Priority::BULK, Priority::BULK);
+        }
+        const auto items = pop(queue, 17);
+        if (count(items, Priority::BULK) > 2) {
+            std::cerr << "BULK cashed in on its idle time, got " << count(items, Priority::BULK)
+                      << " of 17 pops\n";
+            return 1;
+        }
+    }
+
+    // erase takes a waiter out of its class
+    {
+        FairQueue<int> queue{weights};
+        queue.push(Priority::BULK, 1);
+        queue.push(Priority::NORMAL, 2);
+        if (!queue.erase(2) || queue.erase(2) || queue.pop() != 1 || !queue.empty()) {
+            std::cerr << "erase failed\n";
+            return 1;
+        }
+    }
+}
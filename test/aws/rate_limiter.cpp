@@ -0,0 +1,206 @@
+#include "rate_limiter.hpp"
+#include "s3cpp/aws/s3/session.hpp"
+#include "s3cpp/meta.hpp"
+
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/co_spawn.hpp> // IWYU pragma: keep
+#include <boost/asio/detached.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/this_coro.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/asio/use_future.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <tuple>
+#include <utility>
+
+namespace {
+
+using s3cpp::aws::s3::ConnectionPoolOptions;
+using s3cpp::aws::s3::Priority;
+using s3cpp::aws::s3::RateLimit;
+using s3cpp::aws::s3::_internal::RateLimiter;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+// the tests run on the real clock, with rates high enough that every wait stays short
+[[nodiscard]] std::shared_ptr<RateLimiter> make_limiter(std::shared_ptr<RateLimiter> parent = nullptr) {
+    return std::make_shared<RateLimiter>(std::move(parent), ConnectionPoolOptions{}.priority_weights);
+}
+
+// how long after start the acquire returned
+[[nodiscard]] s3cpp::meta::crt<boost::asio::awaitable<steady_clock::duration>>
+time_acquire(std::shared_ptr<RateLimiter> limiter, std::size_t requests, std::uint64_t bytes,
+             Priority priority, steady_clock::time_point start) {
+    if (const auto ec = co_await limiter->acquire(requests, bytes, priority); ec.failed()) {
+        std::cerr << "acquire failed: " << ec.message() << "\n";
+    }
+    co_return steady_clock::now() - start;
+}
+
+[[nodiscard]] s3cpp::meta::crt<boost::asio::awaitable<void>>
+configure_after(std::shared_ptr<RateLimiter> limiter, RateLimit limit, milliseconds delay) {
+    boost::asio::steady_timer timer{co_await boost::asio::this_coro::executor, delay};
+    co_await timer.async_wait(boost::asio::use_awaitable);
+    limiter->configure(limit);
+}
+
+[[nodiscard]] std::future<steady_clock::duration>
+spawn_acquire(boost::asio::io_context &context, const std::shared_ptr<RateLimiter> &limiter,
+              std::size_t requests, std::uint64_t bytes, Priority priority, steady_clock::time_point start) {
+    return boost::asio::co_spawn(context, time_acquire(limiter, requests, bytes, priority, start),
+                                 boost::asio::use_future);
+}
+
+[[nodiscard]] long long milliseconds_of(steady_clock::duration duration) {
+    return std::chrono::duration_cast<milliseconds>(duration).count();
+}
+
+} // namespace
+
+// NOLINTNEXTLINE(bugprone-exception-escape)
+int main() {
+    // nothing configured, nothing to wait for
+    {
+        const auto limiter = make_limiter();
+        if (limiter->is_limited()) {
+            std::cerr << "a limiter without limits is limited\n";
+            return 1;
+        }
+        boost::asio::io_context context{1};
+        const auto start = steady_clock::now();
+        auto elapsed = spawn_acquire(context, limiter, 1000, 1 << 30, Priority::NORMAL, start);
+        context.run();
+        if (elapsed.get() > milliseconds{50}) {
+            std::cerr << "an unlimited acquire waited\n";
+            return 1;
+        }
+    }
+
+    // a burst of 10ms at 10000 bytes per second holds 100 bytes, a body of 1100 leaves 1000 of debt behind,
+    // which the next caller sleeps off for 100ms no matter how little it takes
+    {
+        const auto limiter = make_limiter();
+        limiter->configure({.bytes_per_second = 10000, .burst = milliseconds{10}});
+        boost::asio::io_context context{1};
+        const auto start = steady_clock::now();
+        auto first = spawn_acquire(context, limiter, 1, 1100, Priority::NORMAL, start);
+        auto second = spawn_acquire(context, limiter, 1, 0, Priority::NORMAL, start);
+        context.run();
+        const auto first_elapsed = first.get();
+        const auto second_elapsed = second.get();
+        if (first_elapsed > milliseconds{50} || second_elapsed < milliseconds{90} ||
+            second_elapsed > milliseconds{500}) {
+            std::cerr << "debt of 100ms: first waited " << milliseconds_of(first_elapsed) << "ms, second "
+                      << milliseconds_of(second_elapsed) << "ms\n";
+            return 1;
+        }
+    }
+
+    // the bucket refills while idle, up to the burst
+    {
+        const auto limiter = make_limiter();
+        limiter->configure({.requests_per_second = 20, .burst = milliseconds{100}});
+        boost::asio::io_context context{1};
+        // empties the bucket of 2 requests
+        std::ignore = spawn_acquire(context, limiter, 2, 0, Priority::NORMAL, steady_clock::now());
+        context.run();
+        context.restart();
+        std::this_thread::sleep_for(milliseconds{150});
+        const auto start = steady_clock::now();
+        auto refilled = spawn_acquire(context, limiter, 2, 0, Priority::NORMAL, start);
+        auto over = spawn_acquire(context, limiter, 1, 0, Priority::NORMAL, start);
+        context.run();
+        const auto refilled_elapsed = refilled.get();
+        const auto over_elapsed = over.get();
+        if (refilled_elapsed > milliseconds{30} || over_elapsed < milliseconds{40}) {
+            std::cerr << "refill: 2 requests waited " << milliseconds_of(refilled_elapsed)
+                      << "ms, the one after them " << milliseconds_of(over_elapsed) << "ms\n";
+            return 1;
+        }
+    }
+
+    // a parent's limit applies to children without their own
+    {
+        const auto parent = make_limiter();
+        const auto child = make_limiter(parent);
+        parent->configure({.requests_per_second = 10, .burst = milliseconds{100}});
+        if (!child->is_limited()) {
+            std::cerr << "a child of a limited parent isn't limited\n";
+            return 1;
+        }
+        boost::asio::io_context context{1};
+        const auto start = steady_clock::now();
+        std::ignore = spawn_acquire(context, child, 1, 0, Priority::NORMAL, start);
+        auto second = spawn_acquire(context, child, 1, 0, Priority::NORMAL, start);
+        context.run();
+        if (second.get() < milliseconds{90}) {
+            std::cerr << "the parent's limit didn't apply to its child\n";
+            return 1;
+        }
+    }
+
+    // waiters take their turn by priority, not by arrival
+    {
+        const auto limiter = make_limiter();
+        limiter->configure({.requests_per_second = 20, .burst = milliseconds{50}});
+        boost::asio::io_context context{1};
+        const auto start = steady_clock::now();
+        std::ignore = spawn_acquire(context, limiter, 1, 0, Priority::NORMAL, start);
+        // holds the turn for 50ms while the other two queue up
+        std::ignore = spawn_acquire(context, limiter, 1, 0, Priority::NORMAL, start);
+        auto bulk = spawn_acquire(context, limiter, 1, 0, Priority::BULK, start);
+        auto realtime = spawn_acquire(context, limiter, 1, 0, Priority::REALTIME, start);
+        context.run();
+        const auto bulk_elapsed = bulk.get();
+        const auto realtime_elapsed = realtime.get();
+        if (realtime_elapsed >= bulk_elapsed) {
+            std::cerr << "REALTIME finished after " << milliseconds_of(realtime_elapsed) << "ms, BULK queued "
+                      << "before it after " << milliseconds_of(bulk_elapsed) << "ms\n";
+            return 1;
+        }
+    }
+
+    // raising the limit while callers wait speeds up those that haven't reserved yet, the one sleeping off
+    // the old debt keeps sleeping
+    {
+        const auto limiter = make_limiter();
+        limiter->configure({.requests_per_second = 2, .burst = milliseconds{500}});
+        boost::asio::io_context context{1};
+        const auto start = steady_clock::now();
+        std::ignore = spawn_acquire(context, limiter, 1, 0, Priority::NORMAL, start);
+        // 500ms in debt at 2 per second
+        auto sleeping = spawn_acquire(context, limiter, 1, 0, Priority::NORMAL, start);
+        // 1000ms at 2 per second, about when the sleeping one is done at 1000 per second
+        auto queued = spawn_acquire(context, limiter, 1, 0, Priority::NORMAL, start);
+        const RateLimit raised{.requests_per_second = 1000, .burst = milliseconds{1000}};
+        boost::asio::co_spawn(context, configure_after(limiter, raised, milliseconds{50}),
+                              boost::asio::detached);
+        context.run();
+        const auto sleeping_elapsed = sleeping.get();
+        const auto queued_elapsed = queued.get();
+        if (sleeping_elapsed < milliseconds{450} || queued_elapsed > milliseconds{800}) {
+            std::cerr << "configure while waiting: the sleeping caller took "
+                      << milliseconds_of(sleeping_elapsed) << "ms, the queued one "
+                      << milliseconds_of(queued_elapsed) << "ms\n";
+            return 1;
+        }
+    }
+
+    // removing the limit lets everything through again
+    {
+        const auto limiter = make_limiter();
+        limiter->configure({.requests_per_second = 1, .burst = milliseconds{1000}});
+        limiter->configure({});
+        if (limiter->is_limited()) {
+            std::cerr << "a limit that was removed still applies\n";
+            return 1;
+        }
+    }
+}
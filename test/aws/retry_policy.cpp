@@ -0,0 +1,122 @@
+#include "retry_policy.hpp"
+#include "s3cpp/aws/s3/session.hpp"
+#include "s3cpp/meta.hpp"
+
+#include <array>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/co_spawn.hpp> // IWYU pragma: keep
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/use_future.hpp>
+#include <boost/beast/core/error.hpp>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <string_view>
+
+namespace {
+
+using s3cpp::aws::s3::ConnectionPoolOptions;
+using s3cpp::aws::s3::RetryOptions;
+using s3cpp::aws::s3::_internal::RetryPolicy;
+using Outcome = RetryPolicy::Outcome;
+
+struct StatusCase {
+    unsigned int status;
+    std::string_view code;
+    Outcome expected;
+};
+
+constexpr std::array<StatusCase, 9> status_cases{{
+    {.status = 200, .code = "", .expected = Outcome::SUCCESS},
+    {.status = 503, .code = "SlowDown", .expected = Outcome::THROTTLED},
+    // HEAD responses have no body to read the code from
+    {.status = 503, .code = "", .expected = Outcome::THROTTLED},
+    {.status = 429, .code = "", .expected = Outcome::THROTTLED},
+    {.status = 500, .code = "InternalError", .expected = Outcome::RETRYABLE},
+    {.status = 502, .code = "", .expected = Outcome::RETRYABLE},
+    {.status = 400, .code = "RequestTimeout", .expected = Outcome::RETRYABLE},
+    {.status = 400, .code = "InvalidArgument", .expected = Outcome::NOT_RETRYABLE},
+    {.status = 404, .code = "NoSuchKey", .expected = Outcome::NOT_RETRYABLE},
+}};
+
+[[nodiscard]] RetryPolicy make_policy(RetryOptions options) {
+    return RetryPolicy{options, ConnectionPoolOptions{}.priority_weights};
+}
+
+[[nodiscard]] s3cpp::meta::crt<boost::asio::awaitable<std::chrono::steady_clock::duration>>
+time_backoff(const RetryPolicy &policy, std::size_t attempt) {
+    const auto start = std::chrono::steady_clock::now();
+    if (const auto ec = co_await policy.backoff(attempt); ec.failed()) {
+        std::cerr << "backoff failed: " << ec.message() << "\n";
+    }
+    co_return std::chrono::steady_clock::now() - start;
+}
+
+} // namespace
+
+// NOLINTNEXTLINE(bugprone-exception-escape)
+int main() {
+    for (const auto &[status, code, expected] : status_cases) {
+        if (RetryPolicy::classify(status, code) != expected) {
+            std::cerr << "classify(" << status << ", " << code << ") returned "
+                      << static_cast<int>(RetryPolicy::classify(status, code)) << ", expected "
+                      << static_cast<int>(expected) << "\n";
+            return 1;
+        }
+    }
+
+    // the server may have acted on a request whose response got lost, only idempotent ones are sent again
+    const boost::beast::error_code reset = boost::asio::error::connection_reset;
+    if (RetryPolicy::classify(reset, true) != Outcome::RETRYABLE ||
+        RetryPolicy::classify(reset, false) != Outcome::NOT_RETRYABLE) {
+        std::cerr << "classify of a send error ignored idempotency\n";
+        return 1;
+    }
+    if (RetryPolicy::classify(boost::asio::error::operation_aborted, true) != Outcome::NOT_RETRYABLE) {
+        std::cerr << "a cancelled request was retried\n";
+        return 1;
+    }
+
+    // two retries fit into the budget, then it is exhausted until a successful retry pays its cost back
+    {
+        RetryPolicy policy = make_policy({.max_attempts = 10, .retry_budget = 10, .retry_cost = 5});
+        if (!policy.should_retry(Outcome::RETRYABLE, 1) || !policy.should_retry(Outcome::THROTTLED, 1) ||
+            policy.should_retry(Outcome::RETRYABLE, 1)) {
+            std::cerr << "retry budget of 10 at a cost of 5 didn't allow exactly two retries\n";
+            return 1;
+        }
+        policy.record(Outcome::SUCCESS, 2);
+        if (!policy.should_retry(Outcome::RETRYABLE, 1) || policy.should_retry(Outcome::RETRYABLE, 1)) {
+            std::cerr << "a successful retry didn't pay back its cost\n";
+            return 1;
+        }
+    }
+
+    // neither successes, failures that can't be retried, nor the last attempt are retried
+    {
+        RetryPolicy policy = make_policy({.max_attempts = 3});
+        if (policy.should_retry(Outcome::SUCCESS, 1) || policy.should_retry(Outcome::NOT_RETRYABLE, 1) ||
+            policy.should_retry(Outcome::RETRYABLE, 3) || !policy.should_retry(Outcome::RETRYABLE, 2)) {
+            std::cerr << "should_retry ignored the outcome or max_attempts\n";
+            return 1;
+        }
+    }
+
+    // uncapped, the 20th backoff would be up to 2^20 times base_backoff
+    {
+        const RetryPolicy policy = make_policy(
+            {.base_backoff = std::chrono::milliseconds{1000}, .max_backoff = std::chrono::milliseconds{10}});
+        boost::asio::io_context context{1};
+        for (std::size_t i = 0; i < 20; i++) {
+            auto elapsed = boost::asio::co_spawn(context, time_backoff(policy, 20), boost::asio::use_future);
+            context.run();
+            context.restart();
+            // generous for a loaded machine, far from the uncapped backoff
+            if (elapsed.get() > std::chrono::milliseconds{500}) {
+                std::cerr << "backoff exceeded max_backoff\n";
+                return 1;
+            }
+        }
+    }
+}
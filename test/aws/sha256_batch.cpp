@@ -0,0 +1,99 @@
+#include "s3cpp/aws/iam/crypto.hpp"
+
+#include <array>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using s3cpp::aws::iam::_internal::sha256_batch_lanes;
+
+// every kernel, and what the CPU picks
+constexpr std::array<std::size_t, 5> kernels{0, 1, 4, 8, 16};
+
+// the lengths where the padding moves on to another block
+constexpr std::array<std::size_t, 6> boundaries{55, 56, 63, 64, 119, 120};
+
+constexpr std::size_t max_length = 200;
+
+// hashes messages on kernel, 0 for the one sha256_batch picks, and compares against hashing them one by one
+[[nodiscard]] bool check(std::size_t kernel, const std::vector<std::string_view> &messages) {
+    std::vector<s3cpp::aws::iam::_internal::sha256_digest> digests(messages.size());
+    if (kernel == 0) {
+        s3cpp::aws::iam::_internal::sha256_batch(messages, digests);
+    } else if (!s3cpp::aws::iam::_internal::sha256_batch_on(kernel, messages, digests)) {
+        return true;
+    }
+    for (std::size_t i = 0; i < messages.size(); i++) {
+        if (digests[i] != s3cpp::aws::iam::_internal::sha256(messages[i])) {
+            std::cerr << "sha256_batch with " << (kernel == 0 ? sha256_batch_lanes() : kernel)
+                      << " lanes failed for a message of "
+                      << messages[i].size() << " bytes at " << i << " of " << messages.size() << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+// NOLINTNEXTLINE(bugprone-exception-escape)
+int main() {
+    // the messages are views into this at odd offsets, so that they aren't aligned
+    std::string data(4 * 4096, '\0');
+    for (std::size_t i = 0; i < data.size(); i++) {
+        data[i] = static_cast<char>((i * 131) ^ (i >> 7));
+    }
+    const auto message = [&data](std::size_t index, std::size_t length) {
+        return std::string_view{data}.substr((index * 37) % 4096, length);
+    };
+
+    for (const std::size_t kernel : kernels) {
+        // every length from 0 to 200 in batches of 2 to 33, mixed so that the lanes finish at different times
+        for (std::size_t batch_size = 2; batch_size <= 33; batch_size++) {
+            for (std::size_t first = 0; first <= max_length; first += batch_size) {
+                std::vector<std::string_view> messages;
+                for (std::size_t i = 0; i < batch_size; i++) {
+                    messages.push_back(message(first + i, (first + i) % (max_length + 1)));
+                }
+                if (!check(kernel, messages)) {
+                    return 1;
+                }
+            }
+        }
+
+        // all lanes on the same padding boundary at once
+        for (const std::size_t length : boundaries) {
+            for (std::size_t batch_size = 2; batch_size <= 33; batch_size++) {
+                std::vector<std::string_view> messages;
+                for (std::size_t i = 0; i < batch_size; i++) {
+                    messages.push_back(message(i, length));
+                }
+                if (!check(kernel, messages)) {
+                    return 1;
+                }
+            }
+        }
+
+        // a long message keeps one lane busy while the others go through many short ones
+        std::vector<std::string_view> messages{message(0, 3 * 4096)};
+        for (std::size_t i = 1; i < 33; i++) {
+            messages.push_back(message(i, boundaries[i % boundaries.size()]));
+        }
+        if (!check(kernel, messages)) {
+            return 1;
+        }
+
+        // the lanes thin out while some messages are partly hashed, those are finished one by one
+        std::vector<std::string_view> spread;
+        for (std::size_t i = 0; i < 24; i++) {
+            spread.push_back(message(i, (i * i * 23) % (3 * 4096)));
+        }
+        if (!check(kernel, spread)) {
+            return 1;
+        }
+    }
+}
@@ -0,0 +1,112 @@
+#include "s3cpp/aws/iam/sign_request.hpp"
+#include "s3cpp/aws/iam/string_to_sign.hpp"
+#include "s3cpp/aws/scope.hpp"
+#include "signing_key_cache.hpp"
+
+#include <array>
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace {
+
+using s3cpp::aws::s3::_internal::SigningKeyCache;
+using s3cpp::aws::s3::_internal::SigningScope;
+
+constexpr std::string_view secret = "wJalrXUtnFEMI/K7MDENG/bPxRfiCYEXAMPLEKEY";
+
+// the scope as the uncached signing code derives it
+[[nodiscard]] bool check_scope(const SigningScope &scope, std::string_view date, std::string_view region) {
+    const s3cpp::aws::Scope expected{
+        .timestamp = std::string{date}, .region = std::string{region}, .service = "s3"};
+    const std::string credential_scope = std::format("{}", expected);
+    if (scope.date != date || scope.region != region || scope.credential_scope != credential_scope ||
+        scope.key != s3cpp::aws::iam::get_signing_key(secret, expected)) {
+        std::cerr << "cached scope " << scope.credential_scope << " doesn't match " << credential_scope
+                  << "\n";
+        return false;
+    }
+    return true;
+}
+
+// a millisecond before the year changes, in UTC
+constexpr std::chrono::sys_time<std::chrono::milliseconds> before_midnight =
+    std::chrono::sys_days{std::chrono::year{2024} / 12 / 31} + std::chrono::milliseconds{86'399'999};
+
+[[nodiscard]] std::string amz_date(std::chrono::sys_time<std::chrono::milliseconds> time) {
+    const auto ret = s3cpp::aws::s3::_internal::amz_date(time);
+    return {ret.data(), ret.size()};
+}
+
+// the YYYYMMDD a request signed at time is scoped to
+[[nodiscard]] std::string date_of(std::chrono::sys_time<std::chrono::milliseconds> time) {
+    return amz_date(time).substr(0, 8);
+}
+
+} // namespace
+
+// NOLINTNEXTLINE(bugprone-exception-escape)
+int main() {
+    using namespace std::chrono_literals;
+
+    // the cached key and scope are what iam would derive per request, and are derived once per region
+    {
+        SigningKeyCache cache{"AKIDEXAMPLE", std::string{secret}};
+        const auto east = cache.get("20240101", "us-east-1");
+        const auto west = cache.get("20240101", "eu-west-1");
+        if (!check_scope(*east, "20240101", "us-east-1") || !check_scope(*west, "20240101", "eu-west-1")) {
+            return 1;
+        }
+        if (cache.get("20240101", "us-east-1") != east || cache.get("20240101", "eu-west-1") != west) {
+            std::cerr << "a cached scope was derived again\n";
+            return 1;
+        }
+    }
+
+    // x-amz-date is the uncached timestamp of the second, also when the thread has one cached
+    {
+        const std::array times{
+            before_midnight - 500ms,
+            before_midnight,
+            before_midnight + 1ms,
+            before_midnight + 1001ms,
+        };
+        for (const auto &time : times) {
+            const auto expected =
+                s3cpp::aws::iam::format_timestamp(std::chrono::floor<std::chrono::seconds>(time));
+            if (const auto actual = amz_date(time); actual != expected) {
+                std::cerr << "amz_date returned " << actual << ", expected " << expected << "\n";
+                return 1;
+            }
+        }
+        if (amz_date(before_midnight) != "20241231T235959Z" ||
+            amz_date(before_midnight + 1ms) != "20250101T000000Z") {
+            std::cerr << "amz_date didn't roll over at midnight UTC\n";
+            return 1;
+        }
+    }
+
+    // at midnight UTC the date of x-amz-date moves on and the cache with it, requests still signed with the
+    // previous date get a correct scope without evicting the current one
+    {
+        const std::string old_date = date_of(before_midnight);
+        const std::string new_date = date_of(before_midnight + 1ms);
+
+        SigningKeyCache cache{"AKIDEXAMPLE", std::string{secret}};
+        const auto old_scope = cache.get(old_date, "us-east-1");
+        const auto new_scope = cache.get(new_date, "us-east-1");
+        if (!check_scope(*old_scope, "20241231", "us-east-1") ||
+            !check_scope(*new_scope, "20250101", "us-east-1")) {
+            return 1;
+        }
+        const auto late_scope = cache.get(old_date, "us-east-1");
+        if (!check_scope(*late_scope, "20241231", "us-east-1") ||
+            cache.get(new_date, "us-east-1") != new_scope) {
+            std::cerr << "a request signed with the previous date evicted the current scope\n";
+            return 1;
+        }
+    }
+}